@@ -0,0 +1,296 @@
+#include "access_log.hpp"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+
+namespace http {
+
+namespace {
+
+// 缓冲的格式化结果超过该大小时立即写出
+constexpr size_t kWriteBatch = 64 * 1024;
+
+// 各AccessLog实例的编号，线程据此判断缓存的缓冲区属于哪个实例（地址可能被复用）
+std::atomic<uint64_t> next_log_id{1};
+
+size_t round_up_power_of_two(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+void append_number(std::string& out, uint64_t value) {
+    char number[24];
+    auto result = std::to_chars(number, number + sizeof(number), value);
+    out.append(number, result.ptr - number);
+}
+
+// 写入JSON字符串的内容，转义引号、反斜杠和控制字符
+void append_json(std::string& out, std::string_view value) {
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            int length = std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned char>(c));
+            out.append(escaped, length);
+        } else {
+            out.push_back(c);
+        }
+    }
+}
+
+} // namespace
+
+void AccessLogRecord::set_method(std::string_view value) {
+    method_length = static_cast<uint8_t>(std::min(value.size(), kMaxMethod));
+    std::memcpy(method, value.data(), method_length);
+}
+
+void AccessLogRecord::set_target(std::string_view path, std::string_view query) {
+    size_t length = std::min(path.size(), kMaxTarget);
+    std::memcpy(target, path.data(), length);
+    truncated = length < path.size();
+    if (!query.empty() && length < kMaxTarget) {
+        target[length++] = '?';
+        size_t query_length = std::min(query.size(), kMaxTarget - length);
+        std::memcpy(target + length, query.data(), query_length);
+        length += query_length;
+        truncated = truncated || query_length < query.size();
+    } else if (!query.empty()) {
+        truncated = true;
+    }
+    target_length = static_cast<uint8_t>(length);
+}
+
+AccessLog::Ring::Ring(size_t capacity)
+    : slots(std::make_unique<AccessLogRecord[]>(capacity)), mask(capacity - 1), owner(std::this_thread::get_id()) {
+}
+
+AccessLog::AccessLog(const Options& options)
+    : options_(options), id_(next_log_id.fetch_add(1, std::memory_order_relaxed)) {
+    options_.ring_capacity = round_up_power_of_two(std::max<size_t>(options_.ring_capacity, 2));
+    options_.max_files = std::max<size_t>(options_.max_files, 1);
+    buffer_.reserve(kWriteBatch * 2);
+    open_file();
+    writer_ = std::thread([this]() { run(); });
+}
+
+AccessLog::~AccessLog() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_cv_.notify_all();
+    writer_.join();
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+void AccessLog::open_file() {
+    fd_ = open(options_.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::runtime_error("无法打开访问日志 " + options_.path + ": " + std::strerror(errno));
+    }
+    struct stat info;
+    file_size_ = fstat(fd_, &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+}
+
+AccessLog::Ring* AccessLog::claim_ring() {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    // 同一线程交替写多个实例时沿用之前领取的缓冲区
+    for (const auto& ring : rings_) {
+        if (ring->owner == std::this_thread::get_id()) {
+            return ring.get();
+        }
+    }
+    rings_.push_back(std::make_unique<Ring>(options_.ring_capacity));
+    return rings_.back().get();
+}
+
+bool AccessLog::log(const AccessLogRecord& record) {
+    struct ThreadRing {
+        uint64_t owner = 0;
+        Ring* ring = nullptr;
+    };
+    thread_local ThreadRing local;
+    if (local.owner != id_) {
+        local.ring = claim_ring();
+        local.owner = id_;
+    }
+
+    Ring& ring = *local.ring;
+    uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    if (tail - ring.cached_head > ring.mask) {
+        ring.cached_head = ring.head.load(std::memory_order_acquire);
+        if (tail - ring.cached_head > ring.mask) {
+            ring.dropped.store(ring.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    ring.slots[tail & ring.mask] = record;
+    ring.tail.store(tail + 1, std::memory_order_release);
+    // 每写入半个缓冲区唤醒一次后台线程，避免高负载时在轮询间隔内写满；
+    // 不持锁通知，偶尔错过的唤醒最多推迟一个轮询间隔
+    if (((tail + 1) & (ring.mask >> 1)) == 0 && !wake_requested_.exchange(true, std::memory_order_relaxed)) {
+        wake_cv_.notify_one();
+    }
+    return true;
+}
+
+uint64_t AccessLog::dropped() const {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    uint64_t total = 0;
+    for (const auto& ring : rings_) {
+        total += ring->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void AccessLog::flush() {
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    uint64_t request = ++flush_requests_;
+    wake_cv_.notify_all();
+    flushed_cv_.wait(lock, [this, request]() { return flushed_requests_ >= request || stopping_; });
+}
+
+void AccessLog::run() {
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    for (;;) {
+        bool stopping = stopping_;
+        uint64_t flush_request = flush_requests_;
+        wake_requested_.store(false, std::memory_order_relaxed);
+        lock.unlock();
+
+        // 停止或有人等待flush时一直排空到没有新记录为止
+        size_t drained;
+        do {
+            drained = drain();
+        } while (drained > 0 && (stopping || flush_request > flushed_requests_));
+        if (!buffer_.empty() && (drained == 0 || buffer_.size() >= kWriteBatch)) {
+            write_buffer();
+        }
+
+        lock.lock();
+        if (flush_request > flushed_requests_) {
+            flushed_requests_ = flush_request;
+            flushed_cv_.notify_all();
+        }
+        if (stopping) {
+            return;
+        }
+        if (drained == 0) {
+            wake_cv_.wait_for(lock, options_.flush_interval,
+                              [this, flush_request]() {
+                                  return stopping_ || flush_requests_ > flush_request ||
+                                         wake_requested_.load(std::memory_order_relaxed);
+                              });
+        }
+    }
+}
+
+size_t AccessLog::drain() {
+    // 缓冲区只增不减，持锁遍历只会与首次写日志的线程竞争
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    size_t drained = 0;
+    for (const auto& ring : rings_) {
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        uint64_t tail = ring->tail.load(std::memory_order_acquire);
+        for (uint64_t i = head; i < tail; ++i) {
+            format(ring->slots[i & ring->mask]);
+            if (buffer_.size() >= kWriteBatch) {
+                ring->head.store(i + 1, std::memory_order_release);
+                write_buffer();
+            }
+        }
+        ring->head.store(tail, std::memory_order_release);
+        drained += tail - head;
+    }
+    written_.fetch_add(drained, std::memory_order_relaxed);
+    return drained;
+}
+
+void AccessLog::format(const AccessLogRecord& record) {
+    int64_t second = record.time_ns / 1000000000;
+    if (second != cached_second_) {
+        time_t time = static_cast<time_t>(second);
+        struct tm utc;
+        gmtime_r(&time, &utc);
+        std::strftime(cached_time_, sizeof(cached_time_), "%Y-%m-%dT%H:%M:%S", &utc);
+        cached_second_ = second;
+    }
+    char millis[8];
+    std::snprintf(millis, sizeof(millis), ".%03dZ", static_cast<int>(record.time_ns / 1000000 % 1000));
+    char peer[INET_ADDRSTRLEN];
+    in_addr address{record.peer};
+    inet_ntop(AF_INET, &address, peer, sizeof(peer));
+
+    buffer_.append("{\"time\":\"").append(cached_time_).append(millis);
+    buffer_.append("\",\"remote\":\"").append(peer);
+    buffer_.append("\",\"method\":\"");
+    append_json(buffer_, std::string_view(record.method, record.method_length));
+    buffer_.append("\",\"target\":\"");
+    append_json(buffer_, std::string_view(record.target, record.target_length));
+    if (record.truncated) {
+        buffer_.append("...");
+    }
+    buffer_.append("\",\"status\":");
+    append_number(buffer_, record.status);
+    buffer_.append(",\"bytes\":");
+    append_number(buffer_, record.bytes);
+    buffer_.append(",\"duration_us\":");
+    append_number(buffer_, record.duration_ns / 1000);
+    buffer_.append("}\n");
+}
+
+void AccessLog::write_buffer() {
+    if (options_.max_size > 0 && file_size_ > 0 && file_size_ + buffer_.size() > options_.max_size) {
+        rotate();
+    }
+    size_t offset = 0;
+    while (offset < buffer_.size()) {
+        ssize_t written = write(fd_, buffer_.data() + offset, buffer_.size() - offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // 磁盘写满等错误时放弃这一批，不阻塞后台线程
+            break;
+        }
+        offset += written;
+    }
+    file_size_ += offset;
+    buffer_.clear();
+}
+
+void AccessLog::rotate() {
+    // path.(N-1) -> path.N, ..., path -> path.1，最旧的文件被覆盖
+    for (size_t i = options_.max_files; i > 1; --i) {
+        std::string from = options_.path + "." + std::to_string(i - 1);
+        std::string to = options_.path + "." + std::to_string(i);
+        std::rename(from.c_str(), to.c_str());
+    }
+    std::rename(options_.path.c_str(), (options_.path + ".1").c_str());
+    int old_fd = fd_;
+    try {
+        open_file();
+        close(old_fd);
+    } catch (const std::exception&) {
+        // 无法创建新文件时继续写原来的（已改名的）文件
+        fd_ = old_fd;
+    }
+}
+
+} // namespace http
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace http {
+
+/**
+ * 一条访问日志
+ * 定长、可平凡复制，请求线程只填写字段，格式化和写文件都由后台线程完成。
+ * 过长的请求目标被截断（truncated为true）。
+ */
+struct AccessLogRecord {
+    static constexpr size_t kMaxMethod = 12;
+    static constexpr size_t kMaxTarget = 210;
+
+    int64_t time_ns = 0;          // 响应发送完毕的时刻（system_clock，自纪元起的纳秒）
+    uint64_t duration_ns = 0;     // 从请求第一个字节到达到响应发送完毕
+    uint64_t bytes = 0;           // 响应字节数（含状态行和头部）
+    uint32_t peer = 0;            // 客户端IPv4地址（网络字节序）
+    uint16_t status = 0;
+    uint8_t method_length = 0;
+    uint8_t target_length = 0;
+    bool truncated = false;
+    char method[kMaxMethod];
+    char target[kMaxTarget];      // 路径加查询字符串
+
+    void set_method(std::string_view value);
+    void set_target(std::string_view path, std::string_view query);
+};
+
+/**
+ * 异步访问日志
+ * 每个写日志的线程首次调用log()时领取一个单生产者单消费者的环形缓冲区，
+ * 之后写入只需一次复制和一次release存储，不加锁、不分配内存；缓冲区满时丢弃该条并计数。
+ * 每写入半个缓冲区唤醒一次后台线程，其余时间后台线程按flush_interval轮询所有缓冲区，把记录格式化为JSON行，
+ * 攒成批次后一次write()写入文件。文件超过max_size时轮转为path.1、path.2……，
+ * 最多保留max_files个历史文件。
+ */
+class AccessLog {
+public:
+    struct Options {
+        std::string path;
+        size_t max_size = 64 * 1024 * 1024;     // 单个文件的大小上限（字节），0表示不轮转
+        size_t max_files = 5;                   // 轮转保留的历史文件数
+        size_t ring_capacity = 8192;            // 每个线程的缓冲区容量（条），向上取整为2的幂
+        std::chrono::milliseconds flush_interval{100};   // 缓冲区为空时后台线程的轮询间隔
+    };
+
+    // 打开（追加）日志文件并启动后台线程，无法打开时抛出std::runtime_error
+    explicit AccessLog(const Options& options);
+
+    // 写出所有缓冲区中的记录后停止后台线程
+    ~AccessLog();
+
+    AccessLog(const AccessLog&) = delete;
+    AccessLog& operator=(const AccessLog&) = delete;
+
+    // 提交一条记录（线程安全，每个线程使用自己的缓冲区），缓冲区已满时返回false
+    bool log(const AccessLogRecord& record);
+
+    // 因缓冲区已满而丢弃的记录数
+    uint64_t dropped() const;
+
+    // 已写入文件的记录数
+    uint64_t written() const { return written_.load(std::memory_order_relaxed); }
+
+    // 等待此前提交的记录全部写入文件
+    void flush();
+
+private:
+    struct alignas(64) Ring {
+        explicit Ring(size_t capacity);
+
+        std::unique_ptr<AccessLogRecord[]> slots;
+        const uint64_t mask;
+        std::thread::id owner;
+        alignas(64) std::atomic<uint64_t> head{0};   // 后台线程的读取位置
+        alignas(64) std::atomic<uint64_t> tail{0};   // 生产者的写入位置
+        uint64_t cached_head = 0;                    // 生产者最近看到的读取位置，减少跨核读取
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    Options options_;
+    const uint64_t id_;
+    int fd_ = -1;
+    uint64_t file_size_ = 0;
+
+    mutable std::mutex rings_mutex_;
+    std::vector<std::unique_ptr<Ring>> rings_;
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_cv_;
+    bool stopping_ = false;
+    uint64_t flush_requests_ = 0;
+    uint64_t flushed_requests_ = 0;
+    std::condition_variable flushed_cv_;
+
+    std::atomic<bool> wake_requested_{false};
+    std::atomic<uint64_t> written_{0};
+    std::string buffer_;
+    int64_t cached_second_ = -1;
+    char cached_time_[24];          // 缓存的"YYYY-MM-DDTHH:MM:SS"
+    std::thread writer_;
+
+    Ring* claim_ring();
+    void run();
+    size_t drain();
+    void format(const AccessLogRecord& record);
+    void write_buffer();
+    void open_file();
+    void rotate();
+};
+
+} // namespace http
@@ -0,0 +1,110 @@
+#include "arena.hpp"
+#include "buffer_pool.hpp"
+#include <algorithm>
+#include <new>
+
+namespace http {
+
+namespace {
+
+thread_local std::pmr::memory_resource* current_resource = nullptr;
+
+} // namespace
+
+RequestArena::RequestArena() : pool_(&BufferPool::local()) {}
+
+RequestArena::~RequestArena() {
+    // 析构可能发生在任意线程，直接释放而不归还线程本地池
+    for (const Block& block : blocks_) {
+        delete[] block.data;
+    }
+    release_large();
+}
+
+void RequestArena::reset() {
+    for (const Block& block : blocks_) {
+        if (block.pooled) {
+            pool_->release(block.data);
+        } else {
+            delete[] block.data;
+        }
+    }
+    blocks_.clear();
+    offset_ = 0;
+    release_large();
+}
+
+void RequestArena::release_large() {
+    while (large_) {
+        LargeBlock* next = large_->next;
+        ::operator delete(large_, std::align_val_t(large_->alignment));
+        large_ = next;
+    }
+}
+
+size_t RequestArena::large_header(size_t alignment) {
+    // 头部长度取对齐的整数倍，使其后的地址满足调用者要求的对齐
+    return (sizeof(LargeBlock) + alignment - 1) / alignment * alignment;
+}
+
+void* RequestArena::do_allocate(size_t bytes, size_t alignment) {
+    // 池块只保证max_align_t对齐，超对齐的请求也走堆
+    if (bytes > kLargeThreshold || alignment > alignof(std::max_align_t)) {
+        alignment = std::max(alignment, alignof(LargeBlock));
+        size_t header = large_header(alignment);
+        auto* block = static_cast<LargeBlock*>(::operator new(header + bytes, std::align_val_t(alignment)));
+        block->prev = nullptr;
+        block->next = large_;
+        block->alignment = alignment;
+        if (large_) {
+            large_->prev = block;
+        }
+        large_ = block;
+        return reinterpret_cast<char*>(block) + header;
+    }
+
+    size_t aligned = (offset_ + alignment - 1) / alignment * alignment;
+    if (blocks_.empty() || aligned + bytes > BufferPool::kBlockSize) {
+        // 其他线程上的缓冲池不是线程安全的，也不能由本线程归还，只能走堆
+        bool pooled = &BufferPool::local() == pool_;
+        blocks_.push_back(Block{pooled ? pool_->acquire() : new char[BufferPool::kBlockSize], pooled});
+        aligned = 0;
+    }
+    offset_ = aligned + bytes;
+    return blocks_.back().data + aligned;
+}
+
+void RequestArena::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    if (bytes <= kLargeThreshold && alignment <= alignof(std::max_align_t)) {
+        return;
+    }
+    alignment = std::max(alignment, alignof(LargeBlock));
+    auto* block = reinterpret_cast<LargeBlock*>(static_cast<char*>(p) - large_header(alignment));
+    if (block->prev) {
+        block->prev->next = block->next;
+    } else {
+        large_ = block->next;
+    }
+    if (block->next) {
+        block->next->prev = block->prev;
+    }
+    ::operator delete(block, std::align_val_t(block->alignment));
+}
+
+bool RequestArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+std::pmr::memory_resource* current_memory_resource() {
+    return current_resource ? current_resource : std::pmr::get_default_resource();
+}
+
+MemoryResourceScope::MemoryResourceScope(std::pmr::memory_resource* resource) : previous_(current_resource) {
+    current_resource = resource;
+}
+
+MemoryResourceScope::~MemoryResourceScope() {
+    current_resource = previous_;
+}
+
+} // namespace http
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace http {
+
+class BufferPool;
+
+/**
+ * 请求级单调内存池
+ * 小块分配在BufferPool提供的固定大小块上顺序切分，释放是空操作，
+ * reset()时把所有块一次性归还，因此稳定状态下每个请求不调用malloc。
+ * 池块只取自创建arena的线程（连接所属的I/O线程）的缓冲池；在其他线程（如工作线程执行处理器时）
+ * 需要新块则直接从堆分配，reset()时释放，使块总是回到取出它的池，不会从一个线程的池流向另一个。
+ * 超过kLargeThreshold的分配（如大响应体）直接走堆，deallocate时立即释放，
+ * 避免字符串反复扩容时在池中留下大块废弃内存。
+ * 不是线程安全的：同一时刻只能有一个线程使用，连接在I/O线程与工作线程之间的交接
+ * 经由任务队列完成，已经建立了先后关系。
+ */
+class RequestArena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t kLargeThreshold = 4096;
+
+    RequestArena();
+    ~RequestArena() override;
+
+    RequestArena(const RequestArena&) = delete;
+    RequestArena& operator=(const RequestArena&) = delete;
+
+    // 归还所有内存，之前分配的对象必须已经销毁或放弃其内存（必须在创建arena的线程调用）
+    void reset();
+
+    // 当前持有的块数
+    size_t blocks() const { return blocks_.size(); }
+
+    // 当前块中已使用的字节数
+    size_t used() const { return offset_; }
+
+private:
+    struct LargeBlock {
+        LargeBlock* prev;
+        LargeBlock* next;
+        size_t alignment;
+    };
+
+    struct Block {
+        char* data;
+        bool pooled;    // 取自pool_，否则直接从堆分配
+    };
+
+    BufferPool* pool_;              // 创建arena的线程的缓冲池
+    std::vector<Block> blocks_;
+    size_t offset_ = 0;             // 最后一个块中下一个可用位置
+    LargeBlock* large_ = nullptr;   // 直接从堆分配的大块（双向链表）
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    void release_large();
+    static size_t large_header(size_t alignment);
+};
+
+// 当前线程上新建的Request/Response使用的内存资源，默认为堆
+std::pmr::memory_resource* current_memory_resource();
+
+/**
+ * 在作用域内替换当前线程的内存资源，离开时恢复
+ * 服务器在执行处理器期间安装连接的RequestArena，处理器中默认构造的Response即分配在其中
+ */
+class MemoryResourceScope {
+public:
+    explicit MemoryResourceScope(std::pmr::memory_resource* resource);
+    ~MemoryResourceScope();
+
+    MemoryResourceScope(const MemoryResourceScope&) = delete;
+    MemoryResourceScope& operator=(const MemoryResourceScope&) = delete;
+
+private:
+    std::pmr::memory_resource* previous_;
+};
+
+} // namespace http
@@ -0,0 +1,115 @@
+#include "async_io.hpp"
+#include "event_loop.hpp"
+#include "thread_pool.hpp"
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <stdexcept>
+
+namespace http {
+
+namespace {
+
+thread_local ThreadPool* offload_pool = nullptr;
+
+EventLoop& current_loop() {
+    EventLoop* loop = EventLoop::current();
+    if (!loop) {
+        throw std::logic_error("异步操作只能在事件循环线程上等待");
+    }
+    return *loop;
+}
+
+// fd就绪（或出错）后在循环线程上调用一次ready
+void wait_ready(EventLoop& loop, int fd, uint32_t events, std::function<void()> ready) {
+    if (loop.uses_io_uring()) {
+        loop.poll_once(fd, events, [ready = std::move(ready)](int) { ready(); });
+        return;
+    }
+    // 在回调中移除注册是安全的：事件循环把正在执行的回调延迟到本轮分发结束后再销毁
+    loop.add(fd, events, [&loop, fd, ready = std::move(ready)](uint32_t) {
+        loop.remove(fd);
+        ready();
+    });
+}
+
+} // namespace
+
+void SleepAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    current_loop().run_after(delay_, [handle]() { handle.resume(); });
+}
+
+bool SocketAwaiter::attempt() {
+    ssize_t result = 0;
+    switch (operation_) {
+        case Operation::Read:
+            result = ::read(fd_, const_cast<void*>(data_), length_);
+            break;
+        case Operation::Write:
+            result = ::send(fd_, data_, length_, MSG_NOSIGNAL);
+            break;
+        case Operation::Connect: {
+            if (connecting_) {
+                // 连接结果在socket可写后从SO_ERROR读取
+                int error = 0;
+                socklen_t error_length = sizeof(error);
+                if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &error_length) < 0) {
+                    error = errno;
+                }
+                result_ = -error;
+                return true;
+            }
+            connecting_ = true;
+            result = ::connect(fd_, static_cast<const sockaddr*>(data_), static_cast<socklen_t>(length_));
+            // 被信号中断的connect同样在后台继续进行
+            if (result < 0 && (errno == EINPROGRESS || errno == EINTR)) {
+                return false;
+            }
+            break;
+        }
+    }
+    if (result < 0 && errno == EINTR) {
+        return attempt();
+    }
+    if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return false;
+    }
+    result_ = result < 0 ? -errno : result;
+    return true;
+}
+
+void SocketAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    uint32_t events = operation_ == Operation::Read ? EPOLLIN : EPOLLOUT;
+    wait_ready(current_loop(), fd_, events, [this, handle]() {
+        if (attempt()) {
+            handle.resume();
+            return;
+        }
+        // 虚假唤醒（如数据已被其他读者取走），继续等待
+        await_suspend(handle);
+    });
+}
+
+void set_offload_pool(ThreadPool* pool) {
+    offload_pool = pool;
+}
+
+namespace detail {
+
+void submit_offload(std::function<void()> work, std::coroutine_handle<> handle) {
+    EventLoop& loop = current_loop();
+    if (!offload_pool) {
+        throw std::logic_error("当前事件循环没有可用的offload线程池");
+    }
+    bool accepted = offload_pool->submit([work = std::move(work), handle, &loop]() {
+        work();
+        loop.post([handle]() { handle.resume(); });
+    });
+    if (!accepted) {
+        throw std::runtime_error("线程池排队已满");
+    }
+}
+
+} // namespace detail
+
+} // namespace http
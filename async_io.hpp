@@ -0,0 +1,142 @@
+#pragma once
+
+#include "task.hpp"
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace http {
+
+class ThreadPool;
+
+/**
+ * 协程处理器可以co_await的异步操作
+ * 都必须在事件循环线程上等待（异步处理器本身就在连接所属的事件循环上运行），
+ * 完成后协程在同一个事件循环线程上恢复。事件循环中不能阻塞，等待磁盘或其他阻塞调用应使用offload()。
+ */
+
+// 在指定时间后恢复
+class SleepAwaiter {
+public:
+    explicit SleepAwaiter(std::chrono::milliseconds delay) : delay_(delay) {}
+
+    bool await_ready() const noexcept { return delay_.count() <= 0; }
+    void await_suspend(std::coroutine_handle<> handle);
+    void await_resume() const noexcept {}
+
+private:
+    std::chrono::milliseconds delay_;
+};
+
+/**
+ * 非阻塞socket上的读、写和连接
+ * 先直接尝试一次，返回EAGAIN（连接为EINPROGRESS）时等待就绪后重试。
+ * 结果为传输的字节数（连接成功为0），失败时为负的errno。
+ * 同一个fd同一时刻只能有一个等待中的操作。
+ */
+class SocketAwaiter {
+public:
+    enum class Operation { Read, Write, Connect };
+
+    SocketAwaiter(Operation operation, int fd, const void* data, size_t length)
+        : operation_(operation), fd_(fd), data_(data), length_(length) {}
+
+    bool await_ready() { return attempt(); }
+    void await_suspend(std::coroutine_handle<> handle);
+    ssize_t await_resume() const noexcept { return result_; }
+
+private:
+    Operation operation_;
+    int fd_;
+    const void* data_;      // 读写缓冲区，连接时为sockaddr
+    size_t length_;
+    ssize_t result_ = 0;
+    bool connecting_ = false;
+
+    // 尝试一次操作，完成（成功或出错）返回true，需要等待就绪返回false
+    bool attempt();
+};
+
+inline SleepAwaiter sleep_for(std::chrono::milliseconds delay) {
+    return SleepAwaiter(delay);
+}
+
+inline SocketAwaiter async_read(int fd, void* buffer, size_t length) {
+    return SocketAwaiter(SocketAwaiter::Operation::Read, fd, buffer, length);
+}
+
+inline SocketAwaiter async_write(int fd, const void* data, size_t length) {
+    return SocketAwaiter(SocketAwaiter::Operation::Write, fd, data, length);
+}
+
+inline SocketAwaiter async_connect(int fd, const sockaddr* address, socklen_t length) {
+    return SocketAwaiter(SocketAwaiter::Operation::Connect, fd, address, length);
+}
+
+// 设置当前事件循环线程上offload()使用的线程池（服务器在启动事件循环线程时设置）
+void set_offload_pool(ThreadPool* pool);
+
+namespace detail {
+
+// 在offload线程池中执行work，完成后在当前事件循环上恢复handle；线程池已满时抛出异常
+void submit_offload(std::function<void()> work, std::coroutine_handle<> handle);
+
+} // namespace detail
+
+/**
+ * 在服务器的工作线程池中执行阻塞调用，完成后回到事件循环继续
+ * 结果（或异常）在co_await处返回（或重新抛出）
+ */
+template <typename Fn>
+class OffloadAwaiter {
+public:
+    using Result = std::invoke_result_t<Fn&>;
+
+    explicit OffloadAwaiter(Fn fn) : fn_(std::move(fn)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        detail::submit_offload([this]() {
+            try {
+                if constexpr (std::is_void_v<Result>) {
+                    fn_();
+                } else {
+                    result_.emplace(fn_());
+                }
+            } catch (...) {
+                error_ = std::current_exception();
+            }
+        }, handle);
+    }
+
+    Result await_resume() {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        if constexpr (!std::is_void_v<Result>) {
+            return std::move(*result_);
+        }
+    }
+
+private:
+    using Storage = std::conditional_t<std::is_void_v<Result>, bool, std::optional<Result>>;
+
+    Fn fn_;
+    Storage result_{};
+    std::exception_ptr error_;
+};
+
+template <typename Fn>
+OffloadAwaiter<std::decay_t<Fn>> offload(Fn&& fn) {
+    return OffloadAwaiter<std::decay_t<Fn>>(std::forward<Fn>(fn));
+}
+
+} // namespace http
@@ -0,0 +1,102 @@
+#include "../access_log.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * 访问日志基准
+ * 若干线程各自连续提交记录，统计每次log()的耗时（请求线程上的全部开销）、
+ * 丢弃的条数，以及后台线程把全部记录写入文件所需的时间。
+ */
+
+namespace {
+
+http::AccessLogRecord make_record(size_t i) {
+    http::AccessLogRecord record;
+    record.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::system_clock::now().time_since_epoch()).count();
+    record.duration_ns = 42000 + i % 1000;
+    record.bytes = 1234;
+    record.peer = 0x0100007f;
+    record.status = 200;
+    record.set_method("GET");
+    record.set_target("/api/users/12345", "page=2&sort=name");
+    return record;
+}
+
+struct Result {
+    double log_ns = 0;
+    uint64_t written = 0;
+    uint64_t dropped = 0;
+    double flush_ms = 0;
+};
+
+// 每个线程提交iterations条记录，两次log()之间忙等work_ns模拟处理请求
+Result run(const std::string& path, size_t iterations, size_t threads, uint64_t work_ns) {
+    http::AccessLog::Options options;
+    options.path = path;
+    options.max_size = 0;
+    Result result;
+    http::AccessLog log(options);
+    std::vector<double> per_thread(threads);
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            http::AccessLogRecord record = make_record(t);
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations; ++i) {
+                if (work_ns > 0) {
+                    auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(work_ns);
+                    while (std::chrono::steady_clock::now() < until) {
+                    }
+                }
+                record.duration_ns = i;
+                log.log(record);
+            }
+            per_thread[t] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto flush_start = std::chrono::steady_clock::now();
+    log.flush();
+    result.flush_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - flush_start).count();
+    for (double ns : per_thread) {
+        result.log_ns += ns;
+    }
+    result.log_ns = work_ns == 0 ? result.log_ns / (threads * iterations) : 0;
+    result.written = log.written();
+    result.dropped = log.dropped();
+    return result;
+}
+
+// 有忙等时log()的耗时淹没在计时误差中，只报告写入和丢弃的条数
+void print(const char* name, const Result& result) {
+    std::printf("%-28s %8.1f ns/log  written %9llu  dropped %9llu  final flush %6.1f ms\n", name, result.log_ns,
+                static_cast<unsigned long long>(result.written), static_cast<unsigned long long>(result.dropped),
+                result.flush_ms);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10)
+                              : std::max<size_t>(1, std::min<size_t>(4, std::thread::hardware_concurrency() - 1));
+    std::string path = "/tmp/access_log_bench." + std::to_string(getpid()) + ".log";
+
+    std::printf("threads=%zu records/thread=%zu ring=8192\n", threads, iterations);
+    // 连续提交：远超后台线程的格式化速度，缓冲区很快写满，多出的记录被丢弃
+    print("burst", run(path, iterations, threads, 0));
+    unlink(path.c_str());
+    // 每个请求约2µs：后台线程跟得上，不应丢弃
+    print("paced (2us per request)", run(path, iterations / 4, threads, 2000));
+    unlink(path.c_str());
+    return 0;
+}
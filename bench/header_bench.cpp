@@ -0,0 +1,248 @@
+#include "../headers.hpp"
+#include "../request_parser.hpp"
+#include "../arena.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <unordered_map>
+
+/**
+ * 头部存储微基准
+ * 对比之前的std::pmr::unordered_map与平铺的HeaderMap：从解析器构造、查找常用头部、
+ * 序列化为响应头三项的耗时和每次操作的分配次数
+ */
+
+namespace {
+
+std::atomic<size_t> allocation_count{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+const char kSampleRequest[] =
+    "GET /json?pretty=1 HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "\r\n";
+
+// 重构前的头部类型及其查找方式，仅作为基准对照
+using LegacyHeaderMap = std::pmr::unordered_map<std::pmr::string, std::pmr::string>;
+
+const std::pmr::string* legacy_find(const LegacyHeaderMap& headers, std::string_view name) {
+    for (const auto& [key, value] : headers) {
+        if (http::iequals(key, name)) {
+            return &value;
+        }
+    }
+    return nullptr;
+}
+
+LegacyHeaderMap legacy_build(const http::RequestParser& parser, std::pmr::memory_resource* resource) {
+    LegacyHeaderMap headers(resource);
+    for (size_t i = 0; i < parser.header_count(); ++i) {
+        http::RequestParser::Header header = parser.header(i);
+        headers.emplace(std::pmr::string(header.name, resource), std::pmr::string(header.value, resource));
+    }
+    return headers;
+}
+
+http::HeaderMap build(const http::RequestParser& parser, std::pmr::memory_resource* resource) {
+    http::HeaderMap headers(resource);
+    headers.reserve(parser.header_count());
+    for (size_t i = 0; i < parser.header_count(); ++i) {
+        http::RequestParser::Header header = parser.header(i);
+        headers.add(header.id, header.name, header.value);
+    }
+    return headers;
+}
+
+// 典型请求路径上查找的头部：keep-alive判断、Expect、压缩协商、缓存校验
+size_t legacy_lookups(const LegacyHeaderMap& headers) {
+    size_t found = 0;
+    found += legacy_find(headers, "Connection") != nullptr;
+    found += legacy_find(headers, "Expect") != nullptr;
+    found += legacy_find(headers, "Accept-Encoding") != nullptr;
+    found += legacy_find(headers, "If-None-Match") != nullptr;
+    found += legacy_find(headers, "Host") != nullptr;
+    return found;
+}
+
+size_t lookups(const http::HeaderMap& headers) {
+    size_t found = 0;
+    found += headers.contains(http::HeaderId::Connection);
+    found += headers.contains(http::HeaderId::Expect);
+    found += headers.contains(http::HeaderId::AcceptEncoding);
+    found += headers.contains(http::HeaderId::IfNoneMatch);
+    found += headers.contains(http::HeaderId::Host);
+    return found;
+}
+
+// 与write_head相同的序列化方式：跳过Connection，缺省时补充Content-Type/Content-Length
+void legacy_serialize(const LegacyHeaderMap& headers, std::string& out) {
+    bool has_content_length = false;
+    bool has_content_type = false;
+    for (const auto& [key, value] : headers) {
+        if (http::iequals(key, "Connection")) {
+            continue;
+        }
+        if (http::iequals(key, "Content-Length")) {
+            has_content_length = true;
+        } else if (http::iequals(key, "Content-Type")) {
+            has_content_type = true;
+        }
+        out.append(key).append(": ").append(value).append("\r\n");
+    }
+    if (!has_content_type) {
+        out.append("Content-Type: text/html; charset=utf-8\r\n");
+    }
+    if (!has_content_length) {
+        out.append("Content-Length: 0\r\n");
+    }
+}
+
+void serialize(const http::HeaderMap& headers, std::string& out) {
+    for (const http::HeaderMap::Entry& header : headers) {
+        if (header.id != http::HeaderId::Connection) {
+            out.append(header.name).append(": ").append(header.value).append("\r\n");
+        }
+    }
+    if (!headers.contains(http::HeaderId::ContentType)) {
+        out.append("Content-Type: text/html; charset=utf-8\r\n");
+    }
+    if (!headers.contains(http::HeaderId::ContentLength)) {
+        out.append("Content-Length: 0\r\n");
+    }
+}
+
+template <typename Fn>
+void run(const char* name, size_t iterations, Fn&& fn) {
+    // 预热
+    for (size_t i = 0; i < iterations / 10; ++i) {
+        fn();
+    }
+
+    size_t allocations_before = allocation_count.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    size_t allocations = allocation_count.load() - allocations_before;
+
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    std::printf("%-36s %10.1f ns/op %8.2f allocs/op\n", name, ns,
+                static_cast<double>(allocations) / iterations);
+}
+
+volatile size_t sink = 0;
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500000;
+    std::string_view raw(kSampleRequest, sizeof(kSampleRequest) - 1);
+
+    http::RequestParser parser;
+    parser.parse(raw);
+    std::pmr::memory_resource* heap = std::pmr::get_default_resource();
+
+    run("build unordered_map (heap)", iterations, [&]() {
+        LegacyHeaderMap headers = legacy_build(parser, heap);
+        sink = sink + headers.size();
+    });
+    run("build HeaderMap (heap)", iterations, [&]() {
+        http::HeaderMap headers = build(parser, heap);
+        sink = sink + headers.size();
+    });
+
+    // 请求级arena在请求之间回收，稳定状态下不再调用malloc
+    http::RequestArena arena;
+    run("build unordered_map (arena)", iterations, [&]() {
+        {
+            LegacyHeaderMap headers = legacy_build(parser, &arena);
+            sink = sink + headers.size();
+        }
+        arena.reset();
+    });
+    run("build HeaderMap (arena)", iterations, [&]() {
+        {
+            http::HeaderMap headers = build(parser, &arena);
+            sink = sink + headers.size();
+        }
+        arena.reset();
+    });
+
+    LegacyHeaderMap legacy_headers = legacy_build(parser, heap);
+    http::HeaderMap headers = build(parser, heap);
+    run("5 lookups unordered_map (scan)", iterations, [&]() {
+        sink = sink + legacy_lookups(legacy_headers);
+    });
+    run("5 lookups HeaderMap (HeaderId)", iterations, [&]() {
+        sink = sink + lookups(headers);
+    });
+    run("5 lookups HeaderMap (name)", iterations, [&]() {
+        size_t found = 0;
+        for (std::string_view name : {"Connection", "Expect", "Accept-Encoding", "If-None-Match", "Host"}) {
+            found += headers.contains(name);
+        }
+        sink = sink + found;
+    });
+
+    std::string out;
+    out.reserve(1024);
+    run("serialize unordered_map", iterations, [&]() {
+        out.clear();
+        legacy_serialize(legacy_headers, out);
+        sink = sink + out.size();
+    });
+    run("serialize HeaderMap", iterations, [&]() {
+        out.clear();
+        serialize(headers, out);
+        sink = sink + out.size();
+    });
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include "../http_server.hpp"
+#include <sys/ptrace.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * I/O后端基准
+ * 服务器运行在子进程中（1个事件循环线程），父进程用多个keep-alive连接做闭环压测：
+ *   - 吞吐：不受干扰地运行固定时长，统计每秒请求数
+ *   - 系统调用：以ptrace跟踪服务器进程的全部线程，统计压测期间每个请求触发的系统调用数
+ * 用法: io_backend_bench [连接数] [秒数] [路径]
+ * 路径可选 /static（I/O线程直接发送预生成报文）或 /dynamic（经线程池执行处理器）
+ */
+
+namespace {
+
+constexpr int kBasePort = 18180;
+constexpr size_t kTracedRequests = 20000;
+
+struct Options {
+    int connections = 16;
+    int seconds = 5;
+    std::string path = "/static";
+};
+
+// 子进程：启动服务器，就绪后写ready管道，随后等待被父进程结束
+[[noreturn]] void run_server(http::IoBackend backend, int port, int ready_fd, bool traced) {
+    if (traced) {
+        ptrace(PTRACE_TRACEME, 0, nullptr, nullptr);
+        raise(SIGSTOP);
+    }
+
+    // 服务器的启动日志不混入基准输出
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+
+    http::ServerConfig config;
+    config.port = port;
+    config.io_threads = 1;
+    config.worker_threads = 1;
+    config.io_backend = backend;
+    config.max_keep_alive_requests = SIZE_MAX;
+    config.keep_alive_timeout = std::chrono::milliseconds(60000);
+
+    http::HttpServer server(config);
+    http::Response page;
+    page.body = "<h1>hello</h1>";
+    server.register_static("GET", "/static", page);
+    server.register_handler("GET", "/dynamic", [](const http::Request&) {
+        http::Response response;
+        response.body = "<h1>hello</h1>";
+        return response;
+    });
+    server.start();
+
+    char ready = server.io_backend() == backend ? 1 : 0;
+    ssize_t written = write(ready_fd, &ready, 1);
+    (void)written;
+    for (;;) {
+        pause();
+    }
+}
+
+int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return fd;
+}
+
+// 发送一个请求并读完整个响应（依据Content-Length），失败返回false
+bool round_trip(int fd, const std::string& request, std::string& buffer) {
+    if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.size())) {
+        return false;
+    }
+    buffer.clear();
+    size_t needed = std::string::npos;
+    char chunk[4096];
+    while (needed == std::string::npos || buffer.size() < needed) {
+        ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            return false;
+        }
+        buffer.append(chunk, received);
+        if (needed == std::string::npos) {
+            size_t end = buffer.find("\r\n\r\n");
+            if (end == std::string::npos) {
+                continue;
+            }
+            size_t length = buffer.find("Content-Length: ");
+            if (length == std::string::npos || length > end) {
+                return false;
+            }
+            needed = end + 4 + std::strtoul(buffer.c_str() + length + 16, nullptr, 10);
+        }
+    }
+    return true;
+}
+
+// 闭环压测：每个连接发出请求后等待响应再发下一个，直到到达截止时间或总请求数
+uint64_t run_load(int port, const Options& options, std::chrono::steady_clock::time_point deadline, uint64_t max_requests) {
+    std::atomic<uint64_t> completed{0};
+    std::vector<std::thread> clients;
+    const std::string request = "GET " + options.path + " HTTP/1.1\r\nHost: bench\r\n\r\n";
+    for (int i = 0; i < options.connections; ++i) {
+        clients.emplace_back([&]() {
+            int fd = connect_to(port);
+            if (fd < 0) {
+                return;
+            }
+            std::string buffer;
+            while (std::chrono::steady_clock::now() < deadline &&
+                   completed.load(std::memory_order_relaxed) < max_requests) {
+                if (!round_trip(fd, request, buffer)) {
+                    break;
+                }
+                completed.fetch_add(1, std::memory_order_relaxed);
+            }
+            close(fd);
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    return completed.load();
+}
+
+pid_t spawn_server(http::IoBackend backend, int port, bool traced, int& ready_fd) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+        std::perror("pipe");
+        std::exit(1);
+    }
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        run_server(backend, port, fds[1], traced);
+    }
+    close(fds[1]);
+    ready_fd = fds[0];
+    return pid;
+}
+
+bool wait_ready(int ready_fd) {
+    char ready = 0;
+    bool ok = read(ready_fd, &ready, 1) == 1 && ready == 1;
+    close(ready_fd);
+    return ok;
+}
+
+double measure_throughput(http::IoBackend backend, int port, const Options& options) {
+    int ready_fd;
+    pid_t pid = spawn_server(backend, port, false, ready_fd);
+    if (!wait_ready(ready_fd)) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+        return -1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t requests = run_load(port, options, start + std::chrono::seconds(options.seconds), UINT64_MAX);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    return requests / elapsed;
+}
+
+// 跟踪服务器进程的所有线程（PTRACE_O_TRACECLONE），只统计压测窗口内的系统调用入口
+double measure_syscalls(http::IoBackend backend, int port, const Options& options) {
+    int ready_fd;
+    pid_t pid = spawn_server(backend, port, true, ready_fd);
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status)) {
+        return -1;
+    }
+    ptrace(PTRACE_SETOPTIONS, pid, nullptr,
+           PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL);
+    ptrace(PTRACE_SYSCALL, pid, nullptr, nullptr);
+
+    std::atomic<bool> counting{false};
+    std::atomic<uint64_t> syscalls{0};
+    uint64_t requests = 0;
+    bool ready = false;
+
+    // ptrace请求必须由跟踪者线程发出，压测放在单独的线程中
+    std::thread load([&]() {
+        ready = wait_ready(ready_fd);
+        if (ready) {
+            counting.store(true);
+            requests = run_load(port, options, std::chrono::steady_clock::time_point::max(), kTracedRequests);
+            counting.store(false);
+        }
+        kill(pid, SIGKILL);
+    });
+
+    std::unordered_map<pid_t, bool> in_syscall;
+    pid_t tid;
+    while ((tid = waitpid(-1, &status, __WALL)) > 0) {
+        if (!WIFSTOPPED(status)) {
+            continue;
+        }
+        int signal = WSTOPSIG(status);
+        int deliver = 0;
+        if (signal == (SIGTRAP | 0x80)) {
+            bool& inside = in_syscall[tid];
+            if (!inside && counting.load(std::memory_order_relaxed)) {
+                syscalls.fetch_add(1, std::memory_order_relaxed);
+            }
+            inside = !inside;
+        } else if (signal != SIGSTOP && signal != SIGTRAP) {
+            deliver = signal;
+        }
+        ptrace(PTRACE_SYSCALL, tid, nullptr, deliver);
+    }
+    load.join();
+
+    if (!ready || requests == 0) {
+        return -1;
+    }
+    return static_cast<double>(syscalls.load()) / requests;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (argc > 1) {
+        options.connections = std::atoi(argv[1]);
+    }
+    if (argc > 2) {
+        options.seconds = std::atoi(argv[2]);
+    }
+    if (argc > 3) {
+        options.path = argv[3];
+    }
+
+    std::printf("连接数 %d，时长 %ds，路径 %s\n", options.connections, options.seconds, options.path.c_str());
+    std::printf("%-10s %14s %16s\n", "backend", "requests/s", "syscalls/request");
+
+    int port = kBasePort;
+    for (http::IoBackend backend : {http::IoBackend::Epoll, http::IoBackend::IoUring}) {
+        double throughput = measure_throughput(backend, port++, options);
+        if (throughput < 0) {
+            std::printf("%-10s %14s %16s\n", http::io_backend_name(backend), "不可用", "-");
+            continue;
+        }
+        double syscalls = measure_syscalls(backend, port++, options);
+        if (syscalls < 0) {
+            std::printf("%-10s %14.0f %16s\n", http::io_backend_name(backend), throughput, "ptrace不可用");
+        } else {
+            std::printf("%-10s %14.0f %16.2f\n", http::io_backend_name(backend), throughput, syscalls);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,622 @@
+#include "../metrics.hpp"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * HTTP负载生成器
+ * 多线程、每线程一个epoll，连接均分到各线程。两种模式：
+ *   - 闭环（默认）：每个连接收到响应后立即发送下一个请求，测量最大吞吐
+ *   - 开环（--rate）：按固定速率排定请求，与响应无关；延迟从排定时刻算起，
+ *     服务器跟不上时排队时间计入延迟，避免协同遗漏（coordinated omission）
+ * 延迟记录在HDR直方图中，报告吞吐和p50/p90/p99/p999。
+ * --server可先启动本地服务器（如./http_server），等端口可连接后开始压测，结束后终止它。
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    std::string path = "/";
+    int connections = 64;
+    int threads = 0;
+    double duration = 10;
+    double warmup = 1;
+    double rate = 0;             // 每秒请求数，0表示闭环
+    bool keep_alive = true;
+    std::string server;          // 压测前启动的服务器可执行文件
+};
+
+struct Client {
+    enum class State { Idle, Connecting, Sending, Receiving };
+
+    int fd = -1;
+    State state = State::Idle;
+    Clock::time_point intended;  // 请求的排定时刻（闭环为发出时刻）
+    size_t sent = 0;
+    std::string input;
+    size_t head_end = 0;         // 响应头结束位置（含空行），0表示尚未收到完整头部
+    size_t body_needed = 0;      // Content-Length模式下完整响应的长度
+    bool chunked = false;
+    bool until_close = false;    // 既无Content-Length也非chunked，读到EOF为止
+    bool connection_close = false;   // 响应带Connection: close，读完后重连
+    int status = 0;
+};
+
+struct Stats {
+    http::HistogramSnapshot latency;
+    uint64_t completed = 0;
+    uint64_t errors = 0;
+    uint64_t non_2xx = 0;
+    uint64_t bytes = 0;
+    uint64_t max_latency = 0;
+};
+
+enum class ReadStatus { Incomplete, Complete, Error };
+
+std::atomic<bool> interrupted{false};
+
+void on_interrupt(int) {
+    interrupted.store(true);
+}
+
+uint64_t nanos(Clock::duration duration) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+}
+
+bool header_equals(const std::string& head, size_t begin, size_t end, const char* name) {
+    size_t length = std::strlen(name);
+    if (end - begin < length) {
+        return false;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        if (std::tolower(static_cast<unsigned char>(head[begin + i])) != name[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 解析响应头：状态码、Content-Length、Transfer-Encoding: chunked
+bool parse_head(Client& client) {
+    const std::string& in = client.input;
+    if (in.size() < 12 || in.compare(0, 5, "HTTP/") != 0) {
+        return false;
+    }
+    client.status = std::atoi(in.c_str() + 9);
+    client.chunked = false;
+    client.until_close = true;
+    client.connection_close = false;
+    size_t line = in.find("\r\n") + 2;
+    while (line + 2 <= client.head_end - 2) {
+        size_t end = in.find("\r\n", line);
+        size_t colon = in.find(':', line);
+        if (colon != std::string::npos && colon < end) {
+            size_t value = in.find_first_not_of(" \t", colon + 1);
+            if (header_equals(in, line, colon, "content-length")) {
+                client.body_needed = client.head_end + std::strtoull(in.c_str() + value, nullptr, 10);
+                client.until_close = false;
+            } else if (header_equals(in, line, colon, "transfer-encoding") &&
+                       in.compare(value, 7, "chunked") == 0) {
+                client.chunked = true;
+                client.until_close = false;
+            } else if (header_equals(in, line, colon, "connection") &&
+                       header_equals(in, value, end, "close")) {
+                client.connection_close = true;
+            }
+        }
+        line = end + 2;
+    }
+    // 1xx/204/304没有响应体
+    if (client.status < 200 || client.status == 204 || client.status == 304) {
+        client.until_close = false;
+        client.chunked = false;
+        client.body_needed = client.head_end;
+    }
+    return true;
+}
+
+// chunked响应体是否完整（不支持trailer）
+bool chunked_complete(const std::string& in, size_t position) {
+    while (true) {
+        size_t line_end = in.find("\r\n", position);
+        if (line_end == std::string::npos) {
+            return false;
+        }
+        unsigned long long size = std::strtoull(in.c_str() + position, nullptr, 16);
+        if (size == 0) {
+            return in.size() >= line_end + 4;
+        }
+        position = line_end + 2 + size + 2;
+        if (position > in.size()) {
+            return false;
+        }
+    }
+}
+
+ReadStatus check_response(Client& client, bool peer_closed) {
+    if (client.head_end == 0) {
+        size_t end = client.input.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            return peer_closed ? ReadStatus::Error : ReadStatus::Incomplete;
+        }
+        client.head_end = end + 4;
+        if (!parse_head(client)) {
+            return ReadStatus::Error;
+        }
+    }
+    if (client.until_close) {
+        return peer_closed ? ReadStatus::Complete : ReadStatus::Incomplete;
+    }
+    bool complete = client.chunked ? chunked_complete(client.input, client.head_end)
+                                   : client.input.size() >= client.body_needed;
+    if (complete) {
+        return ReadStatus::Complete;
+    }
+    return peer_closed ? ReadStatus::Error : ReadStatus::Incomplete;
+}
+
+class Worker {
+public:
+    Worker(const Options& options, const sockaddr_in& address, int connections, double rate,
+           Clock::time_point measure_start, Clock::time_point end)
+        : options_(options), address_(address), clients_(connections), measure_start_(measure_start), end_(end) {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        request_ = "GET " + options.path + " HTTP/1.1\r\nHost: " + options.host + ":" + std::to_string(options.port) +
+                   "\r\nUser-Agent: load_generator\r\n" + (options.keep_alive ? "" : "Connection: close\r\n") + "\r\n";
+        if (rate > 0) {
+            interval_ = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+        }
+    }
+
+    ~Worker() {
+        for (Client& client : clients_) {
+            if (client.fd >= 0) {
+                close(client.fd);
+            }
+        }
+        close(epoll_fd_);
+    }
+
+    void run() {
+        Clock::time_point now = Clock::now();
+        next_send_ = now;
+        if (!open_loop()) {
+            for (size_t i = 0; i < clients_.size(); ++i) {
+                start_request(i, now);
+            }
+        }
+
+        epoll_event events[256];
+        while ((now = Clock::now()) < end_ && !interrupted.load(std::memory_order_relaxed)) {
+            if (open_loop()) {
+                // 补齐到当前时刻为止所有排定的请求，交给空闲连接
+                while (next_send_ <= now) {
+                    pending_.push_back(next_send_);
+                    next_send_ += interval_;
+                }
+                dispatch_pending(now);
+            }
+            for (size_t index : retry_) {
+                start_request(index, open_loop() ? clients_[index].intended : now);
+            }
+            retry_.clear();
+
+            // 开环的发送间隔常小于1ms，用纳秒精度的epoll_pwait2等到下一个排定时刻，避免空转
+            uint64_t timeout = 100000000;
+            if (open_loop()) {
+                timeout = std::min(timeout, nanos(next_send_ - now));
+            }
+            timespec wait{static_cast<time_t>(timeout / 1000000000), static_cast<long>(timeout % 1000000000)};
+            int count = epoll_pwait2(epoll_fd_, events, 256, &wait, nullptr);
+            for (int i = 0; i < count; ++i) {
+                handle(static_cast<size_t>(events[i].data.u64), events[i].events);
+            }
+        }
+    }
+
+    const Stats& stats() const { return stats_; }
+
+private:
+    const Options& options_;
+    sockaddr_in address_;
+    std::vector<Client> clients_;
+    Clock::time_point measure_start_;
+    Clock::time_point end_;
+    int epoll_fd_;
+    std::string request_;
+    Clock::duration interval_{0};
+    Clock::time_point next_send_;
+    std::deque<Clock::time_point> pending_;
+    std::vector<size_t> retry_;
+    Stats stats_;
+
+    bool open_loop() const { return interval_.count() > 0; }
+
+    void dispatch_pending(Clock::time_point) {
+        for (size_t i = 0; i < clients_.size() && !pending_.empty(); ++i) {
+            if (clients_[i].state == Client::State::Idle) {
+                Clock::time_point intended = pending_.front();
+                pending_.pop_front();
+                start_request(i, intended);
+            }
+        }
+    }
+
+    void watch(size_t index, uint32_t events) {
+        Client& client = clients_[index];
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = index;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, client.fd, &event) < 0) {
+            epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client.fd, &event);
+        }
+    }
+
+    void start_request(size_t index, Clock::time_point intended) {
+        Client& client = clients_[index];
+        client.intended = intended;
+        client.sent = 0;
+        client.input.clear();
+        client.head_end = 0;
+        client.body_needed = 0;
+
+        if (client.fd < 0) {
+            client.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            int nodelay = 1;
+            setsockopt(client.fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+            int result = connect(client.fd, reinterpret_cast<const sockaddr*>(&address_), sizeof(address_));
+            if (result < 0 && errno != EINPROGRESS) {
+                fail(index);
+                return;
+            }
+            client.state = Client::State::Connecting;
+            watch(index, EPOLLOUT);
+            return;
+        }
+        client.state = Client::State::Sending;
+        send_request(index);
+    }
+
+    void send_request(size_t index) {
+        Client& client = clients_[index];
+        while (client.sent < request_.size()) {
+            ssize_t sent = send(client.fd, request_.data() + client.sent, request_.size() - client.sent, MSG_NOSIGNAL);
+            if (sent > 0) {
+                client.sent += sent;
+                continue;
+            }
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                watch(index, EPOLLOUT);
+                return;
+            }
+            fail(index);
+            return;
+        }
+        client.state = Client::State::Receiving;
+        watch(index, EPOLLIN);
+    }
+
+    void handle(size_t index, uint32_t events) {
+        Client& client = clients_[index];
+        if (client.state == Client::State::Connecting) {
+            int error = 0;
+            socklen_t length = sizeof(error);
+            getsockopt(client.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error != 0 || (events & EPOLLERR)) {
+                fail(index);
+                return;
+            }
+            client.state = Client::State::Sending;
+            send_request(index);
+            return;
+        }
+        if (client.state == Client::State::Sending) {
+            send_request(index);
+            return;
+        }
+        if (client.state == Client::State::Receiving) {
+            receive(index);
+        }
+    }
+
+    void receive(size_t index) {
+        Client& client = clients_[index];
+        char buffer[16384];
+        bool peer_closed = false;
+        while (true) {
+            ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+            if (received > 0) {
+                client.input.append(buffer, received);
+                continue;
+            }
+            if (received == 0) {
+                peer_closed = true;
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            fail(index);
+            return;
+        }
+
+        switch (check_response(client, peer_closed)) {
+            case ReadStatus::Incomplete:
+                return;
+            case ReadStatus::Error:
+                fail(index);
+                return;
+            case ReadStatus::Complete:
+                break;
+        }
+
+        Clock::time_point now = Clock::now();
+        if (now >= measure_start_) {
+            uint64_t latency = nanos(now - std::max(client.intended, measure_start_));
+            stats_.latency.record(latency);
+            stats_.max_latency = std::max(stats_.max_latency, latency);
+            ++stats_.completed;
+            stats_.bytes += client.input.size();
+            if (client.status < 200 || client.status >= 300) {
+                ++stats_.non_2xx;
+            }
+        }
+        if (!options_.keep_alive || peer_closed || client.until_close || client.connection_close) {
+            close_client(client);
+        }
+        finish(index, now);
+    }
+
+    void close_client(Client& client) {
+        if (client.fd >= 0) {
+            close(client.fd);
+            client.fd = -1;
+        }
+    }
+
+    void fail(size_t index) {
+        Client& client = clients_[index];
+        if (Clock::now() >= measure_start_) {
+            ++stats_.errors;
+        }
+        close_client(client);
+        client.state = Client::State::Idle;
+        // 连接失败时不在本轮立即重试，避免服务器不可用时空转
+        retry_.push_back(index);
+    }
+
+    void finish(size_t index, Clock::time_point now) {
+        Client& client = clients_[index];
+        client.state = Client::State::Idle;
+        if (client.fd >= 0) {
+            watch(index, 0);
+        }
+        if (!open_loop()) {
+            start_request(index, now);
+        } else if (!pending_.empty()) {
+            Clock::time_point intended = pending_.front();
+            pending_.pop_front();
+            start_request(index, intended);
+        }
+    }
+};
+
+bool wait_for_port(const sockaddr_in& address, pid_t server, std::chrono::seconds timeout) {
+    auto deadline = Clock::now() + timeout;
+    while (Clock::now() < deadline) {
+        // 服务器进程提前退出（如端口被占用）时不必等到超时
+        if (waitpid(server, nullptr, WNOHANG) == server) {
+            return false;
+        }
+        int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool connected = connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        close(fd);
+        if (connected) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return false;
+}
+
+pid_t spawn_server(const std::string& path) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        if (null_fd >= 0) {
+            dup2(null_fd, STDOUT_FILENO);
+            close(null_fd);
+        }
+        execl(path.c_str(), path.c_str(), static_cast<char*>(nullptr));
+        std::perror("execl");
+        _exit(127);
+    }
+    return pid;
+}
+
+void print_usage(const char* program) {
+    std::printf(
+        "用法: %s [选项]\n"
+        "  -H, --host ADDR         目标地址（IPv4），默认127.0.0.1\n"
+        "  -p, --port PORT         目标端口，默认8080\n"
+        "  -u, --path PATH         请求路径，默认/\n"
+        "  -c, --connections N     并发连接数，默认64\n"
+        "  -t, --threads N         线程数，默认min(连接数, 硬件并发数)\n"
+        "  -d, --duration SEC      压测时长（不含预热），默认10\n"
+        "  -w, --warmup SEC        预热时长，期间的请求不计入结果，默认1\n"
+        "  -r, --rate RPS          开环模式的总请求速率，默认0（闭环）\n"
+        "  -k, --keep-alive on|off 是否复用连接，默认on\n"
+        "  -s, --server PATH       先启动本地服务器，压测结束后终止\n",
+        program);
+}
+
+bool parse_options(int argc, char* argv[], Options& options) {
+    static const option kLongOptions[] = {
+        {"host", required_argument, nullptr, 'H'},
+        {"port", required_argument, nullptr, 'p'},
+        {"path", required_argument, nullptr, 'u'},
+        {"connections", required_argument, nullptr, 'c'},
+        {"threads", required_argument, nullptr, 't'},
+        {"duration", required_argument, nullptr, 'd'},
+        {"warmup", required_argument, nullptr, 'w'},
+        {"rate", required_argument, nullptr, 'r'},
+        {"keep-alive", required_argument, nullptr, 'k'},
+        {"server", required_argument, nullptr, 's'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0},
+    };
+    int option;
+    while ((option = getopt_long(argc, argv, "H:p:u:c:t:d:w:r:k:s:h", kLongOptions, nullptr)) != -1) {
+        switch (option) {
+            case 'H': options.host = optarg; break;
+            case 'p': options.port = std::atoi(optarg); break;
+            case 'u': options.path = optarg; break;
+            case 'c': options.connections = std::atoi(optarg); break;
+            case 't': options.threads = std::atoi(optarg); break;
+            case 'd': options.duration = std::atof(optarg); break;
+            case 'w': options.warmup = std::atof(optarg); break;
+            case 'r': options.rate = std::atof(optarg); break;
+            case 'k': options.keep_alive = std::strcmp(optarg, "off") != 0 && std::strcmp(optarg, "0") != 0; break;
+            case 's': options.server = optarg; break;
+            default: return false;
+        }
+    }
+    if (options.connections <= 0 || options.duration <= 0 || options.warmup < 0 || options.rate < 0) {
+        return false;
+    }
+    if (options.threads <= 0) {
+        options.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    }
+    options.threads = std::min(options.threads, options.connections);
+    return true;
+}
+
+void print_latency(const char* label, uint64_t nanoseconds) {
+    std::printf("  %-6s %10.3f ms\n", label, static_cast<double>(nanoseconds) / 1e6);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1) {
+        std::fprintf(stderr, "无效的地址: %s\n", options.host.c_str());
+        return 2;
+    }
+
+    pid_t server = -1;
+    if (!options.server.empty()) {
+        server = spawn_server(options.server);
+        if (server < 0 || !wait_for_port(address, server, std::chrono::seconds(5))) {
+            std::fprintf(stderr, "服务器未能在5秒内开始监听 %s:%d\n", options.host.c_str(), options.port);
+            if (server > 0 && kill(server, SIGKILL) == 0) {
+                waitpid(server, nullptr, 0);
+            }
+            return 1;
+        }
+    }
+
+    std::signal(SIGINT, on_interrupt);
+    std::printf("目标 http://%s:%d%s，%s，%d个连接，%d个线程，keep-alive %s，时长%.1fs（预热%.1fs）\n",
+                options.host.c_str(), options.port, options.path.c_str(),
+                options.rate > 0 ? "开环" : "闭环", options.connections, options.threads,
+                options.keep_alive ? "开" : "关", options.duration, options.warmup);
+    if (options.rate > 0) {
+        std::printf("目标速率 %.0f req/s\n", options.rate);
+    }
+
+    Clock::time_point start = Clock::now();
+    Clock::time_point measure_start = start + std::chrono::duration_cast<Clock::duration>(
+                                                  std::chrono::duration<double>(options.warmup));
+    Clock::time_point end = measure_start + std::chrono::duration_cast<Clock::duration>(
+                                                std::chrono::duration<double>(options.duration));
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (int i = 0; i < options.threads; ++i) {
+        // 连接和速率尽量均分到各线程
+        int connections = options.connections / options.threads + (i < options.connections % options.threads ? 1 : 0);
+        workers.push_back(std::make_unique<Worker>(options, address, connections, options.rate / options.threads,
+                                                   measure_start, end));
+    }
+    std::vector<std::thread> threads;
+    for (auto& worker : workers) {
+        threads.emplace_back([&worker]() { worker->run(); });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::min(Clock::now(), end) - measure_start).count();
+
+    Stats total;
+    for (auto& worker : workers) {
+        const Stats& stats = worker->stats();
+        total.latency.merge(stats.latency);
+        total.completed += stats.completed;
+        total.errors += stats.errors;
+        total.non_2xx += stats.non_2xx;
+        total.bytes += stats.bytes;
+        total.max_latency = std::max(total.max_latency, stats.max_latency);
+    }
+
+    if (server > 0) {
+        kill(server, SIGTERM);
+        waitpid(server, nullptr, 0);
+    }
+
+    if (elapsed <= 0) {
+        std::printf("压测在预热阶段被中断\n");
+        return 1;
+    }
+    std::printf("请求 %llu，错误 %llu，非2xx %llu\n", static_cast<unsigned long long>(total.completed),
+                static_cast<unsigned long long>(total.errors), static_cast<unsigned long long>(total.non_2xx));
+    std::printf("吞吐 %.0f req/s，%.2f MB/s\n", total.completed / elapsed, total.bytes / elapsed / (1024 * 1024));
+    std::printf("延迟%s\n", options.rate > 0 ? "（从排定时刻算起）" : "");
+    if (total.latency.count > 0) {
+        // 分位数取所在桶的上界，可能略大于实际最大值
+        print_latency("mean", total.latency.sum / total.latency.count);
+        print_latency("p50", std::min(total.latency.quantile(0.5), total.max_latency));
+        print_latency("p90", std::min(total.latency.quantile(0.9), total.max_latency));
+        print_latency("p99", std::min(total.latency.quantile(0.99), total.max_latency));
+        print_latency("p999", std::min(total.latency.quantile(0.999), total.max_latency));
+        print_latency("max", total.max_latency);
+    }
+    return total.errors > 0 && total.completed == 0 ? 1 : 0;
+}
@@ -0,0 +1,198 @@
+#include "../middleware.hpp"
+#include "../arena.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <vector>
+
+/**
+ * 中间件微基准
+ * 同样的三个中间件（计数、检查请求头、设置状态）分别以手写内联、编译期链、运行时链
+ * 以及逐层用std::function包装next的朴素写法组合，对比每个请求的耗时和分配次数。
+ * 响应分配在请求arena中，分配次数只反映中间件机制本身。
+ */
+
+namespace {
+
+std::atomic<size_t> allocation_count{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+size_t requests_seen = 0;
+
+struct CountRequests {
+    template <typename Next>
+    http::Response operator()(const http::Request& request, const Next& next) const {
+        ++requests_seen;
+        return next(request);
+    }
+};
+
+struct RequireHost {
+    template <typename Next>
+    http::Response operator()(const http::Request& request, const Next& next) const {
+        if (!request.find_header(http::HeaderId::Host)) {
+            http::Response response;
+            response.status_code = 400;
+            return response;
+        }
+        return next(request);
+    }
+};
+
+struct MarkAccepted {
+    template <typename Next>
+    http::Response operator()(const http::Request& request, const Next& next) const {
+        http::Response response = next(request);
+        if (response.status_code == 200) {
+            response.status_code = 202;
+        }
+        return response;
+    }
+};
+
+http::Response handle(const http::Request&) {
+    return http::Response();
+}
+
+// 三个中间件的逻辑直接写在处理器中，作为对照
+http::Response handle_inline(const http::Request& request) {
+    ++requests_seen;
+    bool has_host = request.find_header(http::HeaderId::Host) != nullptr;
+    http::Response response = has_host ? handle(request) : http::Response();
+    if (!has_host) {
+        response.status_code = 400;
+    } else if (response.status_code == 200) {
+        response.status_code = 202;
+    }
+    return response;
+}
+
+// 朴素写法：每一层为下一环构造一个std::function，链的组合在每个请求上重新发生
+using NaiveNext = std::function<http::Response(const http::Request&)>;
+using NaiveMiddleware = std::function<http::Response(const http::Request&, const NaiveNext&)>;
+
+http::Response run_naive(const std::vector<NaiveMiddleware>& chain, size_t index, const http::Request& request,
+                         const NaiveNext& handler) {
+    if (index == chain.size()) {
+        return handler(request);
+    }
+    // 捕获三个值已超过std::function的内部缓冲，每层一次分配
+    NaiveNext next = [&chain, index, &handler](const http::Request& next_request) {
+        return run_naive(chain, index + 1, next_request, handler);
+    };
+    return chain[index](request, next);
+}
+
+template <typename Fn>
+void run(const char* name, size_t iterations, http::RequestArena& arena, Fn&& fn) {
+    auto once = [&]() {
+        {
+            http::MemoryResourceScope scope(&arena);
+            fn();
+        }
+        arena.reset();
+    };
+    // 预热
+    for (size_t i = 0; i < iterations / 10; ++i) {
+        once();
+    }
+
+    size_t allocations_before = allocation_count.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        once();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    size_t allocations = allocation_count.load() - allocations_before;
+
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    std::printf("%-36s %10.1f ns/op %8.2f allocs/op\n", name, ns,
+                static_cast<double>(allocations) / iterations);
+}
+
+volatile int sink = 0;
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+
+    http::Request request;
+    request.method = "GET";
+    request.path = "/api";
+    request.headers.add("Host", "localhost:8080");
+    http::RequestArena arena;
+
+    // 与服务器中一样，处理器经由一次RequestHandler调用
+    http::RequestHandler plain = handle;
+    run("handler only", iterations, arena, [&]() {
+        sink = sink + plain(request).status_code;
+    });
+
+    http::RequestHandler inlined = handle_inline;
+    run("hand-inlined in handler", iterations, arena, [&]() {
+        sink = sink + inlined(request).status_code;
+    });
+
+    http::RequestHandler composed =
+        http::make_middleware(CountRequests{}, RequireHost{}, MarkAccepted{}).wrap(handle);
+    run("MiddlewareChain (compile-time)", iterations, arena, [&]() {
+        sink = sink + composed(request).status_code;
+    });
+
+    http::MiddlewareStack stack;
+    stack.add(CountRequests{});
+    stack.add(RequireHost{});
+    stack.add(MarkAccepted{});
+    http::RequestHandler layered = stack.wrap(handle);
+    run("MiddlewareStack (runtime)", iterations, arena, [&]() {
+        sink = sink + layered(request).status_code;
+    });
+
+    std::vector<NaiveMiddleware> naive{CountRequests{}, RequireHost{}, MarkAccepted{}};
+    NaiveNext naive_handler = handle;
+    run("nested std::function per request", iterations, arena, [&]() {
+        sink = sink + run_naive(naive, 0, request, naive_handler).status_code;
+    });
+
+    return requests_seen == 0;
+}
@@ -0,0 +1,172 @@
+#include "../http_server.hpp"
+#include "../request_parser.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+
+/**
+ * 请求解析微基准
+ * 对比重构前基于istringstream的解析器与增量解析器的耗时和每请求分配次数，
+ * 以及构造Request时使用堆和请求级arena的差别
+ */
+
+namespace {
+
+std::atomic<size_t> allocation_count{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// std::pmr::new_delete_resource走带对齐参数的版本，同样计数
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+const char kSampleRequest[] =
+    "GET /json?pretty=1 HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "\r\n";
+
+// 重构前 HttpServer::parse_request 的实现，仅作为基准对照
+http::Request legacy_parse_request(const std::string& raw_request) {
+    http::Request request;
+    std::istringstream iss(raw_request);
+    std::string line;
+
+    if (std::getline(iss, line)) {
+        std::istringstream request_line(line);
+        request_line >> request.method >> request.path >> request.version;
+    }
+
+    while (std::getline(iss, line) && line != "\r") {
+        if (line.back() == '\r') {
+            line.pop_back();
+        }
+
+        auto colon_pos = line.find(':');
+        if (colon_pos != std::string::npos) {
+            std::string key = line.substr(0, colon_pos);
+            std::string value = line.substr(colon_pos + 1);
+
+            key.erase(0, key.find_first_not_of(' '));
+            key.erase(key.find_last_not_of(' ') + 1);
+            value.erase(0, value.find_first_not_of(' '));
+            value.erase(value.find_last_not_of(' ') + 1);
+
+            request.headers[std::pmr::string(key)] = value;
+        }
+    }
+
+    std::string remaining_content;
+    std::string body_line;
+    while (std::getline(iss, body_line)) {
+        remaining_content += body_line + "\n";
+    }
+    request.body = remaining_content;
+
+    return request;
+}
+
+template <typename Fn>
+void run(const char* name, size_t iterations, Fn&& fn) {
+    // 预热
+    for (size_t i = 0; i < iterations / 10; ++i) {
+        fn();
+    }
+
+    size_t allocations_before = allocation_count.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    size_t allocations = allocation_count.load() - allocations_before;
+
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    std::printf("%-36s %10.1f ns/op %8.2f allocs/op\n", name, ns,
+                static_cast<double>(allocations) / iterations);
+}
+
+volatile size_t sink = 0;
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    std::string_view raw(kSampleRequest, sizeof(kSampleRequest) - 1);
+
+    run("legacy parse_request (istringstream)", iterations, [&]() {
+        // 旧实现先把接收缓冲区复制为std::string
+        std::string copy(raw);
+        http::Request request = legacy_parse_request(copy);
+        sink = sink + request.headers.size();
+    });
+
+    http::RequestParser parser;
+    run("RequestParser::parse (string_view)", iterations, [&]() {
+        parser.reset();
+        parser.parse(raw);
+        sink = sink + parser.header_count();
+    });
+
+    run("RequestParser + make_request (heap)", iterations, [&]() {
+        parser.reset();
+        parser.parse(raw);
+        http::Request request = http::make_request(parser, std::string_view(), std::pmr::get_default_resource());
+        sink = sink + request.headers.size();
+    });
+
+    // 连接在请求之间回收arena，块来自线程本地缓冲池，稳定状态下不再调用malloc
+    http::RequestArena arena;
+    run("RequestParser + make_request (arena)", iterations, [&]() {
+        parser.reset();
+        parser.parse(raw);
+        {
+            http::Request request = http::make_request(parser, std::string_view(), &arena);
+            sink = sink + request.headers.size();
+        }
+        arena.reset();
+    });
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include "../http_server.hpp"
+#include "../static_response.hpp"
+#include "../templates.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+/**
+ * 响应序列化微基准
+ * 对比Response::to_string、写入连接复用缓冲区的write_head，
+ * 以及静态路由直接选择预生成报文（含304）的耗时和每次分配次数；
+ * 最后对比处理器在堆上和在请求级arena中构造Response的分配次数
+ */
+
+namespace {
+
+std::atomic<size_t> allocation_count{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// std::pmr::new_delete_resource走带对齐参数的版本，同样计数
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+template <typename Fn>
+void run(const char* name, size_t iterations, Fn&& fn) {
+    // 预热
+    for (size_t i = 0; i < iterations / 10; ++i) {
+        fn();
+    }
+
+    size_t allocations_before = allocation_count.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    size_t allocations = allocation_count.load() - allocations_before;
+
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    std::printf("%-40s %10.1f ns/op %8.2f allocs/op\n", name, ns,
+                static_cast<double>(allocations) / iterations);
+}
+
+volatile size_t sink = 0;
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500000;
+
+    http::Response json;
+    json.headers["Content-Type"] = "application/json; charset=utf-8";
+    json.headers["Cache-Control"] = "no-cache";
+    json.body = templates::get_json_response();
+
+    run("Response::to_string (json)", iterations, [&]() {
+        std::string message = json.to_string();
+        sink = sink + message.size();
+    });
+
+    // 连接在请求之间复用头部缓冲区，响应体移交而不复制
+    std::string head;
+    head.reserve(512);
+    run("Response::write_head (reused buffer)", iterations, [&]() {
+        head.clear();
+        json.write_head(head, "keep-alive");
+        sink = sink + head.size();
+    });
+
+    http::Response page;
+    page.headers["Content-Type"] = "text/html; charset=utf-8";
+    page.body = templates::get_home_page();
+    run("Response::to_string (home page)", iterations, [&]() {
+        std::string message = page.to_string();
+        sink = sink + message.size();
+    });
+
+    http::StaticResponse home(page);
+    http::Request request;
+    request.method = "GET";
+    request.path = "/";
+    request.version = "HTTP/1.1";
+    request.headers["Accept-Encoding"] = "gzip, deflate, br";
+    run("StaticResponse::select (gzip)", iterations, [&]() {
+        sink = sink + home.select(request, true)->size();
+    });
+
+    request.headers["If-None-Match"] = home.etag();
+    request.headers.erase("Accept-Encoding");
+    run("StaticResponse::select (304)", iterations, [&]() {
+        sink = sink + home.select(request, true)->size();
+    });
+
+    // 模拟/json处理器：构造响应并序列化头部，arena在请求之间整体回收
+    const std::string json_body = templates::get_json_response();
+    auto build_response = [&]() {
+        http::Response response;
+        response.headers["Content-Type"] = "application/json; charset=utf-8";
+        response.headers["Cache-Control"] = "no-cache";
+        response.body = json_body;
+        head.clear();
+        response.write_head(head, "keep-alive");
+        sink = sink + head.size() + response.body.size();
+    };
+    run("Response build + write_head (heap)", iterations, build_response);
+
+    http::RequestArena arena;
+    run("Response build + write_head (arena)", iterations, [&]() {
+        {
+            http::MemoryResourceScope scope(&arena);
+            build_response();
+        }
+        arena.reset();
+    });
+
+    return 0;
+}
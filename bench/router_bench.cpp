@@ -0,0 +1,127 @@
+#include "../router.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * 路由查找微基准
+ * 对比重构前"方法 + 空格 + 路径"拼接键的哈希表查找与前缀树查找，
+ * 路由表包含数百条静态路由及少量参数/通配路由
+ */
+
+namespace {
+
+std::atomic<size_t> allocation_count{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+template <typename Fn>
+void run(const char* name, size_t iterations, Fn&& fn) {
+    // 预热
+    for (size_t i = 0; i < iterations / 10; ++i) {
+        fn(i);
+    }
+
+    size_t allocations_before = allocation_count.load();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        fn(i);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    size_t allocations = allocation_count.load() - allocations_before;
+
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+    std::printf("%-40s %10.1f ns/op %8.2f allocs/op\n", name, ns,
+                static_cast<double>(allocations) / iterations);
+}
+
+// 重构前 HttpServer::create_handler_key 的实现
+std::string create_handler_key(const std::string& method, const std::string& path) {
+    return method + " " + path;
+}
+
+volatile size_t sink = 0;
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    constexpr int kResources = 150;
+
+    // 两张表注册相同的静态路由；前缀树额外注册参数和通配路由
+    std::unordered_map<std::string, int> handlers;
+    http::Router<int> router;
+    std::vector<std::string> static_paths;
+    int id = 0;
+    for (int i = 0; i < kResources; ++i) {
+        for (const char* suffix : {"", "/items"}) {
+            std::string path = "/api/v1/resource" + std::to_string(i) + suffix;
+            handlers[create_handler_key("GET", path)] = id;
+            router.add("GET", path) = id;
+            static_paths.push_back(path);
+            ++id;
+        }
+        router.add("GET", "/api/v1/resource" + std::to_string(i) + "/items/:item") = id++;
+    }
+    router.add("POST", "/api/v1/users/:id/posts") = id++;
+    router.add("GET", "/static/*path") = id++;
+    std::printf("路由数量: 哈希表 %zu, 前缀树 %zu\n", handlers.size(), router.size());
+
+    std::vector<std::string> param_paths;
+    for (int i = 0; i < kResources; ++i) {
+        param_paths.push_back("/api/v1/resource" + std::to_string(i) + "/items/" + std::to_string(i * 7));
+    }
+
+    const std::string method = "GET";
+    run("unordered_map + create_handler_key", iterations, [&](size_t i) {
+        auto it = handlers.find(create_handler_key(method, static_paths[i % static_paths.size()]));
+        sink = sink + (it != handlers.end() ? it->second : 0);
+    });
+
+    http::PathParams params;
+    run("Router::find (static)", iterations, [&](size_t i) {
+        const int* value = router.find(method, static_paths[i % static_paths.size()], params);
+        sink = sink + (value ? *value : 0);
+    });
+
+    run("Router::find (:param)", iterations, [&](size_t i) {
+        const int* value = router.find(method, param_paths[i % param_paths.size()], params);
+        sink = sink + (value ? *value + params.count : 0);
+    });
+
+    const std::string asset = "/static/css/site/main.css";
+    run("Router::find (*wildcard)", iterations, [&](size_t) {
+        const int* value = router.find(method, asset, params);
+        sink = sink + (value ? *value + params.items[0].length : 0);
+    });
+
+    const std::string missing = "/api/v1/resource42/unknown";
+    run("Router::find (miss)", iterations, [&](size_t) {
+        sink = sink + (router.find(method, missing, params) ? 1 : 0);
+    });
+
+    return 0;
+}
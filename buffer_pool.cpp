@@ -0,0 +1,96 @@
+#include "buffer_pool.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace http {
+
+BufferPool& BufferPool::local() {
+    thread_local BufferPool pool;
+    return pool;
+}
+
+BufferPool::~BufferPool() {
+    for (char* block : free_blocks_) {
+        delete[] block;
+    }
+}
+
+char* BufferPool::acquire() {
+    if (free_blocks_.empty()) {
+        return new char[kBlockSize];
+    }
+    char* block = free_blocks_.back();
+    free_blocks_.pop_back();
+    return block;
+}
+
+void BufferPool::release(char* block) {
+    if (free_blocks_.size() >= kMaxCachedBlocks) {
+        delete[] block;
+        return;
+    }
+    free_blocks_.push_back(block);
+}
+
+Buffer::~Buffer() {
+    // 析构可能发生在任意线程，直接释放而不归还线程本地池
+    delete[] data_;
+}
+
+char* Buffer::prepare(size_t min_writable) {
+    if (data_ == nullptr) {
+        data_ = BufferPool::local().acquire();
+        capacity_ = BufferPool::kBlockSize;
+        begin_ = end_ = 0;
+    }
+
+    if (writable() >= min_writable) {
+        return data_ + end_;
+    }
+
+    // 先把未处理数据移到开头
+    size_t used = size();
+    if (begin_ > 0) {
+        std::memmove(data_, data_ + begin_, used);
+        begin_ = 0;
+        end_ = used;
+        if (writable() >= min_writable) {
+            return data_ + end_;
+        }
+    }
+
+    size_t new_capacity = std::max(capacity_ * 2, used + min_writable);
+    char* new_data = new char[new_capacity];
+    std::memcpy(new_data, data_, used);
+    free_storage();
+    data_ = new_data;
+    capacity_ = new_capacity;
+    return data_ + end_;
+}
+
+void Buffer::consume(size_t n) {
+    begin_ += std::min(n, size());
+    if (begin_ == end_) {
+        begin_ = end_ = 0;
+    }
+}
+
+void Buffer::release() {
+    free_storage();
+    data_ = nullptr;
+    capacity_ = 0;
+    begin_ = end_ = 0;
+}
+
+void Buffer::free_storage() {
+    if (data_ == nullptr) {
+        return;
+    }
+    if (capacity_ == BufferPool::kBlockSize) {
+        BufferPool::local().release(data_);
+    } else {
+        delete[] data_;
+    }
+}
+
+} // namespace http
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace http {
+
+/**
+ * 线程本地的I/O缓冲块池
+ * 只缓存固定大小（kBlockSize）的块，空闲连接归还后由其他连接复用
+ */
+class BufferPool {
+public:
+    static constexpr size_t kBlockSize = 16 * 1024;
+    static constexpr size_t kMaxCachedBlocks = 1024;
+
+    // 当前线程的缓冲池
+    static BufferPool& local();
+
+    char* acquire();
+    void release(char* block);
+
+    size_t cached() const { return free_blocks_.size(); }
+
+    ~BufferPool();
+
+private:
+    BufferPool() = default;
+    std::vector<char*> free_blocks_;
+};
+
+/**
+ * 可增长的接收缓冲区
+ * [begin, end)为未处理数据，consume()只移动读指针，空间不足时先整理再扩容。
+ * 底层存储按需从BufferPool获取，release()后归还，因此空闲连接不占用缓冲区。
+ */
+class Buffer {
+public:
+    Buffer() = default;
+    ~Buffer();
+
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+
+    std::string_view readable() const { return std::string_view(data_ + begin_, end_ - begin_); }
+    size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+    size_t writable() const { return capacity_ - end_; }
+    size_t capacity() const { return capacity_; }
+
+    // 确保至少有min_writable字节的可写空间，返回写入位置
+    char* prepare(size_t min_writable);
+
+    // 提交已写入的n个字节
+    void commit(size_t n) { end_ += n; }
+
+    // 丢弃前n个未处理字节
+    void consume(size_t n);
+
+    // 清空数据并将存储归还当前线程的缓冲池（必须在使用该缓冲池的线程调用）
+    void release();
+
+private:
+    char* data_ = nullptr;
+    size_t capacity_ = 0;
+    size_t begin_ = 0;
+    size_t end_ = 0;
+
+    void free_storage();
+};
+
+} // namespace http
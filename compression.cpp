@@ -0,0 +1,127 @@
+#include "compression.hpp"
+#include "request_parser.hpp"
+#include <zlib.h>
+#include <cstdlib>
+
+namespace http {
+
+namespace {
+
+// 解析";q=0.5"形式的参数，缺省为1
+double parse_quality(std::string_view params) {
+    while (!params.empty()) {
+        size_t semicolon = params.find(';');
+        std::string_view param = trim_whitespace(params.substr(0, semicolon));
+        if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+            std::string value(param.substr(2));
+            return std::strtod(value.c_str(), nullptr);
+        }
+        if (semicolon == std::string_view::npos) {
+            break;
+        }
+        params.remove_prefix(semicolon + 1);
+    }
+    return 1.0;
+}
+
+} // namespace
+
+const char* encoding_name(ContentEncoding encoding) {
+    switch (encoding) {
+        case ContentEncoding::Gzip:    return "gzip";
+        case ContentEncoding::Deflate: return "deflate";
+        default:                       return nullptr;
+    }
+}
+
+ContentEncoding negotiate_encoding(std::string_view accept_encoding) {
+    double gzip_q = -1;
+    double deflate_q = -1;
+    double identity_q = -1;
+    double wildcard_q = -1;
+
+    while (!accept_encoding.empty()) {
+        size_t comma = accept_encoding.find(',');
+        std::string_view item = trim_whitespace(accept_encoding.substr(0, comma));
+        size_t semicolon = item.find(';');
+        std::string_view coding = trim_whitespace(item.substr(0, semicolon));
+        double q = semicolon == std::string_view::npos ? 1.0 : parse_quality(item.substr(semicolon + 1));
+
+        if (iequals(coding, "gzip") || iequals(coding, "x-gzip")) {
+            gzip_q = q;
+        } else if (iequals(coding, "deflate")) {
+            deflate_q = q;
+        } else if (iequals(coding, "identity")) {
+            identity_q = q;
+        } else if (coding == "*") {
+            wildcard_q = q;
+        }
+
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        accept_encoding.remove_prefix(comma + 1);
+    }
+
+    // 未显式列出的编码取通配符的q值
+    if (gzip_q < 0) {
+        gzip_q = wildcard_q < 0 ? 0 : wildcard_q;
+    }
+    if (deflate_q < 0) {
+        deflate_q = wildcard_q < 0 ? 0 : wildcard_q;
+    }
+    if (identity_q < 0) {
+        identity_q = 1;
+    }
+
+    if (gzip_q > 0 && gzip_q >= deflate_q && gzip_q >= identity_q) {
+        return ContentEncoding::Gzip;
+    }
+    if (deflate_q > 0 && deflate_q >= identity_q) {
+        return ContentEncoding::Deflate;
+    }
+    return ContentEncoding::Identity;
+}
+
+bool is_compressible_type(std::string_view content_type) {
+    size_t semicolon = content_type.find(';');
+    std::string_view type = trim_whitespace(content_type.substr(0, semicolon));
+    if (type.size() >= 5 && iequals(type.substr(0, 5), "text/")) {
+        return true;
+    }
+    return iequals(type, "application/json") || iequals(type, "application/javascript") ||
+           iequals(type, "application/xml") || iequals(type, "image/svg+xml");
+}
+
+bool compress_body(std::string_view input, ContentEncoding encoding, std::string& output, int level) {
+    if (encoding == ContentEncoding::Identity) {
+        return false;
+    }
+
+    // HTTP的deflate是带zlib头的格式，gzip在windowBits上加16
+    int window_bits = encoding == ContentEncoding::Gzip ? 15 + 16 : 15;
+
+    z_stream stream{};
+    if (deflateInit2(&stream, level, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    output.resize(deflateBound(&stream, input.size()) + 32);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>(output.data());
+    stream.avail_out = static_cast<uInt>(output.size());
+
+    int result = deflate(&stream, Z_FINISH);
+    size_t written = stream.total_out;
+    deflateEnd(&stream);
+
+    if (result != Z_STREAM_END) {
+        output.clear();
+        return false;
+    }
+    output.resize(written);
+    return true;
+}
+
+} // namespace http
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace http {
+
+enum class ContentEncoding {
+    Identity = 0,
+    Gzip = 1,
+    Deflate = 2
+};
+
+constexpr int kContentEncodingCount = 3;
+
+// 预压缩只做一次，使用最高压缩级别；动态压缩使用默认级别
+constexpr int kBestCompressionLevel = 9;
+constexpr int kDefaultCompressionLevel = 6;
+
+// Content-Encoding头的取值，Identity返回nullptr
+const char* encoding_name(ContentEncoding encoding);
+
+/**
+ * 根据Accept-Encoding选择响应编码
+ * 按q值选择gzip/deflate中最优者；q值相同时优先压缩编码，
+ * 客户端未声明或全部不可接受时返回Identity
+ */
+ContentEncoding negotiate_encoding(std::string_view accept_encoding);
+
+// 该Content-Type是否值得压缩（文本、JSON、JavaScript、XML、SVG）
+bool is_compressible_type(std::string_view content_type);
+
+// 使用zlib压缩，失败时返回false
+bool compress_body(std::string_view input, ContentEncoding encoding, std::string& output, int level = kDefaultCompressionLevel);
+
+} // namespace http
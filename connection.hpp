@@ -0,0 +1,138 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <memory>
+#include <new>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "http_server.hpp"
+#include "http2.hpp"
+#include "request_parser.hpp"
+#include "buffer_pool.hpp"
+#include "arena.hpp"
+#include "timing_wheel.hpp"
+
+namespace http {
+
+class EventLoop;
+
+/**
+ * 流式响应的发送状态
+ * 处理器写入的数据（已按分块编码）先积累在pending中，当前一批发送完毕后整批
+ * 换入output_head继续发送，两块缓冲区交替使用，容量在响应之间复用
+ */
+struct ResponseStream {
+    bool active = false;        // 头部已开始发送，响应尚未结束
+    bool chunked = false;       // 以Transfer-Encoding: chunked编码
+    bool discard = false;       // 没有响应体（HEAD请求或204/304），写入的数据被丢弃
+    bool finished = false;      // 处理器已返回，pending中已包含结束块
+    bool idle = false;          // 已发送完所有数据，等待处理器继续写入
+    bool has_length = false;    // 处理器声明了Content-Length
+    uint64_t remaining = 0;     // 声明了Content-Length时尚未写入的字节数
+    std::string pending;        // 等待发送的下一批数据
+    std::coroutine_handle<> waiting;    // 因pending超出上限而挂起的处理器
+};
+
+/**
+ * 客户端连接状态
+ * 每个连接是一个由事件驱动的状态机：读取 -> 处理 -> 写出 -> 读取(keep-alive) / 关闭
+ * HTTP/2连接上的多个请求并发处理，连接本身不再经过处理和写出状态
+ */
+struct Connection : std::enable_shared_from_this<Connection> {
+    enum class State {
+        Reading,     // 等待并读取请求
+        Processing,  // 请求已完整，正在执行处理器
+        Writing,     // 正在发送响应
+        Closed       // 已关闭
+    };
+
+    int fd;
+    EventLoop* loop;
+    State state = State::Reading;
+
+    // 请求、响应及其头部和响应体分配在这里，响应发送完毕后整体回收；
+    // 须声明在使用它的成员之前，保证最后析构
+    RequestArena arena;
+
+    Buffer input;               // 已接收但尚未处理的数据
+    RequestParser parser;       // 针对input的增量解析状态
+
+    // 请求体读取状态（头部解析完成后）
+    bool reading_body = false;
+    bool chunked_body = false;
+    size_t body_remaining = 0;          // Content-Length模式下剩余字节数
+    ChunkedDecoder chunked_decoder;
+    Request request{&arena};            // 当前请求，处理期间工作线程以引用方式读取
+    const Route* route = nullptr;       // 请求头到达时匹配的路由，未命中为nullptr
+    uint32_t metrics_route = 0;         // 当前请求计入的指标路由编号
+    std::function<void(std::string_view)> body_sink;   // 流式处理器的分块回调
+    RequestHandler body_complete;                      // 流式处理器的完成回调
+    bool screened = false;              // 全局中间件已在I/O线程上运行（见HttpServer::screen_request）
+    HeaderMap middleware_headers;       // 中间件在占位响应上添加的头部，合并到处理器的响应中（堆上，不随arena回收）
+    std::string output_head;    // 状态行和头部（跨请求复用容量）
+    std::pmr::string output_body{&arena};   // 响应体（从同一arena中的Response移交，不复制）
+    std::shared_ptr<const std::string> output_shared;  // 静态路由预生成的完整报文
+    size_t output_offset = 0;   // 已发送的字节数（头部 + 响应体）
+    std::shared_ptr<const OpenFile> output_file;       // 在内存段之后以sendfile发送的文件
+    ResponseStream stream;      // 流式响应状态，output_head依次装入各批数据
+    uint64_t file_offset = 0;   // 文件中下一个待发送的位置
+    uint64_t file_remaining = 0;
+
+    bool keep_alive = false;        // 当前响应发送完毕后是否保持连接
+    bool interim = false;           // 正在发送100 Continue，发完后回到读取请求体
+    bool peer_closed = false;       // 对端已关闭写方向
+    bool readable = false;          // socket中可能还有未读数据（边沿触发）
+    bool driving = false;           // 正在drive_client循环中，避免递归
+    size_t requests_served = 0;     // 本连接已处理的请求数
+
+    // io_uring后端：进行中的异步操作及sendmsg参数（须保持到发送完成）
+    bool receiving = false;
+    bool sending = false;
+    uint64_t receive_operation = 0;
+    uint64_t send_operation = 0;
+    iovec send_iov[3];
+    msghdr send_header{};
+    std::chrono::steady_clock::time_point last_active = std::chrono::steady_clock::now();
+    // 当前请求第一个字节到达的时间（请求头收齐后清零），用于请求头超时
+    std::chrono::steady_clock::time_point request_started;
+    TimerNode timer;            // 当前阶段的超时，挂在所属事件循环的时间轮上
+    std::chrono::steady_clock::time_point send_started;   // 响应开始发送的时间，用于Send阶段计时
+    
+    // 访问日志：客户端地址（网络字节序），当前请求第一个字节到达的时间，响应的状态码和字节数
+    uint32_t peer_address = 0;
+    std::chrono::steady_clock::time_point request_begin;
+    int response_status = 0;
+    uint64_t response_bytes = 0;
+
+    // 非空时连接已切换为HTTP/2：状态始终为Reading，output_head/output_offset用于发送会话生成的帧，
+    // 请求和响应属于各个流，不使用上面的单请求字段
+    std::unique_ptr<Http2Session> http2;
+
+    Connection(int socket_fd, EventLoop* owner) : fd(socket_fd), loop(owner) {
+        output_head.reserve(512);
+    }
+
+    ~Connection() {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // 回收本次请求的全部内存。持有arena内存的对象先销毁再原地重建：
+    // 移动赋值会保留目标已有的缓冲区，不能用来放弃arena中的内存
+    void reset_arena() {
+        std::destroy_at(&request);
+        ::new (&request) Request(&arena);
+        std::destroy_at(&output_body);
+        ::new (&output_body) std::pmr::string(&arena);
+        arena.reset();
+    }
+};
+
+} // namespace http
@@ -0,0 +1,394 @@
+#include "event_loop.hpp"
+#include "io_uring.hpp"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+
+namespace http {
+
+namespace {
+constexpr int kMaxEvents = 256;
+
+// io_uring后端参数：每个事件循环256个SQE、4096个CQE、256个4 KiB接收缓冲区
+constexpr unsigned kRingEntries = 256;
+constexpr unsigned kCompletionEntries = 4096;
+constexpr unsigned kReceiveBuffers = 256;
+constexpr unsigned kReceiveBufferSize = 4096;
+
+// 内部请求使用的user_data，普通操作的代数从1开始，不会与之冲突
+constexpr uint64_t kIgnoreTag = 0;
+constexpr uint64_t kWakeupTag = 1;
+constexpr uint64_t kEpollTag = 2;
+
+thread_local EventLoop* current_loop = nullptr;
+}
+
+EventLoop* EventLoop::current() {
+    return current_loop;
+}
+
+EventLoop::EventLoop(bool use_io_uring) : epoll_fd_(-1), wakeup_fd_(-1), thread_id_(std::this_thread::get_id()) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        throw std::runtime_error("无法创建epoll实例");
+    }
+
+    // io_uring模式下eventfd由挂起的READ请求读取，必须是阻塞的
+    wakeup_fd_ = eventfd(0, (use_io_uring ? 0 : EFD_NONBLOCK) | EFD_CLOEXEC);
+    if (wakeup_fd_ < 0) {
+        close(epoll_fd_);
+        throw std::runtime_error("无法创建eventfd");
+    }
+
+    if (use_io_uring) {
+        try {
+            ring_ = std::make_unique<IoUring>(kRingEntries, kCompletionEntries);
+            ring_->setup_buffers(0, kReceiveBuffers, kReceiveBufferSize);
+        } catch (...) {
+            ring_.reset();
+            close(wakeup_fd_);
+            close(epoll_fd_);
+            throw;
+        }
+        arm_wakeup_read();
+        arm_epoll_poll();
+        return;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = wakeup_fd_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event) < 0) {
+        close(wakeup_fd_);
+        close(epoll_fd_);
+        throw std::runtime_error("无法注册eventfd");
+    }
+}
+
+EventLoop::~EventLoop() {
+    // 先关闭io_uring（内核取消未完成的请求），再销毁回调（连接对象随之关闭），最后关闭epoll
+    ring_.reset();
+    operations_.clear();
+    callbacks_.clear();
+    retired_.clear();
+    close(wakeup_fd_);
+    close(epoll_fd_);
+}
+
+void EventLoop::add(int fd, uint32_t events, EventCallback callback) {
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+        throw std::runtime_error("无法注册文件描述符到epoll");
+    }
+    callbacks_[fd] = std::move(callback);
+}
+
+void EventLoop::modify(int fd, uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event);
+}
+
+void EventLoop::remove(int fd) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+
+    auto it = callbacks_.find(fd);
+    if (it != callbacks_.end()) {
+        // 回调可能正在执行（例如连接在自身回调中关闭），延迟销毁
+        retired_.push_back(std::move(it->second));
+        callbacks_.erase(it);
+    }
+}
+
+void EventLoop::run() {
+    thread_id_ = std::this_thread::get_id();
+    running_.store(true);
+    current_loop = this;
+
+    if (ring_) {
+        run_io_uring();
+    } else {
+        while (running_.load(std::memory_order_relaxed)) {
+            dispatch_epoll(next_timeout_ms());
+            retired_.clear();
+            run_pending_tasks();
+            run_expired_timers();
+        }
+    }
+    current_loop = nullptr;
+}
+
+void EventLoop::dispatch_epoll(int timeout_ms) {
+    epoll_event events[kMaxEvents];
+    int count = epoll_wait(epoll_fd_, events, kMaxEvents, timeout_ms);
+    if (count < 0) {
+        if (errno != EINTR) {
+            running_.store(false);
+        }
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        int fd = events[i].data.fd;
+        if (fd == wakeup_fd_) {
+            drain_wakeup();
+            continue;
+        }
+
+        auto it = callbacks_.find(fd);
+        if (it != callbacks_.end()) {
+            it->second(events[i].events);
+        }
+    }
+}
+
+void EventLoop::run_io_uring() {
+    while (running_.load(std::memory_order_relaxed)) {
+        // 上一轮回调中积累的SQE在这里与等待合并为一次系统调用
+        int result = ring_->submit_and_wait(next_timeout_ms());
+        if (result < 0 && result != -ETIME && result != -EINTR && result != -EBUSY) {
+            break;
+        }
+
+        ring_->drain([this](const io_uring_cqe& cqe) {
+            complete_operation(cqe.user_data, cqe.res, cqe.flags);
+        });
+
+        retired_.clear();
+        run_pending_tasks();
+        run_expired_timers();
+    }
+}
+
+uint64_t EventLoop::start_operation(Completion completion) {
+    uint32_t index;
+    if (!free_operations_.empty()) {
+        index = free_operations_.back();
+        free_operations_.pop_back();
+    } else {
+        index = static_cast<uint32_t>(operations_.size());
+        operations_.emplace_back();
+        operations_.back().generation = 1;
+    }
+    Operation& operation = operations_[index];
+    operation.completion = std::move(completion);
+    return (static_cast<uint64_t>(operation.generation) << 32) | index;
+}
+
+void EventLoop::complete_operation(uint64_t user_data, int result, uint32_t flags) {
+    if (user_data == kIgnoreTag) {
+        return;
+    }
+    if (user_data == kWakeupTag) {
+        // 投递的任务在本轮完成事件处理后统一执行
+        if (result != -ECANCELED) {
+            arm_wakeup_read();
+        }
+        return;
+    }
+    if (user_data == kEpollTag) {
+        dispatch_epoll(0);
+        if (!(flags & IORING_CQE_F_MORE) && result != -ECANCELED) {
+            arm_epoll_poll();
+        }
+        return;
+    }
+
+    uint32_t index = static_cast<uint32_t>(user_data);
+    uint32_t generation = static_cast<uint32_t>(user_data >> 32);
+    if (index >= operations_.size() || operations_[index].generation != generation) {
+        return;
+    }
+
+    // multishot请求还会有后续完成事件，原地调用（deque扩容不会使引用失效）
+    if (flags & IORING_CQE_F_MORE) {
+        operations_[index].completion(result, flags);
+        return;
+    }
+
+    Operation& operation = operations_[index];
+    Completion completion = std::move(operation.completion);
+    operation.completion = nullptr;
+    if (++operation.generation == 0) {
+        operation.generation = 1;
+    }
+    free_operations_.push_back(index);
+    completion(result, flags);
+}
+
+io_uring_sqe* EventLoop::next_sqe() {
+    io_uring_sqe* sqe = ring_->get_sqe();
+    if (!sqe) {
+        throw std::runtime_error("io_uring提交队列已满");
+    }
+    return sqe;
+}
+
+void EventLoop::arm_wakeup_read() {
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeup_fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(&wakeup_value_);
+    sqe->len = sizeof(wakeup_value_);
+    sqe->user_data = kWakeupTag;
+}
+
+void EventLoop::arm_epoll_poll() {
+    io_uring_sqe* sqe = next_sqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = epoll_fd_;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = kEpollTag;
+}
+
+uint64_t EventLoop::accept_multishot(int fd, AcceptCallback callback) {
+    io_uring_sqe* sqe = next_sqe();
+    uint64_t id = start_operation([callback = std::move(callback)](int result, uint32_t flags) {
+        callback(result, (flags & IORING_CQE_F_MORE) != 0);
+    });
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = id;
+    return id;
+}
+
+uint64_t EventLoop::receive_multishot(int fd, ReceiveCallback callback) {
+    io_uring_sqe* sqe = next_sqe();
+    uint64_t id = start_operation([this, callback = std::move(callback)](int result, uint32_t flags) {
+        bool has_buffer = (flags & IORING_CQE_F_BUFFER) != 0;
+        uint16_t buffer_id = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+        std::string_view data;
+        if (has_buffer && result > 0) {
+            data = std::string_view(ring_->buffer(buffer_id), static_cast<size_t>(result));
+        }
+        callback(result, data, (flags & IORING_CQE_F_MORE) != 0);
+        if (has_buffer) {
+            ring_->recycle_buffer(buffer_id);
+        }
+    });
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = ring_->buffer_group();
+    sqe->user_data = id;
+    return id;
+}
+
+uint64_t EventLoop::send_message(int fd, const msghdr* message, SendCallback callback, int flags) {
+    io_uring_sqe* sqe = next_sqe();
+    uint64_t id = start_operation([callback = std::move(callback)](int result, uint32_t) {
+        callback(result);
+    });
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(message);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL | flags;
+    sqe->user_data = id;
+    return id;
+}
+
+uint64_t EventLoop::poll_once(int fd, uint32_t events, PollCallback callback) {
+    io_uring_sqe* sqe = next_sqe();
+    uint64_t id = start_operation([callback = std::move(callback)](int result, uint32_t) {
+        callback(result);
+    });
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->user_data = id;
+    return id;
+}
+
+void EventLoop::cancel(uint64_t operation) {
+    io_uring_sqe* sqe = ring_->get_sqe();
+    if (!sqe) {
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = operation;
+    sqe->user_data = kIgnoreTag;
+}
+
+void EventLoop::stop() {
+    running_.store(false);
+    wakeup();
+}
+
+void EventLoop::post(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_tasks_.push_back(std::move(task));
+    }
+    wakeup();
+}
+
+void EventLoop::run_after(std::chrono::milliseconds delay, Task task) {
+    timers_.push(Timer{Clock::now() + delay, timer_sequence_++, std::move(task)});
+}
+
+int EventLoop::next_timeout_ms() const {
+    auto now = Clock::now();
+    int wheel_timeout = wheel_.next_timeout_ms(now);
+    if (timers_.empty()) {
+        return wheel_timeout;
+    }
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(timers_.top().deadline - now);
+    // 向上取整，避免提前醒来后空转
+    int timeout = remaining.count() < 0 ? 0 : static_cast<int>(remaining.count()) + 1;
+    return wheel_timeout < 0 ? timeout : std::min(timeout, wheel_timeout);
+}
+
+void EventLoop::run_expired_timers() {
+    auto now = Clock::now();
+    while (!timers_.empty() && timers_.top().deadline <= now) {
+        Task task = std::move(const_cast<Timer&>(timers_.top()).task);
+        timers_.pop();
+        task();
+    }
+    wheel_.advance(now);
+    retired_.clear();
+}
+
+void EventLoop::wakeup() {
+    uint64_t one = 1;
+    ssize_t written = write(wakeup_fd_, &one, sizeof(one));
+    (void)written;
+}
+
+void EventLoop::drain_wakeup() {
+    uint64_t value;
+    ssize_t bytes = read(wakeup_fd_, &value, sizeof(value));
+    (void)bytes;
+}
+
+void EventLoop::run_pending_tasks() {
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_tasks_.empty()) {
+            return;
+        }
+        tasks.swap(pending_tasks_);
+    }
+
+    for (auto& task : tasks) {
+        task();
+    }
+    retired_.clear();
+}
+
+} // namespace http
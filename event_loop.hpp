@@ -0,0 +1,150 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string_view>
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include "timing_wheel.hpp"
+
+struct msghdr;
+struct io_uring_sqe;
+
+namespace http {
+
+class IoUring;
+
+/**
+ * 基于epoll的事件循环（Reactor）
+ * 每个EventLoop由一个线程独占运行，负责其注册的所有文件描述符。
+ * 使用io_uring时，等待、提交和唤醒都经由io_uring完成：每轮循环积累的SQE
+ * 在下一次等待时通过一次io_uring_enter批量提交；add()注册的文件描述符
+ * 仍由内部的epoll实例管理，epoll fd本身以multishot poll挂在io_uring上。
+ */
+class EventLoop {
+public:
+    using EventCallback = std::function<void(uint32_t events)>;
+    using Task = std::function<void()>;
+    using AcceptCallback = std::function<void(int client_fd, bool more)>;
+    using ReceiveCallback = std::function<void(int result, std::string_view data, bool more)>;
+    using SendCallback = std::function<void(int result)>;
+    using PollCallback = std::function<void(int result)>;
+
+    explicit EventLoop(bool use_io_uring = false);
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // 注册/修改/移除文件描述符（仅在循环线程或循环启动前调用）
+    void add(int fd, uint32_t events, EventCallback callback);
+    void modify(int fd, uint32_t events);
+    void remove(int fd);
+
+    // 运行事件循环，直到调用stop()
+    void run();
+
+    // 停止事件循环（线程安全）
+    void stop();
+
+    // 投递任务到循环线程执行（线程安全）
+    void post(Task task);
+
+    // 在指定延迟后于循环线程执行一次任务（仅在循环线程调用）
+    void run_after(std::chrono::milliseconds delay, Task task);
+
+    // 本循环的分层时间轮，用于大量需要频繁挂入/取消的定时器（如连接超时），
+    // 节点嵌入在使用者中，挂入和取消都是O(1)且不分配内存（仅在循环线程使用）
+    TimingWheel& timing_wheel() { return wheel_; }
+
+    // 当前线程正在运行的事件循环，不在循环线程上时为nullptr
+    static EventLoop* current();
+
+    // 当前线程是否为循环线程
+    bool in_loop_thread() const { return std::this_thread::get_id() == thread_id_; }
+
+    // 已注册的文件描述符数量
+    size_t size() const { return callbacks_.size(); }
+
+    // 是否使用io_uring后端，以下异步操作仅在此时可用（仅在循环线程或循环启动前调用）
+    bool uses_io_uring() const { return ring_ != nullptr; }
+
+    // multishot accept：每接受一个连接回调一次，more为false时需要重新发起
+    uint64_t accept_multishot(int fd, AcceptCallback callback);
+
+    // multishot recv：数据来自provided buffer，回调返回后缓冲区即被回收；
+    // result为0表示对端关闭，-ENOBUFS表示缓冲区暂时耗尽，more为false时需要重新发起
+    uint64_t receive_multishot(int fd, ReceiveCallback callback);
+
+    // 异步sendmsg，message及其指向的内存在完成前必须保持有效；flags附加在MSG_NOSIGNAL之上（如MSG_MORE）
+    uint64_t send_message(int fd, const msghdr* message, SendCallback callback, int flags = 0);
+
+    // 单次poll：fd就绪后回调一次，result为就绪的poll事件或负的errno
+    uint64_t poll_once(int fd, uint32_t events, PollCallback callback);
+
+    // 取消指定操作（完成事件以-ECANCELED返回）；按操作而不是fd取消，fd被复用后也不会误伤
+    void cancel(uint64_t operation);
+
+private:
+    // 须先于持有定时器节点的成员（回调、任务）声明，保证最后析构
+    TimingWheel wheel_;
+
+    int epoll_fd_;
+    int wakeup_fd_;
+    std::atomic<bool> running_{false};
+    std::thread::id thread_id_;
+
+    std::unordered_map<int, EventCallback> callbacks_;
+    // 本轮事件分发中被移除的回调，分发结束后再销毁
+    std::vector<EventCallback> retired_;
+
+    std::mutex mutex_;
+    std::vector<Task> pending_tasks_;
+
+    using Clock = std::chrono::steady_clock;
+    struct Timer {
+        Clock::time_point deadline;
+        uint64_t sequence;
+        Task task;
+        bool operator>(const Timer& other) const {
+            return deadline != other.deadline ? deadline > other.deadline : sequence > other.sequence;
+        }
+    };
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    uint64_t timer_sequence_ = 0;
+
+    // io_uring后端：进行中的操作按user_data（代数 << 32 | 下标）索引，
+    // 代数在槽位复用时递增，避免迟到的完成事件或取消命中新操作
+    using Completion = std::function<void(int result, uint32_t flags)>;
+    struct Operation {
+        uint32_t generation = 0;
+        Completion completion;
+    };
+    std::unique_ptr<IoUring> ring_;
+    std::deque<Operation> operations_;
+    std::vector<uint32_t> free_operations_;
+    uint64_t wakeup_value_ = 0;
+
+    void run_io_uring();
+    uint64_t start_operation(Completion completion);
+    void complete_operation(uint64_t user_data, int result, uint32_t flags);
+    io_uring_sqe* next_sqe();
+    void arm_wakeup_read();
+    void arm_epoll_poll();
+    void dispatch_epoll(int timeout_ms);
+
+    int next_timeout_ms() const;
+    void run_expired_timers();
+    void wakeup();
+    void drain_wakeup();
+    void run_pending_tasks();
+};
+
+} // namespace http
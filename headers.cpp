@@ -0,0 +1,139 @@
+#include "headers.hpp"
+#include "request_parser.hpp"
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace http {
+
+namespace {
+
+struct KnownHeader {
+    std::string_view name;
+    HeaderId id;
+};
+
+// 顺序与HeaderId一致
+constexpr KnownHeader kKnownHeaders[kKnownHeaderCount] = {
+    {"Host", HeaderId::Host},
+    {"Connection", HeaderId::Connection},
+    {"Content-Length", HeaderId::ContentLength},
+    {"Content-Type", HeaderId::ContentType},
+    {"Content-Encoding", HeaderId::ContentEncoding},
+    {"Transfer-Encoding", HeaderId::TransferEncoding},
+    {"Accept-Encoding", HeaderId::AcceptEncoding},
+    {"Expect", HeaderId::Expect},
+    {"If-None-Match", HeaderId::IfNoneMatch},
+    {"If-Modified-Since", HeaderId::IfModifiedSince},
+    {"Range", HeaderId::Range},
+    {"Cache-Control", HeaderId::CacheControl},
+    {"ETag", HeaderId::ETag},
+    {"Vary", HeaderId::Vary},
+};
+
+// 槽位以16位记录下标
+constexpr size_t kMaxEntries = UINT16_MAX;
+
+} // namespace
+
+HeaderId header_id(std::string_view name) {
+    // 先比较长度，大多数名称只需要一两次完整比较
+    for (const KnownHeader& known : kKnownHeaders) {
+        if (known.name.size() == name.size() && iequals(known.name, name)) {
+            return known.id;
+        }
+    }
+    return HeaderId::Other;
+}
+
+std::string_view header_name(HeaderId id) {
+    return id == HeaderId::Other ? std::string_view() : kKnownHeaders[static_cast<size_t>(id)].name;
+}
+
+void HeaderMap::clear() {
+    entries_.clear();
+    std::fill(std::begin(slots_), std::end(slots_), 0);
+}
+
+const std::pmr::string* HeaderMap::find(HeaderId id) const {
+    if (id == HeaderId::Other) {
+        return nullptr;
+    }
+    uint16_t slot = slots_[static_cast<size_t>(id)];
+    return slot != 0 ? &entries_[slot - 1].value : nullptr;
+}
+
+const std::pmr::string* HeaderMap::find(std::string_view name) const {
+    HeaderId id = header_id(name);
+    return id == HeaderId::Other ? find_other(name) : find(id);
+}
+
+const std::pmr::string* HeaderMap::find_other(std::string_view name) const {
+    for (const Entry& entry : entries_) {
+        if (entry.id == HeaderId::Other && iequals(entry.name, name)) {
+            return &entry.value;
+        }
+    }
+    return nullptr;
+}
+
+std::pmr::string* HeaderMap::find_other(std::string_view name) {
+    return const_cast<std::pmr::string*>(std::as_const(*this).find_other(name));
+}
+
+std::pmr::string& HeaderMap::operator[](HeaderId id) {
+    if (id == HeaderId::Other) {
+        throw std::invalid_argument("HeaderId::Other没有对应的头部名称");
+    }
+    if (const std::pmr::string* value = find(id)) {
+        return const_cast<std::pmr::string&>(*value);
+    }
+    add(id, header_name(id), std::string_view());
+    return entries_.back().value;
+}
+
+std::pmr::string& HeaderMap::operator[](std::string_view name) {
+    HeaderId id = header_id(name);
+    if (id != HeaderId::Other) {
+        return (*this)[id];
+    }
+    if (std::pmr::string* value = find_other(name)) {
+        return *value;
+    }
+    add(HeaderId::Other, name, std::string_view());
+    return entries_.back().value;
+}
+
+void HeaderMap::add(HeaderId id, std::string_view name, std::string_view value) {
+    if (entries_.size() >= kMaxEntries) {
+        throw std::length_error("头部数量超出上限");
+    }
+    entries_.emplace_back(id, name, value);
+    if (id != HeaderId::Other && slots_[static_cast<size_t>(id)] == 0) {
+        slots_[static_cast<size_t>(id)] = static_cast<uint16_t>(entries_.size());
+    }
+}
+
+size_t HeaderMap::erase(std::string_view name) {
+    HeaderId id = header_id(name);
+    size_t before = entries_.size();
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [id, name](const Entry& entry) {
+                                      return entry.id == id && (id != HeaderId::Other || iequals(entry.name, name));
+                                  }),
+                   entries_.end());
+    size_t removed = before - entries_.size();
+    if (removed > 0) {
+        // 后面的头部整体前移，槽位按新的下标重建
+        std::fill(std::begin(slots_), std::end(slots_), 0);
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (entries_[i].id != HeaderId::Other && slots_[static_cast<size_t>(entries_[i].id)] == 0) {
+                slots_[static_cast<size_t>(entries_[i].id)] = static_cast<uint16_t>(i + 1);
+            }
+        }
+    }
+    return removed;
+}
+
+} // namespace http
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace http {
+
+// 常用头部的编号，解析和查找时按名称映射，之后以固定槽位O(1)访问
+enum class HeaderId : uint8_t {
+    Host,
+    Connection,
+    ContentLength,
+    ContentType,
+    ContentEncoding,
+    TransferEncoding,
+    AcceptEncoding,
+    Expect,
+    IfNoneMatch,
+    IfModifiedSince,
+    Range,
+    CacheControl,
+    ETag,
+    Vary,
+    Other       // 其余头部，按名称大小写不敏感地线性查找
+};
+
+constexpr size_t kKnownHeaderCount = static_cast<size_t>(HeaderId::Other);
+
+// 大小写不敏感地把头部名称映射为编号，不是常用头部时返回HeaderId::Other
+HeaderId header_id(std::string_view name);
+
+// 常用头部的规范名称（如"Content-Length"），Other返回空
+std::string_view header_name(HeaderId id);
+
+/**
+ * 请求/响应头
+ * 按插入顺序平铺在一个vector中，常用头部另在固定槽位中记录下标，查找不必遍历也不必哈希；
+ * 名称比较大小写不敏感。同名头部（如Set-Cookie）可以用add()重复添加，查找返回第一个。
+ * 键和值与vector使用同一内存资源：在请求arena中构造时全部分配在arena里，
+ * 复制时回到默认资源（与std::pmr容器相同）。
+ */
+class HeaderMap {
+public:
+    struct Entry {
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+        std::pmr::string name;
+        std::pmr::string value;
+        HeaderId id = HeaderId::Other;
+
+        Entry(HeaderId id, std::string_view name, std::string_view value, const allocator_type& allocator)
+            : name(name, allocator), value(value, allocator), id(id) {}
+        Entry(const Entry& other, const allocator_type& allocator)
+            : name(other.name, allocator), value(other.value, allocator), id(other.id) {}
+        Entry(Entry&& other, const allocator_type& allocator)
+            : name(std::move(other.name), allocator), value(std::move(other.value), allocator), id(other.id) {}
+        Entry(const Entry&) = default;
+        Entry(Entry&&) = default;
+        Entry& operator=(const Entry&) = default;
+        Entry& operator=(Entry&&) = default;
+    };
+
+    using const_iterator = std::pmr::vector<Entry>::const_iterator;
+
+    HeaderMap() : HeaderMap(std::pmr::get_default_resource()) {}
+    explicit HeaderMap(std::pmr::memory_resource* resource) : entries_(resource) {}
+
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+    const_iterator begin() const { return entries_.begin(); }
+    const_iterator end() const { return entries_.end(); }
+    void reserve(size_t count) { entries_.reserve(count); }
+    void clear();
+
+    // 查找头部的值，不存在时返回nullptr
+    const std::pmr::string* find(HeaderId id) const;
+    const std::pmr::string* find(std::string_view name) const;
+    bool contains(HeaderId id) const { return find(id) != nullptr; }
+    bool contains(std::string_view name) const { return find(name) != nullptr; }
+
+    // 取得头部的值以便修改，不存在时添加空值；返回的引用在下一次添加头部前有效
+    std::pmr::string& operator[](HeaderId id);
+    std::pmr::string& operator[](std::string_view name);
+
+    // 设置头部的值，替换第一个同名头部
+    void set(std::string_view name, std::string_view value) { (*this)[name].assign(value); }
+
+    // 追加头部，不检查是否已存在；id须与name一致（解析器已经算出编号时省去再次映射）
+    void add(std::string_view name, std::string_view value) { add(header_id(name), name, value); }
+    void add(HeaderId id, std::string_view name, std::string_view value);
+
+    // 删除所有同名头部，返回删除的数量
+    size_t erase(std::string_view name);
+
+private:
+    std::pmr::vector<Entry> entries_;
+    // 常用头部第一次出现的位置（下标 + 1），0表示不存在
+    uint16_t slots_[kKnownHeaderCount] = {};
+
+    std::pmr::string* find_other(std::string_view name);
+    const std::pmr::string* find_other(std::string_view name) const;
+};
+
+} // namespace http
@@ -0,0 +1,503 @@
+#include "hpack.hpp"
+#include <algorithm>
+#include <array>
+
+namespace http {
+
+namespace {
+
+struct StaticEntry {
+    std::string_view name;
+    std::string_view value;
+};
+
+// RFC 7541 附录A，索引从1开始
+constexpr StaticEntry kStaticTable[] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+constexpr size_t kStaticTableSize = sizeof(kStaticTable) / sizeof(kStaticTable[0]);
+
+// 本端动态表的默认大小（SETTINGS_HEADER_TABLE_SIZE的初始值），编码器也不使用更大的表
+constexpr size_t kDefaultTableSize = 4096;
+
+// RFC 7541 附录B：256个字节和EOS（下标256）的Huffman编码及其位数
+constexpr uint32_t kHuffmanCodes[257] = {
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+    0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+    0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+    0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+    0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+    0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+    0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+    0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+    0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+    0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+    0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+    0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+    0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+    0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+    0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+    0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+    0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+    0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+    0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+    0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+    0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+    0x3fffffff,
+};
+
+constexpr uint8_t kHuffmanLengths[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+/**
+ * 规范Huffman解码表
+ * HPACK的编码是规范的：同一长度的编码连续分配，因此只需记录每个长度的第一个编码、
+ * 编码个数和对应符号在排序表中的起点，逐位累加时即可判断是否构成完整的编码
+ */
+struct HuffmanDecodeTable {
+    uint32_t first_code[31] = {};
+    uint16_t first_index[31] = {};
+    uint16_t count[31] = {};
+    uint16_t symbols[257] = {};
+};
+
+const HuffmanDecodeTable& huffman_decode_table() {
+    static const HuffmanDecodeTable table = []() {
+        HuffmanDecodeTable result;
+        std::array<uint16_t, 257> order;
+        for (uint16_t i = 0; i < 257; ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [](uint16_t a, uint16_t b) {
+            return kHuffmanLengths[a] != kHuffmanLengths[b] ? kHuffmanLengths[a] < kHuffmanLengths[b]
+                                                            : kHuffmanCodes[a] < kHuffmanCodes[b];
+        });
+        for (size_t i = 0; i < order.size(); ++i) {
+            uint16_t symbol = order[i];
+            uint8_t length = kHuffmanLengths[symbol];
+            if (result.count[length]++ == 0) {
+                result.first_code[length] = kHuffmanCodes[symbol];
+                result.first_index[length] = static_cast<uint16_t>(i);
+            }
+            result.symbols[i] = symbol;
+        }
+        return result;
+    }();
+    return table;
+}
+
+// 解码整数，prefix_bits位前缀；值过大或数据不足时返回false
+bool decode_integer(std::string_view data, size_t& offset, int prefix_bits, uint64_t& value) {
+    if (offset >= data.size()) {
+        return false;
+    }
+    uint64_t mask = (1u << prefix_bits) - 1;
+    value = static_cast<uint8_t>(data[offset++]) & mask;
+    if (value < mask) {
+        return true;
+    }
+    for (int shift = 0; shift <= 28; shift += 7) {
+        if (offset >= data.size()) {
+            return false;
+        }
+        uint8_t byte = static_cast<uint8_t>(data[offset++]);
+        value += static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 取值每次都不同、加入动态表只会挤掉有用项的头部
+bool skip_indexing(std::string_view name) {
+    return name == "content-length" || name == "content-range" || name == "etag" || name == "last-modified" ||
+           name == "set-cookie";
+}
+
+} // namespace
+
+void HpackTable::insert(std::string_view name, std::string_view value) {
+    size_t entry_size = name.size() + value.size() + kEntryOverhead;
+    if (entry_size > max_size_) {
+        evict(0);
+        return;
+    }
+    // 名称可能引用即将被淘汰的项，先复制再淘汰
+    Entry entry{std::string(name), std::string(value)};
+    evict(max_size_ - entry_size);
+    entries_.push_front(std::move(entry));
+    size_ += entry_size;
+}
+
+void HpackTable::set_max_size(size_t max_size) {
+    max_size_ = max_size;
+    evict(max_size);
+}
+
+void HpackTable::evict(size_t limit) {
+    while (size_ > limit && !entries_.empty()) {
+        const Entry& oldest = entries_.back();
+        size_ -= oldest.name.size() + oldest.value.size() + kEntryOverhead;
+        entries_.pop_back();
+    }
+}
+
+bool HpackDecoder::decode(std::string_view block, Sink sink, void* context) {
+    size_t offset = 0;
+    bool header_seen = false;
+    auto lookup = [this](uint64_t index, std::string_view& name, std::string_view& value) {
+        if (index == 0) {
+            return false;
+        }
+        if (index <= kStaticTableSize) {
+            name = kStaticTable[index - 1].name;
+            value = kStaticTable[index - 1].value;
+            return true;
+        }
+        index -= kStaticTableSize + 1;
+        if (index >= table_.count()) {
+            return false;
+        }
+        name = table_.at(index).name;
+        value = table_.at(index).value;
+        return true;
+    };
+
+    while (offset < block.size()) {
+        uint8_t first = static_cast<uint8_t>(block[offset]);
+        uint64_t index = 0;
+        std::string_view name;
+        std::string_view value;
+
+        if (first & 0x80) {
+            // 索引头部字段
+            if (!decode_integer(block, offset, 7, index) || !lookup(index, name, value)) {
+                return false;
+            }
+            sink(context, name, value);
+            header_seen = true;
+            continue;
+        }
+        if ((first & 0xe0) == 0x20) {
+            // 动态表大小更新，只能出现在头部块开头
+            if (header_seen || !decode_integer(block, offset, 5, index) || index > max_table_size_) {
+                return false;
+            }
+            table_.set_max_size(index);
+            continue;
+        }
+
+        // 字面头部字段：增量索引（01）、不索引（0000）或永不索引（0001）
+        bool indexing = (first & 0xc0) == 0x40;
+        if (!decode_integer(block, offset, indexing ? 6 : 4, index)) {
+            return false;
+        }
+        if (index == 0) {
+            if (!read_string(block, offset, name_buffer_, name)) {
+                return false;
+            }
+        } else {
+            std::string_view unused;
+            if (!lookup(index, name, unused)) {
+                return false;
+            }
+        }
+        if (!read_string(block, offset, value_buffer_, value)) {
+            return false;
+        }
+        sink(context, name, value);
+        if (indexing) {
+            table_.insert(name, value);
+        }
+        header_seen = true;
+    }
+    return true;
+}
+
+bool HpackDecoder::read_string(std::string_view block, size_t& offset, std::string& buffer, std::string_view& out) {
+    if (offset >= block.size()) {
+        return false;
+    }
+    bool huffman = static_cast<uint8_t>(block[offset]) & 0x80;
+    uint64_t length = 0;
+    if (!decode_integer(block, offset, 7, length) || length > block.size() - offset) {
+        return false;
+    }
+    std::string_view data = block.substr(offset, length);
+    offset += length;
+    if (!huffman) {
+        out = data;
+        return true;
+    }
+    buffer.clear();
+    if (!huffman_decode(data, buffer)) {
+        return false;
+    }
+    out = buffer;
+    return true;
+}
+
+void HpackEncoder::set_max_table_size(size_t max_size) {
+    size_t size = std::min(max_size, kDefaultTableSize);
+    if (size == table_.max_size() && pending_size_update_ == SIZE_MAX) {
+        return;
+    }
+    // 两个头部块之间多次变化时，先告知其中的最小值再告知最终值（RFC 7541 4.2）
+    min_size_update_ = std::min(min_size_update_, size);
+    pending_size_update_ = size;
+    table_.set_max_size(size);
+}
+
+void HpackEncoder::begin_block(std::string& out) {
+    if (pending_size_update_ == SIZE_MAX) {
+        return;
+    }
+    if (min_size_update_ < pending_size_update_) {
+        hpack_encode_integer(min_size_update_, 5, 0x20, out);
+    }
+    hpack_encode_integer(pending_size_update_, 5, 0x20, out);
+    pending_size_update_ = SIZE_MAX;
+    min_size_update_ = SIZE_MAX;
+}
+
+void HpackEncoder::encode_status(int status, std::string& out) {
+    // 静态表中有200、204、206、304、400、404、500
+    switch (status) {
+        case 200: out.push_back(static_cast<char>(0x88)); return;
+        case 204: out.push_back(static_cast<char>(0x89)); return;
+        case 206: out.push_back(static_cast<char>(0x8a)); return;
+        case 304: out.push_back(static_cast<char>(0x8b)); return;
+        case 400: out.push_back(static_cast<char>(0x8c)); return;
+        case 404: out.push_back(static_cast<char>(0x8d)); return;
+        case 500: out.push_back(static_cast<char>(0x8e)); return;
+        default: break;
+    }
+    char digits[3] = {
+        static_cast<char>('0' + status / 100 % 10),
+        static_cast<char>('0' + status / 10 % 10),
+        static_cast<char>('0' + status % 10),
+    };
+    encode(":status", std::string_view(digits, 3), out);
+}
+
+void HpackEncoder::encode(std::string_view name, std::string_view value, std::string& out) {
+    size_t name_index = 0;
+    if (size_t index = find(name, value, name_index)) {
+        hpack_encode_integer(index, 7, 0x80, out);
+        return;
+    }
+
+    // 超过表大小四分之三的项会挤掉几乎所有已有项，不值得索引
+    size_t entry_size = name.size() + value.size() + HpackTable::kEntryOverhead;
+    bool indexing = !skip_indexing(name) && entry_size <= table_.max_size() * 3 / 4;
+    if (indexing) {
+        hpack_encode_integer(name_index, 6, 0x40, out);
+    } else {
+        // Set-Cookie以永不索引发送，中间节点也不会把它加入自己的表
+        hpack_encode_integer(name_index, 4, name == "set-cookie" ? 0x10 : 0x00, out);
+    }
+    auto encode_string = [&out](std::string_view data) {
+        size_t huffman_length = huffman_encoded_length(data);
+        if (huffman_length < data.size()) {
+            hpack_encode_integer(huffman_length, 7, 0x80, out);
+            huffman_encode(data, out);
+        } else {
+            hpack_encode_integer(data.size(), 7, 0x00, out);
+            out.append(data);
+        }
+    };
+    if (name_index == 0) {
+        encode_string(name);
+    }
+    encode_string(value);
+    if (indexing) {
+        table_.insert(name, value);
+    }
+}
+
+size_t HpackEncoder::find(std::string_view name, std::string_view value, size_t& name_index) const {
+    name_index = 0;
+    for (size_t i = 0; i < kStaticTableSize; ++i) {
+        if (kStaticTable[i].name == name) {
+            if (kStaticTable[i].value == value) {
+                return i + 1;
+            }
+            if (name_index == 0) {
+                name_index = i + 1;
+            }
+        }
+    }
+    for (size_t i = 0; i < table_.count(); ++i) {
+        const HpackTable::Entry& entry = table_.at(i);
+        if (entry.name == name) {
+            if (entry.value == value) {
+                return kStaticTableSize + 1 + i;
+            }
+            if (name_index == 0) {
+                name_index = kStaticTableSize + 1 + i;
+            }
+        }
+    }
+    return 0;
+}
+
+void hpack_encode_integer(uint64_t value, int prefix_bits, uint8_t first_byte, std::string& out) {
+    uint64_t mask = (1u << prefix_bits) - 1;
+    if (value < mask) {
+        out.push_back(static_cast<char>(first_byte | value));
+        return;
+    }
+    out.push_back(static_cast<char>(first_byte | mask));
+    value -= mask;
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+size_t huffman_encoded_length(std::string_view data) {
+    size_t bits = 0;
+    for (char c : data) {
+        bits += kHuffmanLengths[static_cast<uint8_t>(c)];
+    }
+    return (bits + 7) / 8;
+}
+
+void huffman_encode(std::string_view data, std::string& out) {
+    uint64_t bits = 0;
+    int count = 0;
+    for (char c : data) {
+        uint8_t symbol = static_cast<uint8_t>(c);
+        bits = (bits << kHuffmanLengths[symbol]) | kHuffmanCodes[symbol];
+        count += kHuffmanLengths[symbol];
+        while (count >= 8) {
+            count -= 8;
+            out.push_back(static_cast<char>(bits >> count));
+        }
+    }
+    // 最后不足一字节的部分以EOS的高位（全1）填充
+    if (count > 0) {
+        out.push_back(static_cast<char>((bits << (8 - count)) | (0xff >> count)));
+    }
+}
+
+bool huffman_decode(std::string_view data, std::string& out) {
+    const HuffmanDecodeTable& table = huffman_decode_table();
+    uint32_t code = 0;
+    int length = 0;
+    for (char c : data) {
+        uint8_t byte = static_cast<uint8_t>(c);
+        for (int bit = 7; bit >= 0; --bit) {
+            code = (code << 1) | ((byte >> bit) & 1);
+            ++length;
+            if (length >= 5 && code >= table.first_code[length] &&
+                code - table.first_code[length] < table.count[length]) {
+                uint16_t symbol = table.symbols[table.first_index[length] + (code - table.first_code[length])];
+                if (symbol == 256) {
+                    // 数据中出现EOS是解码错误
+                    return false;
+                }
+                out.push_back(static_cast<char>(symbol));
+                code = 0;
+                length = 0;
+            } else if (length >= 30) {
+                return false;
+            }
+        }
+    }
+    // 填充不超过7位且必须全为1
+    return length <= 7 && code == (1u << length) - 1;
+}
+
+} // namespace http
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace http {
+
+/**
+ * HPACK（RFC 7541）头部压缩
+ * HTTP/2的头部块由静态表（61项常用头部）、按连接维护的动态表和可选的Huffman编码组成。
+ * 编码端与解码端各有一张动态表，必须按收发顺序处理每个头部块才能保持同步，
+ * 因此每个HTTP/2连接持有一个编码器和一个解码器，都只在连接所属的事件循环线程上使用。
+ */
+
+/**
+ * 动态表
+ * 新项插在最前面（索引62），总大小（每项名称 + 值 + 32字节）超过上限时从最旧的一端淘汰
+ */
+class HpackTable {
+public:
+    struct Entry {
+        std::string name;
+        std::string value;
+    };
+
+    static constexpr size_t kEntryOverhead = 32;
+
+    explicit HpackTable(size_t max_size) : max_size_(max_size) {}
+
+    size_t count() const { return entries_.size(); }
+    size_t size() const { return size_; }
+    size_t max_size() const { return max_size_; }
+
+    // index从0开始，0为最新的一项
+    const Entry& at(size_t index) const { return entries_[index]; }
+
+    // 插入新项；单项超过上限时清空整张表（RFC 7541 4.4）
+    void insert(std::string_view name, std::string_view value);
+    void set_max_size(size_t max_size);
+
+private:
+    std::deque<Entry> entries_;
+    size_t size_ = 0;
+    size_t max_size_;
+
+    void evict(size_t limit);
+};
+
+/**
+ * 头部块解码器
+ * 名称和值以string_view交给回调，只在回调期间有效。解码失败（格式错误、索引越界、
+ * 动态表大小超出协商值、Huffman填充非法）时返回false，调用者应以COMPRESSION_ERROR关闭连接。
+ */
+class HpackDecoder {
+public:
+    // max_table_size：本端通告的SETTINGS_HEADER_TABLE_SIZE，对端的表大小更新不能超过它
+    explicit HpackDecoder(size_t max_table_size = 4096) : table_(max_table_size), max_table_size_(max_table_size) {}
+
+    template <typename Fn>
+    bool decode(std::string_view block, Fn&& on_header) {
+        using Callback = std::remove_reference_t<Fn>;
+        return decode(block, [](void* context, std::string_view name, std::string_view value) {
+            (*static_cast<Callback*>(context))(name, value);
+        }, &on_header);
+    }
+
+private:
+    using Sink = void (*)(void* context, std::string_view name, std::string_view value);
+
+    HpackTable table_;
+    size_t max_table_size_;
+    std::string name_buffer_;     // Huffman解码的结果，跨头部块复用容量
+    std::string value_buffer_;
+
+    bool decode(std::string_view block, Sink sink, void* context);
+    bool read_string(std::string_view block, size_t& offset, std::string& buffer, std::string_view& out);
+};
+
+/**
+ * 头部块编码器
+ * 先在静态表和动态表中查找完全匹配（只需一个索引字节），其次复用名称的索引；
+ * 值以Huffman编码更短时使用Huffman。大多数头部以增量索引方式加入动态表，
+ * 同一连接上的后续响应只需发送索引；每个响应都不同的头部（如Content-Length）不加入动态表。
+ * 名称必须是小写。
+ */
+class HpackEncoder {
+public:
+    explicit HpackEncoder(size_t max_table_size = 4096) : table_(max_table_size) {}
+
+    // 对端通告的SETTINGS_HEADER_TABLE_SIZE，在下一个头部块的开头告知对端
+    void set_max_table_size(size_t max_size);
+
+    // 每个头部块开始时调用，输出待发送的动态表大小更新
+    void begin_block(std::string& out);
+
+    void encode_status(int status, std::string& out);
+    void encode(std::string_view name, std::string_view value, std::string& out);
+
+private:
+    HpackTable table_;
+    size_t pending_size_update_ = SIZE_MAX;   // 尚未告知对端的新表大小，SIZE_MAX表示没有
+    size_t min_size_update_ = SIZE_MAX;       // 两个头部块之间出现过的最小值，须先于最终值告知
+
+    // 返回完全匹配的索引，name_index返回名称匹配的索引，均以0表示没有
+    size_t find(std::string_view name, std::string_view value, size_t& name_index) const;
+};
+
+// HPACK整数编码：prefix_bits位前缀，first_byte中前缀之外的高位标志
+void hpack_encode_integer(uint64_t value, int prefix_bits, uint8_t first_byte, std::string& out);
+
+// 字符串以Huffman编码后的字节数
+size_t huffman_encoded_length(std::string_view data);
+void huffman_encode(std::string_view data, std::string& out);
+
+// 解码Huffman字符串并追加到out，编码非法时返回false
+bool huffman_decode(std::string_view data, std::string& out);
+
+} // namespace http
@@ -0,0 +1,1048 @@
+#include "http2.hpp"
+#include "static_files.hpp"
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <vector>
+
+namespace http {
+
+namespace {
+
+enum class FrameType : uint8_t {
+    Data = 0x0,
+    Headers = 0x1,
+    Priority = 0x2,
+    RstStream = 0x3,
+    Settings = 0x4,
+    PushPromise = 0x5,
+    Ping = 0x6,
+    GoAway = 0x7,
+    WindowUpdate = 0x8,
+    Continuation = 0x9
+};
+
+constexpr uint8_t kFlagEndStream = 0x1;
+constexpr uint8_t kFlagAck = 0x1;
+constexpr uint8_t kFlagEndHeaders = 0x4;
+constexpr uint8_t kFlagPadded = 0x8;
+constexpr uint8_t kFlagPriority = 0x20;
+
+constexpr uint16_t kSettingsHeaderTableSize = 0x1;
+constexpr uint16_t kSettingsEnablePush = 0x2;
+constexpr uint16_t kSettingsMaxConcurrentStreams = 0x3;
+constexpr uint16_t kSettingsInitialWindowSize = 0x4;
+constexpr uint16_t kSettingsMaxFrameSize = 0x5;
+constexpr uint16_t kSettingsMaxHeaderListSize = 0x6;
+
+constexpr size_t kFrameHeaderSize = 9;
+constexpr int64_t kMaxWindow = 0x7fffffff;
+constexpr int64_t kDefaultWindow = 65535;
+
+uint32_t read_u32(std::string_view data) {
+    return (static_cast<uint32_t>(static_cast<uint8_t>(data[0])) << 24) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(data[1])) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(data[2])) << 8) |
+           static_cast<uint32_t>(static_cast<uint8_t>(data[3]));
+}
+
+void append_u32(std::string& out, uint32_t value) {
+    out.push_back(static_cast<char>(value >> 24));
+    out.push_back(static_cast<char>(value >> 16));
+    out.push_back(static_cast<char>(value >> 8));
+    out.push_back(static_cast<char>(value));
+}
+
+// HTTP/2禁止的逐跳头部（RFC 9113 8.2.2）
+bool connection_specific(std::string_view name) {
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+           name == "transfer-encoding" || name == "upgrade";
+}
+
+// 去掉填充，填充长度非法时返回false
+bool strip_padding(uint8_t flags, std::string_view& payload) {
+    if (!(flags & kFlagPadded)) {
+        return true;
+    }
+    if (payload.empty()) {
+        return false;
+    }
+    size_t padding = static_cast<uint8_t>(payload[0]);
+    payload.remove_prefix(1);
+    if (padding > payload.size()) {
+        return false;
+    }
+    payload.remove_suffix(padding);
+    return true;
+}
+
+} // namespace
+
+Http2Session::Http2Session(const Settings& settings, Callbacks callbacks)
+    : settings_(settings), callbacks_(std::move(callbacks)) {
+    // 服务器连接序言：SETTINGS，随后把连接接收窗口从默认的64KB放大
+    write_settings();
+    if (settings_.connection_window_size > kDefaultWindow) {
+        write_window_update(0, static_cast<uint32_t>(settings_.connection_window_size - kDefaultWindow));
+        connection_receive_window_ = settings_.connection_window_size;
+    }
+}
+
+std::shared_ptr<Http2Stream> Http2Session::upgrade(std::string_view settings, const Request& request) {
+    if (!process_settings(settings)) {
+        return nullptr;
+    }
+    auto stream = std::make_shared<Http2Stream>(1);
+    stream->request = request;
+    stream->request.version = "HTTP/2";
+    stream->dispatched = true;
+    stream->remote_closed = true;
+    stream->send_window = peer_initial_window_;
+    stream->receive_window = settings_.initial_window_size;
+    stream->started = std::chrono::steady_clock::now();
+    last_stream_id_ = 1;
+    ++streams_accepted_;
+    streams_.emplace(1, stream);
+    return stream;
+}
+
+size_t Http2Session::receive(std::string_view data) {
+    if (failed_) {
+        return data.size();
+    }
+    size_t offset = 0;
+    if (!preface_received_) {
+        size_t length = std::min(data.size(), kHttp2Preface.size());
+        if (data.substr(0, length) != kHttp2Preface.substr(0, length)) {
+            fail(Http2Error::ProtocolError);
+            return data.size();
+        }
+        if (length < kHttp2Preface.size()) {
+            return 0;
+        }
+        preface_received_ = true;
+        offset = kHttp2Preface.size();
+    }
+
+    while (!failed_ && data.size() - offset >= kFrameHeaderSize) {
+        std::string_view header = data.substr(offset, kFrameHeaderSize);
+        size_t length = (static_cast<size_t>(static_cast<uint8_t>(header[0])) << 16) |
+                        (static_cast<size_t>(static_cast<uint8_t>(header[1])) << 8) |
+                        static_cast<size_t>(static_cast<uint8_t>(header[2]));
+        uint8_t type = static_cast<uint8_t>(header[3]);
+        uint8_t flags = static_cast<uint8_t>(header[4]);
+        uint32_t stream_id = read_u32(header.substr(5)) & 0x7fffffff;
+        if (length > settings_.max_frame_size) {
+            fail(Http2Error::FrameSizeError);
+            break;
+        }
+        if (data.size() - offset - kFrameHeaderSize < length) {
+            break;
+        }
+        std::string_view payload = data.substr(offset + kFrameHeaderSize, length);
+        offset += kFrameHeaderSize + length;
+
+        // 序言之后的第一个帧必须是SETTINGS
+        if (!settings_received_ &&
+            (type != static_cast<uint8_t>(FrameType::Settings) || (flags & kFlagAck))) {
+            fail(Http2Error::ProtocolError);
+            break;
+        }
+        process_frame(type, flags, stream_id, payload);
+    }
+    return failed_ ? data.size() : offset;
+}
+
+void Http2Session::process_frame(uint8_t type, uint8_t flags, uint32_t stream_id, std::string_view payload) {
+    // 头部块必须连续，中间不能插入其他帧
+    if (continuation_stream_ != 0 &&
+        (type != static_cast<uint8_t>(FrameType::Continuation) || stream_id != continuation_stream_)) {
+        fail(Http2Error::ProtocolError);
+        return;
+    }
+
+    switch (static_cast<FrameType>(type)) {
+        case FrameType::Data:
+            process_data(flags, stream_id, payload);
+            break;
+        case FrameType::Headers:
+            process_headers(flags, stream_id, payload);
+            break;
+        case FrameType::Priority:
+            // 不按优先级调度，只检查格式
+            if (stream_id == 0) {
+                fail(Http2Error::ProtocolError);
+            } else if (payload.size() != 5) {
+                stream_error(stream_id, Http2Error::FrameSizeError);
+            }
+            break;
+        case FrameType::RstStream: {
+            if (stream_id == 0 || stream_id > last_stream_id_) {
+                fail(Http2Error::ProtocolError);
+                break;
+            }
+            if (payload.size() != 4) {
+                fail(Http2Error::FrameSizeError);
+                break;
+            }
+            auto it = streams_.find(stream_id);
+            if (it != streams_.end()) {
+                close_stream(it->second);
+            }
+            break;
+        }
+        case FrameType::Settings:
+            if (stream_id != 0) {
+                fail(Http2Error::ProtocolError);
+                break;
+            }
+            if (flags & kFlagAck) {
+                if (!payload.empty()) {
+                    fail(Http2Error::FrameSizeError);
+                }
+                break;
+            }
+            if (process_settings(payload)) {
+                settings_received_ = true;
+                write_frame_header(0, static_cast<uint8_t>(FrameType::Settings), kFlagAck, 0);
+            }
+            break;
+        case FrameType::PushPromise:
+            // 客户端不能推送
+            fail(Http2Error::ProtocolError);
+            break;
+        case FrameType::Ping:
+            if (stream_id != 0) {
+                fail(Http2Error::ProtocolError);
+            } else if (payload.size() != 8) {
+                fail(Http2Error::FrameSizeError);
+            } else if (!(flags & kFlagAck)) {
+                write_frame_header(8, static_cast<uint8_t>(FrameType::Ping), kFlagAck, 0);
+                output_.append(payload);
+            }
+            break;
+        case FrameType::GoAway:
+            if (stream_id != 0) {
+                fail(Http2Error::ProtocolError);
+            } else if (payload.size() < 8) {
+                fail(Http2Error::FrameSizeError);
+            } else {
+                // 对端不再发起新流，已有的流照常完成
+                peer_goaway_ = true;
+            }
+            break;
+        case FrameType::WindowUpdate:
+            process_window_update(stream_id, payload);
+            break;
+        case FrameType::Continuation:
+            if (continuation_stream_ == 0) {
+                fail(Http2Error::ProtocolError);
+                break;
+            }
+            header_block_.append(payload);
+            if (header_block_.size() > settings_.max_header_list_size * 2) {
+                fail(Http2Error::EnhanceYourCalm);
+                break;
+            }
+            if (flags & kFlagEndHeaders) {
+                continuation_stream_ = 0;
+                process_header_block(stream_id, continuation_end_stream_);
+            }
+            break;
+        default:
+            // 未知类型的帧必须忽略
+            break;
+    }
+}
+
+void Http2Session::process_data(uint8_t flags, uint32_t stream_id, std::string_view payload) {
+    if (stream_id == 0) {
+        fail(Http2Error::ProtocolError);
+        return;
+    }
+    // 流量控制按整个帧负载（包括填充）计算，连接窗口无论流是否存在都要扣减
+    size_t frame_length = payload.size();
+    if (static_cast<int64_t>(frame_length) > connection_receive_window_) {
+        fail(Http2Error::FlowControlError);
+        return;
+    }
+    connection_receive_window_ -= frame_length;
+    connection_unacknowledged_ += frame_length;
+    if (connection_unacknowledged_ >= settings_.connection_window_size / 2) {
+        write_window_update(0, static_cast<uint32_t>(connection_unacknowledged_));
+        connection_receive_window_ += connection_unacknowledged_;
+        connection_unacknowledged_ = 0;
+    }
+    if (!strip_padding(flags, payload)) {
+        fail(Http2Error::ProtocolError);
+        return;
+    }
+
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end()) {
+        // 本端已重置的流上仍在路上的数据直接丢弃
+        if (stream_id > last_stream_id_) {
+            fail(Http2Error::ProtocolError);
+        }
+        return;
+    }
+    std::shared_ptr<Http2Stream> stream = it->second;
+    if (stream->remote_closed) {
+        stream_error(stream_id, Http2Error::StreamClosed);
+        return;
+    }
+    if (static_cast<int64_t>(frame_length) > stream->receive_window) {
+        stream_error(stream_id, Http2Error::FlowControlError);
+        return;
+    }
+    stream->receive_window -= frame_length;
+    stream->received += payload.size();
+    if (stream->content_length >= 0 && stream->received > static_cast<uint64_t>(stream->content_length)) {
+        stream_error(stream_id, Http2Error::ProtocolError);
+        return;
+    }
+
+    // 已被拒绝（已经交给服务器）的请求不再接收请求体
+    if (!stream->dispatched && !payload.empty()) {
+        if (stream->body_sink) {
+            try {
+                stream->body_sink(payload);
+            } catch (const std::exception&) {
+                stream->reject_status = 500;
+            }
+        } else if (stream->request.body.size() + payload.size() > settings_.max_body_size) {
+            stream->reject_status = 413;
+        } else {
+            stream->request.body.append(payload);
+        }
+        if (stream->reject_status != 0) {
+            // 不等请求体结束就响应，响应发完后以RST_STREAM(NO_ERROR)让客户端停止发送
+            stream->dispatched = true;
+            callbacks_.on_request(stream);
+        }
+    }
+    if (stream->closed) {
+        return;
+    }
+
+    if (flags & kFlagEndStream) {
+        if (stream->content_length >= 0 && stream->received != static_cast<uint64_t>(stream->content_length)) {
+            stream_error(stream_id, Http2Error::ProtocolError);
+            return;
+        }
+        finish_request(stream);
+        return;
+    }
+    // 数据已被消费（交给处理器或追加到请求体），归还流的接收窗口
+    stream->unacknowledged += frame_length;
+    if (stream->unacknowledged >= settings_.initial_window_size / 2) {
+        write_window_update(stream_id, static_cast<uint32_t>(stream->unacknowledged));
+        stream->receive_window += stream->unacknowledged;
+        stream->unacknowledged = 0;
+    }
+}
+
+void Http2Session::process_headers(uint8_t flags, uint32_t stream_id, std::string_view payload) {
+    if (stream_id == 0 || stream_id % 2 == 0) {
+        fail(Http2Error::ProtocolError);
+        return;
+    }
+    if (!strip_padding(flags, payload)) {
+        fail(Http2Error::ProtocolError);
+        return;
+    }
+    if (flags & kFlagPriority) {
+        if (payload.size() < 5) {
+            fail(Http2Error::FrameSizeError);
+            return;
+        }
+        payload.remove_prefix(5);
+    }
+    header_block_.assign(payload);
+    if (flags & kFlagEndHeaders) {
+        process_header_block(stream_id, flags & kFlagEndStream);
+    } else {
+        continuation_stream_ = stream_id;
+        continuation_end_stream_ = flags & kFlagEndStream;
+    }
+}
+
+void Http2Session::process_header_block(uint32_t stream_id, bool end_stream) {
+    // 任何头部块都必须解码，否则两端的动态表不再同步
+    auto it = streams_.find(stream_id);
+    if (it != streams_.end() || stream_id <= last_stream_id_) {
+        if (!decoder_.decode(header_block_, [](std::string_view, std::string_view) {})) {
+            fail(Http2Error::CompressionError);
+            return;
+        }
+        if (it == streams_.end()) {
+            // 本端已经结束的流，忽略
+            return;
+        }
+        // 已有流上的头部块是尾部（trailers），内容忽略，必须结束请求
+        std::shared_ptr<Http2Stream> stream = it->second;
+        if (stream->remote_closed) {
+            stream_error(stream_id, Http2Error::StreamClosed);
+        } else if (!end_stream ||
+                   (stream->content_length >= 0 && stream->received != static_cast<uint64_t>(stream->content_length))) {
+            stream_error(stream_id, Http2Error::ProtocolError);
+        } else {
+            finish_request(stream);
+        }
+        return;
+    }
+
+    last_stream_id_ = stream_id;
+    auto stream = std::make_shared<Http2Stream>(stream_id);
+    bool valid = decode_request(*stream);
+    if (failed_ || goaway_sent_) {
+        // GOAWAY之后的新流不处理，客户端可以在新连接上重试
+        return;
+    }
+    if (streams_.size() >= settings_.max_concurrent_streams) {
+        write_rst_stream(stream_id, Http2Error::RefusedStream);
+        return;
+    }
+    if (!valid) {
+        write_rst_stream(stream_id, Http2Error::ProtocolError);
+        return;
+    }
+
+    ++streams_accepted_;
+    stream->send_window = peer_initial_window_;
+    stream->receive_window = settings_.initial_window_size;
+    stream->started = std::chrono::steady_clock::now();
+    streams_.emplace(stream_id, stream);
+    callbacks_.on_headers(stream);
+    if (stream->closed) {
+        return;
+    }
+    if (end_stream) {
+        finish_request(stream);
+    } else if (stream->reject_status != 0) {
+        stream->dispatched = true;
+        callbacks_.on_request(stream);
+    }
+}
+
+bool Http2Session::decode_request(Http2Stream& stream) {
+    Request& request = stream.request;
+    std::string authority;
+    bool regular_seen = false;
+    bool malformed = false;
+    bool too_large = false;
+    bool has_method = false;
+    bool has_scheme = false;
+    bool has_path = false;
+    bool has_authority = false;
+    size_t list_size = 0;
+
+    bool decoded = decoder_.decode(header_block_, [&](std::string_view name, std::string_view value) {
+        // 头部列表大小按解码后的长度加每项32字节计算（RFC 9113 6.5.2）
+        list_size += name.size() + value.size() + 32;
+        if (list_size > settings_.max_header_list_size) {
+            too_large = true;
+        }
+        if (malformed || too_large) {
+            return;
+        }
+        if (name.empty()) {
+            malformed = true;
+            return;
+        }
+        if (name[0] == ':') {
+            // 伪头部只能出现在普通头部之前，且每个只能出现一次
+            if (regular_seen) {
+                malformed = true;
+            } else if (name == ":method" && !has_method) {
+                request.method.assign(value);
+                has_method = !value.empty();
+                malformed = !has_method;
+            } else if (name == ":path" && !has_path) {
+                size_t query = value.find('?');
+                request.path.assign(value.substr(0, query));
+                if (query != std::string_view::npos) {
+                    request.query.assign(value.substr(query + 1));
+                }
+                has_path = !value.empty();
+                malformed = !has_path;
+            } else if (name == ":scheme" && !has_scheme) {
+                has_scheme = !value.empty();
+                malformed = !has_scheme;
+            } else if (name == ":authority" && !has_authority) {
+                authority.assign(value);
+                has_authority = true;
+            } else {
+                malformed = true;
+            }
+            return;
+        }
+        regular_seen = true;
+        for (char c : name) {
+            if (c >= 'A' && c <= 'Z') {
+                malformed = true;
+                return;
+            }
+        }
+        if (connection_specific(name) || (name == "te" && value != "trailers")) {
+            malformed = true;
+            return;
+        }
+        if (name == "cookie") {
+            // 客户端可以把Cookie拆成多个头部以提高压缩率，交给处理器前按HTTP/1.1的形式合并
+            std::pmr::string& cookie = request.headers["cookie"];
+            if (!cookie.empty()) {
+                cookie.append("; ");
+            }
+            cookie.append(value);
+            return;
+        }
+        request.headers.add(name, value);
+    });
+    if (!decoded) {
+        fail(Http2Error::CompressionError);
+        return false;
+    }
+    if (too_large) {
+        stream.reject_status = 431;
+        return true;
+    }
+    if (malformed || !has_method || !has_scheme || !has_path) {
+        return false;
+    }
+
+    request.version = "HTTP/2";
+    // 处理器按Host查找目标主机
+    if (has_authority && !request.headers.contains(HeaderId::Host)) {
+        request.headers.add(HeaderId::Host, "host", authority);
+    }
+    if (const std::pmr::string* length = request.find_header(HeaderId::ContentLength)) {
+        uint64_t value = 0;
+        auto result = std::from_chars(length->data(), length->data() + length->size(), value);
+        if (result.ec != std::errc() || result.ptr != length->data() + length->size()) {
+            return false;
+        }
+        stream.content_length = static_cast<int64_t>(value);
+    }
+    return true;
+}
+
+void Http2Session::finish_request(const std::shared_ptr<Http2Stream>& stream) {
+    if (stream->closed) {
+        return;
+    }
+    stream->remote_closed = true;
+    if (!stream->dispatched) {
+        stream->dispatched = true;
+        callbacks_.on_request(stream);
+    }
+}
+
+bool Http2Session::process_settings(std::string_view payload) {
+    if (payload.size() % 6 != 0) {
+        fail(Http2Error::FrameSizeError);
+        return false;
+    }
+    for (size_t offset = 0; offset < payload.size(); offset += 6) {
+        uint16_t id = static_cast<uint16_t>((static_cast<uint8_t>(payload[offset]) << 8) |
+                                            static_cast<uint8_t>(payload[offset + 1]));
+        uint32_t value = read_u32(payload.substr(offset + 2));
+        switch (id) {
+            case kSettingsHeaderTableSize:
+                encoder_.set_max_table_size(value);
+                break;
+            case kSettingsEnablePush:
+                // 服务器从不推送，只检查取值
+                if (value > 1) {
+                    fail(Http2Error::ProtocolError);
+                    return false;
+                }
+                break;
+            case kSettingsInitialWindowSize: {
+                if (value > kMaxWindow) {
+                    fail(Http2Error::FlowControlError);
+                    return false;
+                }
+                // 新的初始窗口按差值作用于所有已打开的流，窗口可以因此变为负数
+                int64_t delta = static_cast<int64_t>(value) - peer_initial_window_;
+                peer_initial_window_ = value;
+                for (auto& [id, stream] : streams_) {
+                    stream->send_window += delta;
+                    if (stream->send_window > kMaxWindow) {
+                        fail(Http2Error::FlowControlError);
+                        return false;
+                    }
+                    if (delta > 0 && (stream->pending() > 0 || stream->end_queued)) {
+                        schedule(stream);
+                    }
+                }
+                break;
+            }
+            case kSettingsMaxFrameSize:
+                if (value < 16384 || value > 16777215) {
+                    fail(Http2Error::ProtocolError);
+                    return false;
+                }
+                peer_max_frame_size_ = value;
+                break;
+            default:
+                // MAX_CONCURRENT_STREAMS只约束本端发起的流（推送），MAX_HEADER_LIST_SIZE是建议值；未知设置忽略
+                break;
+        }
+    }
+    return true;
+}
+
+void Http2Session::process_window_update(uint32_t stream_id, std::string_view payload) {
+    if (payload.size() != 4) {
+        fail(Http2Error::FrameSizeError);
+        return;
+    }
+    uint32_t increment = read_u32(payload) & 0x7fffffff;
+    if (stream_id == 0) {
+        if (increment == 0) {
+            fail(Http2Error::ProtocolError);
+            return;
+        }
+        connection_send_window_ += increment;
+        if (connection_send_window_ > kMaxWindow) {
+            fail(Http2Error::FlowControlError);
+        }
+        return;
+    }
+
+    auto it = streams_.find(stream_id);
+    if (it == streams_.end()) {
+        if (stream_id > last_stream_id_) {
+            fail(Http2Error::ProtocolError);
+        }
+        return;
+    }
+    std::shared_ptr<Http2Stream> stream = it->second;
+    if (increment == 0) {
+        stream_error(stream_id, Http2Error::ProtocolError);
+        return;
+    }
+    stream->send_window += increment;
+    if (stream->send_window > kMaxWindow) {
+        stream_error(stream_id, Http2Error::FlowControlError);
+        return;
+    }
+    if (stream->pending() > 0 || stream->end_queued) {
+        schedule(stream);
+    }
+}
+
+void Http2Session::stream_error(uint32_t stream_id, Http2Error error) {
+    write_rst_stream(stream_id, error);
+    auto it = streams_.find(stream_id);
+    if (it != streams_.end()) {
+        close_stream(it->second);
+    }
+}
+
+void Http2Session::submit_response(const std::shared_ptr<Http2Stream>& stream, Response&& response) {
+    if (stream->closed || stream->responded) {
+        return;
+    }
+    int status = response.status_code;
+    bool bodyless = status < 200 || status == 204 || status == 304;
+    stream->discard = bodyless || stream->request.method == "HEAD";
+
+    // 与HTTP/1.1的write_head一样补充缺省的Content-Length和Content-Type
+    begin_headers(status);
+    for (const HeaderMap::Entry& header : response.headers) {
+        add_header(header.name, header.value);
+    }
+    uint64_t length = response.file.file ? response.file.length : response.body.size();
+    if (!bodyless) {
+        if (!response.headers.contains(HeaderId::ContentLength)) {
+            char number[24];
+            auto result = std::to_chars(number, number + sizeof(number), length);
+            add_header("content-length", std::string_view(number, result.ptr - number));
+        }
+        if (!response.headers.contains(HeaderId::ContentType)) {
+            add_header("content-type", "text/html; charset=utf-8");
+        }
+    }
+
+    bool has_body = !stream->discard && length > 0;
+    write_headers(stream, !has_body);
+    if (!has_body) {
+        return;
+    }
+    if (response.file.file) {
+        stream->file = std::move(response.file.file);
+        stream->file_offset = response.file.offset;
+        stream->file_remaining = response.file.length;
+    } else {
+        stream->body = std::move(response.body);
+        stream->body_offset = 0;
+    }
+    stream->end_queued = true;
+    schedule(stream);
+}
+
+void Http2Session::submit_message(const std::shared_ptr<Http2Stream>& stream, std::string_view message) {
+    if (stream->closed || stream->responded) {
+        return;
+    }
+    // 报文由Response::write_head生成："HTTP/1.1 200 OK\r\n"，之后每行一个"Name: value"
+    size_t head_end = message.find("\r\n\r\n");
+    size_t line_end = message.find("\r\n");
+    if (head_end == std::string_view::npos || message.size() < 12) {
+        reset_stream(stream, Http2Error::InternalError);
+        return;
+    }
+    int status = (message[9] - '0') * 100 + (message[10] - '0') * 10 + (message[11] - '0');
+    bool bodyless = status < 200 || status == 204 || status == 304;
+    stream->discard = bodyless || stream->request.method == "HEAD";
+
+    begin_headers(status);
+    while (line_end < head_end) {
+        size_t start = line_end + 2;
+        line_end = message.find("\r\n", start);
+        std::string_view line = message.substr(start, line_end - start);
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        std::string_view value = line.substr(colon + 1);
+        while (!value.empty() && value.front() == ' ') {
+            value.remove_prefix(1);
+        }
+        add_header(line.substr(0, colon), value);
+    }
+
+    std::string_view body = message.substr(head_end + 4);
+    bool has_body = !stream->discard && !body.empty();
+    write_headers(stream, !has_body);
+    if (has_body) {
+        stream->body.assign(body);
+        stream->body_offset = 0;
+        stream->end_queued = true;
+        schedule(stream);
+    }
+}
+
+void Http2Session::submit_headers(const std::shared_ptr<Http2Stream>& stream, const Response& head) {
+    if (stream->closed || stream->responded) {
+        return;
+    }
+    int status = head.status_code;
+    bool bodyless = status < 200 || status == 204 || status == 304;
+    stream->discard = bodyless || stream->request.method == "HEAD";
+    begin_headers(status);
+    for (const HeaderMap::Entry& header : head.headers) {
+        add_header(header.name, header.value);
+    }
+    if (!bodyless && !head.headers.contains(HeaderId::ContentType)) {
+        add_header("content-type", "text/html; charset=utf-8");
+    }
+    // 没有响应体时随头部结束流，之后的写入和end_stream被忽略
+    write_headers(stream, stream->discard);
+}
+
+void Http2Session::submit_data(const std::shared_ptr<Http2Stream>& stream, std::string_view data) {
+    if (stream->closed || stream->discard || !stream->responded || stream->end_queued || data.empty()) {
+        return;
+    }
+    if (stream->body_offset == stream->body.size()) {
+        stream->body.clear();
+        stream->body_offset = 0;
+    }
+    stream->body.append(data);
+    schedule(stream);
+}
+
+void Http2Session::end_stream(const std::shared_ptr<Http2Stream>& stream) {
+    if (stream->closed || stream->end_queued) {
+        return;
+    }
+    stream->end_queued = true;
+    schedule(stream);
+}
+
+void Http2Session::reset_stream(const std::shared_ptr<Http2Stream>& stream, Http2Error error) {
+    if (stream->closed) {
+        return;
+    }
+    write_rst_stream(stream->id, error);
+    close_stream(stream);
+}
+
+void Http2Session::shutdown() {
+    if (goaway_sent_) {
+        return;
+    }
+    write_frame_header(8, static_cast<uint8_t>(FrameType::GoAway), 0, 0);
+    append_u32(output_, last_stream_id_);
+    append_u32(output_, static_cast<uint32_t>(Http2Error::NoError));
+    goaway_sent_ = true;
+}
+
+void Http2Session::close_all() {
+    std::vector<std::shared_ptr<Http2Stream>> streams;
+    streams.reserve(streams_.size());
+    for (auto& [id, stream] : streams_) {
+        streams.push_back(stream);
+    }
+    for (auto& stream : streams) {
+        close_stream(stream);
+    }
+    ready_.clear();
+}
+
+bool Http2Session::take_output(std::string& out) {
+    produce_data();
+    if (output_.empty()) {
+        return false;
+    }
+    out.swap(output_);
+    output_.clear();
+    return true;
+}
+
+bool Http2Session::flow_blocked() const {
+    for (const auto& [id, stream] : streams_) {
+        if (stream->responded && stream->pending() > 0 && (stream->send_window <= 0 || connection_send_window_ <= 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Http2Session::fail(Http2Error error) {
+    if (failed_) {
+        return;
+    }
+    // 连接级错误：告知对端最后处理的流，之后只等输出发完关闭连接
+    write_frame_header(8, static_cast<uint8_t>(FrameType::GoAway), 0, 0);
+    append_u32(output_, last_stream_id_);
+    append_u32(output_, static_cast<uint32_t>(error));
+    failed_ = true;
+    goaway_sent_ = true;
+}
+
+void Http2Session::write_frame_header(size_t length, uint8_t type, uint8_t flags, uint32_t stream_id) {
+    output_.push_back(static_cast<char>(length >> 16));
+    output_.push_back(static_cast<char>(length >> 8));
+    output_.push_back(static_cast<char>(length));
+    output_.push_back(static_cast<char>(type));
+    output_.push_back(static_cast<char>(flags));
+    append_u32(output_, stream_id);
+}
+
+void Http2Session::write_settings() {
+    std::pair<uint16_t, uint32_t> values[] = {
+        {kSettingsMaxConcurrentStreams, settings_.max_concurrent_streams},
+        {kSettingsInitialWindowSize, settings_.initial_window_size},
+        {kSettingsMaxFrameSize, settings_.max_frame_size},
+        {kSettingsMaxHeaderListSize, settings_.max_header_list_size},
+    };
+    write_frame_header(sizeof(values) / sizeof(values[0]) * 6, static_cast<uint8_t>(FrameType::Settings), 0, 0);
+    for (const auto& [id, value] : values) {
+        output_.push_back(static_cast<char>(id >> 8));
+        output_.push_back(static_cast<char>(id));
+        append_u32(output_, value);
+    }
+}
+
+void Http2Session::write_window_update(uint32_t stream_id, uint32_t increment) {
+    write_frame_header(4, static_cast<uint8_t>(FrameType::WindowUpdate), 0, stream_id);
+    append_u32(output_, increment);
+}
+
+void Http2Session::write_rst_stream(uint32_t stream_id, Http2Error error) {
+    write_frame_header(4, static_cast<uint8_t>(FrameType::RstStream), 0, stream_id);
+    append_u32(output_, static_cast<uint32_t>(error));
+}
+
+void Http2Session::begin_headers(int status) {
+    block_.clear();
+    encoder_.begin_block(block_);
+    encoder_.encode_status(status, block_);
+}
+
+void Http2Session::add_header(std::string_view name, std::string_view value) {
+    // HTTP/2的头部名称必须是小写
+    lower_name_.assign(name);
+    for (char& c : lower_name_) {
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    if (connection_specific(lower_name_)) {
+        return;
+    }
+    encoder_.encode(lower_name_, value, block_);
+}
+
+void Http2Session::write_headers(const std::shared_ptr<Http2Stream>& stream, bool end_stream) {
+    stream->responded = true;
+    stream->send_started = std::chrono::steady_clock::now();
+    stream->response_bytes += block_.size();
+
+    // 超过对端最大帧的头部块拆成HEADERS和若干CONTINUATION，中间不能插入其他帧
+    std::string_view block = block_;
+    size_t length = std::min<size_t>(block.size(), peer_max_frame_size_);
+    uint8_t flags = (length == block.size() ? kFlagEndHeaders : 0) | (end_stream ? kFlagEndStream : 0);
+    write_frame_header(length, static_cast<uint8_t>(FrameType::Headers), flags, stream->id);
+    output_.append(block.substr(0, length));
+    block.remove_prefix(length);
+    while (!block.empty()) {
+        length = std::min<size_t>(block.size(), peer_max_frame_size_);
+        write_frame_header(length, static_cast<uint8_t>(FrameType::Continuation),
+                           length == block.size() ? kFlagEndHeaders : 0, stream->id);
+        output_.append(block.substr(0, length));
+        block.remove_prefix(length);
+    }
+    if (end_stream) {
+        // 请求还没发完（提前拒绝）时让客户端停止发送，流随之关闭
+        if (!stream->remote_closed) {
+            write_rst_stream(stream->id, Http2Error::NoError);
+        }
+        close_stream(stream);
+    }
+}
+
+void Http2Session::schedule(const std::shared_ptr<Http2Stream>& stream) {
+    if (!stream->ready && !stream->closed) {
+        stream->ready = true;
+        ready_.push_back(stream);
+    }
+}
+
+void Http2Session::produce_data() {
+    // 各流轮流发送一个帧，输出积压到上限后停止，等这一批发出后再继续
+    while (!ready_.empty() && output_.size() < settings_.max_buffered_output) {
+        std::shared_ptr<Http2Stream> stream = ready_.front();
+        uint64_t pending = stream->pending();
+        if (stream->closed || (pending == 0 && !stream->end_queued)) {
+            ready_.pop_front();
+            stream->ready = false;
+            continue;
+        }
+        if (pending > 0 && connection_send_window_ <= 0) {
+            // 等待连接的WINDOW_UPDATE，所有流保持排队
+            break;
+        }
+        ready_.pop_front();
+        stream->ready = false;
+        if (pending > 0 && stream->send_window <= 0) {
+            // 等待该流的WINDOW_UPDATE，届时重新排队
+            continue;
+        }
+
+        size_t length = static_cast<size_t>(std::min<uint64_t>(
+            {pending, static_cast<uint64_t>(std::max<int64_t>(stream->send_window, 0)),
+             static_cast<uint64_t>(std::max<int64_t>(connection_send_window_, 0)), peer_max_frame_size_}));
+        bool last = length == pending && stream->end_queued;
+        size_t frame_start = output_.size();
+        write_frame_header(length, static_cast<uint8_t>(FrameType::Data), last ? kFlagEndStream : 0, stream->id);
+
+        size_t from_body = std::min<size_t>(length, stream->body.size() - stream->body_offset);
+        output_.append(stream->body, stream->body_offset, from_body);
+        stream->body_offset += from_body;
+        if (stream->body_offset == stream->body.size()) {
+            stream->body.clear();
+            stream->body_offset = 0;
+        }
+        size_t from_file = length - from_body;
+        if (from_file > 0) {
+            // 文件区间按窗口分块读入输出缓冲，不整体读入内存
+            size_t at = output_.size();
+            output_.resize(at + from_file);
+            size_t done = 0;
+            while (done < from_file) {
+                ssize_t n = pread(stream->file->fd(), output_.data() + at + done, from_file - done,
+                                  static_cast<off_t>(stream->file_offset + done));
+                if (n > 0) {
+                    done += n;
+                } else if (n < 0 && errno == EINTR) {
+                    continue;
+                } else {
+                    break;
+                }
+            }
+            if (done < from_file) {
+                // 文件在缓存期间被截断，已声明的Content-Length无法满足
+                output_.resize(frame_start);
+                reset_stream(stream, Http2Error::InternalError);
+                continue;
+            }
+            stream->file_offset += from_file;
+            stream->file_remaining -= from_file;
+            if (stream->file_remaining == 0) {
+                stream->file.reset();
+            }
+        }
+
+        stream->send_window -= length;
+        connection_send_window_ -= length;
+        stream->response_bytes += length;
+        if (last) {
+            if (!stream->remote_closed) {
+                write_rst_stream(stream->id, Http2Error::NoError);
+            }
+            close_stream(stream);
+            continue;
+        }
+        if (stream->pending() > 0 || stream->end_queued) {
+            schedule(stream);
+        } else if (stream->waiting && callbacks_.on_writable) {
+            callbacks_.on_writable(stream);
+        }
+    }
+}
+
+void Http2Session::close_stream(std::shared_ptr<Http2Stream> stream) {
+    // 按值接收：调用者传入的可能正是streams_中即将删除的那个shared_ptr
+    if (stream->closed) {
+        return;
+    }
+    stream->closed = true;
+    streams_.erase(stream->id);
+    if (callbacks_.on_close) {
+        callbacks_.on_close(stream);
+    }
+    if (stream->waiting && callbacks_.on_writable) {
+        callbacks_.on_writable(stream);
+    }
+}
+
+bool decode_http2_settings(std::string_view value, std::string& payload) {
+    // base64url，同时接受标准字母表和末尾的填充
+    while (!value.empty() && value.back() == '=') {
+        value.remove_suffix(1);
+    }
+    payload.clear();
+    uint32_t bits = 0;
+    int count = 0;
+    for (char c : value) {
+        int digit;
+        if (c >= 'A' && c <= 'Z') {
+            digit = c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+            digit = c - 'a' + 26;
+        } else if (c >= '0' && c <= '9') {
+            digit = c - '0' + 52;
+        } else if (c == '-' || c == '+') {
+            digit = 62;
+        } else if (c == '_' || c == '/') {
+            digit = 63;
+        } else {
+            return false;
+        }
+        bits = (bits << 6) | static_cast<uint32_t>(digit);
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            payload.push_back(static_cast<char>(bits >> count));
+        }
+    }
+    return payload.size() % 6 == 0;
+}
+
+} // namespace http
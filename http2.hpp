@@ -0,0 +1,236 @@
+#pragma once
+
+#include "http_server.hpp"
+#include "hpack.hpp"
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace http {
+
+// 错误码（RFC 9113 7）
+enum class Http2Error : uint32_t {
+    NoError = 0x0,
+    ProtocolError = 0x1,
+    InternalError = 0x2,
+    FlowControlError = 0x3,
+    SettingsTimeout = 0x4,
+    StreamClosed = 0x5,
+    FrameSizeError = 0x6,
+    RefusedStream = 0x7,
+    Cancel = 0x8,
+    CompressionError = 0x9,
+    ConnectError = 0xa,
+    EnhanceYourCalm = 0xb,
+    InadequateSecurity = 0xc,
+    Http11Required = 0xd
+};
+
+// 客户端连接序言，以先验知识使用h2c时连接的第一批字节
+constexpr std::string_view kHttp2Preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+/**
+ * 服务器端的一个HTTP/2流，即一次请求和响应
+ * 请求在堆上（流之间生命周期交错，不能共用连接的arena），处理器以引用方式读取；
+ * 服务器和工作线程通过shared_ptr持有，流被重置后仍然有效，只是不再发送任何数据。
+ * 除request外的字段只在连接所属的事件循环线程上访问。
+ */
+struct Http2Stream {
+    explicit Http2Stream(uint32_t stream_id) : id(stream_id) {}
+
+    const uint32_t id;
+    Request request{std::pmr::new_delete_resource()};
+
+    // 由服务器在请求头到达时设置
+    const Route* route = nullptr;
+    uint32_t metrics_route = 0;
+    std::function<void(std::string_view)> body_sink;   // 流式请求体处理器的分块回调
+    RequestHandler body_complete;
+    int reject_status = 0;      // 非0时请求无法处理（头部过大、请求体超限等），应直接以该状态码响应
+    bool screened = false;      // 全局中间件已在I/O线程上运行，middleware_headers为其添加的头部
+    HeaderMap middleware_headers;
+
+    // 接收方向
+    bool dispatched = false;    // 已交给服务器处理
+    bool remote_closed = false; // 已收到END_STREAM
+    int64_t receive_window = 0;
+    uint64_t unacknowledged = 0;        // 已消费但尚未以WINDOW_UPDATE归还的字节数
+    uint64_t received = 0;              // 已收到的请求体字节数
+    int64_t content_length = -1;        // 请求声明的Content-Length
+
+    // 发送方向
+    bool responded = false;     // 响应头已发送
+    bool end_queued = false;    // 响应已结束，待发送的响应体发完后带END_STREAM
+    bool closed = false;        // 已结束或被重置，不再发送任何帧
+    bool discard = false;       // HEAD请求或无响应体的状态码，写入的响应体被丢弃
+    bool ready = false;         // 在待发送队列中
+    int64_t send_window = 0;
+    std::pmr::string body{std::pmr::get_default_resource()};   // 等待流量控制窗口的响应体
+    size_t body_offset = 0;
+    std::shared_ptr<const OpenFile> file;   // 在body之后发送的文件区间
+    uint64_t file_offset = 0;
+    uint64_t file_remaining = 0;
+    std::coroutine_handle<> waiting;        // 因响应体积压而挂起的流式响应处理器
+
+    // 指标与访问日志
+    std::chrono::steady_clock::time_point started;        // 请求头到达的时间
+    std::chrono::steady_clock::time_point send_started;   // 响应头发出的时间
+    int response_status = 0;
+    uint64_t response_bytes = 0;    // 头部块和DATA负载的字节数
+
+    // 尚未发送的响应体字节数
+    uint64_t pending() const { return body.size() - body_offset + file_remaining; }
+};
+
+/**
+ * 服务器端HTTP/2会话（RFC 9113，仅明文h2c）
+ * 只处理协议本身：帧的解析与生成、HPACK、流状态、双向流量控制和SETTINGS/PING/GOAWAY，
+ * 不做任何I/O。连接把收到的字节交给receive()，请求完整时经回调交给服务器；服务器提交的响应
+ * 先写入输出缓冲，DATA帧在take_output()时按连接和流的发送窗口轮流生成，输出积压超过上限时暂停，
+ * 因此每个连接缓存的数据有上限。所有方法只能在连接所属的事件循环线程上调用。
+ */
+class Http2Session {
+public:
+    struct Settings {
+        uint32_t max_concurrent_streams = 100;
+        uint32_t initial_window_size = 1 << 20;       // 每个流的接收窗口
+        uint32_t connection_window_size = 1 << 24;    // 连接的接收窗口
+        uint32_t max_frame_size = 16384;              // 接收的最大帧负载
+        uint32_t max_header_list_size = 16384;        // 解码后的请求头上限，超出时以431响应
+        size_t max_body_size = 8 * 1024 * 1024;       // 未设置body_sink的流的请求体上限，超出时以413响应
+        size_t max_buffered_output = 64 * 1024;       // 输出缓冲超过该值时暂停生成DATA帧
+    };
+
+    struct Callbacks {
+        // 请求头收齐：查找路由、设置body_sink或reject_status
+        std::function<void(const std::shared_ptr<Http2Stream>&)> on_headers;
+        // 请求完整（或设置了reject_status），服务器应当响应
+        std::function<void(const std::shared_ptr<Http2Stream>&)> on_request;
+        // 流结束或被重置，之后对它的提交都被忽略
+        std::function<void(const std::shared_ptr<Http2Stream>&)> on_close;
+        // 挂起的流式响应处理器可以继续写入（积压的响应体已全部交给输出缓冲，或流已关闭）
+        std::function<void(const std::shared_ptr<Http2Stream>&)> on_writable;
+    };
+
+    // 输出服务器的SETTINGS帧和连接窗口的WINDOW_UPDATE
+    Http2Session(const Settings& settings, Callbacks callbacks);
+
+    Http2Session(const Http2Session&) = delete;
+    Http2Session& operator=(const Http2Session&) = delete;
+
+    /**
+     * 以HTTP/1.1 Upgrade方式开始
+     * settings为HTTP2-Settings头部解码后的SETTINGS负载，升级请求成为已半关闭的流1，
+     * 由调用者直接处理（不经过on_request）。设置无效时返回nullptr。
+     */
+    std::shared_ptr<Http2Stream> upgrade(std::string_view settings, const Request& request);
+
+    // 处理收到的数据，返回消费的字节数（不完整的帧留到下次）；
+    // 连接级错误时发送GOAWAY并消费全部输入，之后failed()为true
+    size_t receive(std::string_view data);
+
+    // 提交完整响应，响应体移入流中按窗口发送；file区间之后以pread分块读出
+    void submit_response(const std::shared_ptr<Http2Stream>& stream, Response&& response);
+
+    // 提交预先序列化的HTTP/1.1报文（静态路由、响应缓存），状态行和头部转为HPACK头部块
+    void submit_message(const std::shared_ptr<Http2Stream>& stream, std::string_view message);
+
+    // 流式响应：先提交响应头，再逐段提交响应体，最后end_stream
+    void submit_headers(const std::shared_ptr<Http2Stream>& stream, const Response& head);
+    void submit_data(const std::shared_ptr<Http2Stream>& stream, std::string_view data);
+    void end_stream(const std::shared_ptr<Http2Stream>& stream);
+
+    // 以RST_STREAM结束流
+    void reset_stream(const std::shared_ptr<Http2Stream>& stream, Http2Error error);
+
+    // 优雅关闭：发送GOAWAY，不再接受新流，已有的流继续完成
+    void shutdown();
+
+    // 连接被关闭时结束所有流（恢复挂起的处理器）
+    void close_all();
+
+    // 按发送窗口生成DATA帧，把全部待发送数据移入out（out原有内容被丢弃），没有数据时返回false
+    bool take_output(std::string& out);
+
+    // 输出积压超过上限，应暂停读取直到数据发出
+    bool output_blocked() const { return output_.size() >= settings_.max_buffered_output * 4; }
+
+    // 有响应体因对端的流量控制窗口耗尽而无法发送，连接应按发送超时计时
+    bool flow_blocked() const;
+
+    size_t open_streams() const { return streams_.size(); }
+    uint64_t streams_accepted() const { return streams_accepted_; }
+    bool failed() const { return failed_; }
+
+    // 连接可以关闭：出错，或GOAWAY之后所有流都已结束
+    bool finished() const { return failed_ || ((goaway_sent_ || peer_goaway_) && streams_.empty()); }
+
+private:
+    Settings settings_;
+    Callbacks callbacks_;
+    HpackDecoder decoder_;
+    HpackEncoder encoder_;
+    std::string output_;
+    std::string block_;             // 正在生成的头部块
+    std::string header_block_;      // 正在接收的头部块（HEADERS + CONTINUATION）
+    std::string lower_name_;        // 转为小写的响应头名称
+
+    std::unordered_map<uint32_t, std::shared_ptr<Http2Stream>> streams_;
+    std::deque<std::shared_ptr<Http2Stream>> ready_;    // 有响应体等待发送的流，轮流发送
+
+    bool preface_received_ = false;
+    bool settings_received_ = false;
+    bool goaway_sent_ = false;
+    bool peer_goaway_ = false;
+    bool failed_ = false;
+    uint32_t last_stream_id_ = 0;           // 对端发起的最大流编号
+    uint32_t continuation_stream_ = 0;      // 等待CONTINUATION的流，0表示没有
+    bool continuation_end_stream_ = false;
+    uint64_t streams_accepted_ = 0;
+
+    // 对端的设置和发送窗口
+    uint32_t peer_max_frame_size_ = 16384;
+    int64_t peer_initial_window_ = 65535;
+    int64_t connection_send_window_ = 65535;
+
+    // 连接接收窗口
+    int64_t connection_receive_window_ = 65535;
+    uint64_t connection_unacknowledged_ = 0;
+
+    void write_frame_header(size_t length, uint8_t type, uint8_t flags, uint32_t stream_id);
+    void write_settings();
+    void write_window_update(uint32_t stream_id, uint32_t increment);
+    void write_rst_stream(uint32_t stream_id, Http2Error error);
+    void fail(Http2Error error);
+
+    void process_frame(uint8_t type, uint8_t flags, uint32_t stream_id, std::string_view payload);
+    void process_data(uint8_t flags, uint32_t stream_id, std::string_view payload);
+    void process_headers(uint8_t flags, uint32_t stream_id, std::string_view payload);
+    void process_header_block(uint32_t stream_id, bool end_stream);
+    bool process_settings(std::string_view payload);
+    void process_window_update(uint32_t stream_id, std::string_view payload);
+    bool decode_request(Http2Stream& stream);
+    void finish_request(const std::shared_ptr<Http2Stream>& stream);
+    void stream_error(uint32_t stream_id, Http2Error error);
+
+    // 响应头：begin_headers之后逐个add_header，最后write_headers输出HEADERS（和CONTINUATION）帧
+    void begin_headers(int status);
+    void add_header(std::string_view name, std::string_view value);
+    void write_headers(const std::shared_ptr<Http2Stream>& stream, bool end_stream);
+
+    void schedule(const std::shared_ptr<Http2Stream>& stream);
+    void produce_data();
+    void close_stream(std::shared_ptr<Http2Stream> stream);
+};
+
+// 解码HTTP2-Settings头部（base64url，无填充）得到SETTINGS负载，格式错误时返回false
+bool decode_http2_settings(std::string_view value, std::string& payload);
+
+} // namespace http
@@ -1,54 +1,443 @@
 #include "http_server.hpp"
+#include "event_loop.hpp"
+#include "connection.hpp"
+#include "thread_pool.hpp"
+#include "request_parser.hpp"
+#include "static_response.hpp"
+#include "compression.hpp"
+#include "io_uring.hpp"
+#include "static_files.hpp"
+#include "metrics.hpp"
+#include "async_io.hpp"
+#include "load_shedder.hpp"
+#include "response_cache.hpp"
+#include "middleware.hpp"
+#include "access_log.hpp"
+#include "http2.hpp"
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#include <poll.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <cerrno>
+#include <csignal>
 #include <iostream>
-#include <sstream>
+#include <charconv>
+#include <string_view>
 #include <algorithm>
 #include <stdexcept>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+#include <utility>
 
 namespace http {
 
-std::string Response::to_string() const {
-    std::ostringstream oss;
-    oss << "HTTP/1.1 " << status_code << " " << status_text << "\r\n";
-    
-    // 添加默认头部
-    auto headers_copy = headers;
-    if (headers_copy.find("Content-Length") == headers_copy.end()) {
-        headers_copy["Content-Length"] = std::to_string(body.length());
+namespace {
+
+// io_uring模式下数据由内核主动推送，处理请求期间积压超过该值即暂停接收
+constexpr size_t kMaxPendingInput = 256 * 1024;
+
+// 判断逗号分隔的头部值中是否包含指定token（如 Connection: keep-alive, Upgrade）
+bool header_has_token(std::string_view value, const char* token) {
+    size_t start = 0;
+    while (start < value.size()) {
+        size_t end = value.find(',', start);
+        if (end == std::string_view::npos) {
+            end = value.size();
+        }
+        size_t first = value.find_first_not_of(" \t", start);
+        size_t last = value.find_last_not_of(" \t", end - 1);
+        if (first != std::string_view::npos && first < end && last >= first) {
+            if (iequals(value.substr(first, last - first + 1), token)) {
+                return true;
+            }
+        }
+        start = end + 1;
+    }
+    return false;
+}
+
+// HTTP/1.1默认保持连接，HTTP/1.0需显式声明keep-alive
+bool wants_keep_alive(const Request& request) {
+    const std::pmr::string* connection = request.find_header(HeaderId::Connection);
+    if (request.version == "HTTP/1.1") {
+        return !(connection && header_has_token(*connection, "close"));
+    }
+    return connection && header_has_token(*connection, "keep-alive");
+}
+
+const char* status_text(int status_code) {
+    switch (status_code) {
+        case 400: return "Bad Request";
+        case 408: return "Request Timeout";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
+        default:  return "Error";
+    }
+}
+
+// 连接当前所处的超时阶段，各阶段对应ServerConfig中的一项超时
+enum class TimeoutPhase {
+    None,      // 处理器执行中（包括流式响应等待处理器写入），不限时
+    Idle,      // 等待下一个请求：keep_alive_timeout，从最后一次活动算起
+    Header,    // 请求头已开始到达：header_timeout，从第一个字节算起，不因活动顺延
+    Body,      // 读取请求体：body_timeout，从最后一次收到数据算起
+    Send       // 发送响应：send_timeout，从最后一次写出数据算起
+};
+
+TimeoutPhase timeout_phase(const Connection& conn) {
+    // HTTP/2连接：有数据发不出去时按发送计时，有流在处理时不限时，否则为空闲
+    if (conn.http2 && conn.state != Connection::State::Closed) {
+        if (conn.output_offset < conn.output_head.size() || conn.http2->flow_blocked()) {
+            return TimeoutPhase::Send;
+        }
+        return conn.http2->open_streams() > 0 ? TimeoutPhase::None : TimeoutPhase::Idle;
+    }
+    switch (conn.state) {
+        case Connection::State::Reading:
+            if (conn.reading_body) {
+                return TimeoutPhase::Body;
+            }
+            return conn.request_started != std::chrono::steady_clock::time_point() ? TimeoutPhase::Header
+                                                                                   : TimeoutPhase::Idle;
+        case Connection::State::Writing:
+            return conn.stream.active && conn.stream.idle ? TimeoutPhase::None : TimeoutPhase::Send;
+        default:
+            return TimeoutPhase::None;
+    }
+}
+
+std::chrono::steady_clock::time_point timeout_deadline(const Connection& conn, TimeoutPhase phase,
+                                                       const ServerConfig& config) {
+    switch (phase) {
+        case TimeoutPhase::Header:
+            return conn.request_started + config.header_timeout;
+        case TimeoutPhase::Body:
+            return conn.last_active + config.body_timeout;
+        case TimeoutPhase::Send:
+            return conn.last_active + config.send_timeout;
+        default:
+            return conn.last_active + config.keep_alive_timeout;
+    }
+}
+
+// HTTP/2连接的输出积压（socket发不出去，会话中又积累了大量帧）时暂停读取，
+// 避免只发送不接收的客户端（如大量PING）让输出无限增长
+bool http2_blocked(const Connection& conn) {
+    return conn.http2 && conn.output_offset < conn.output_head.size() && conn.http2->output_blocked();
+}
+
+// 预生成报文的状态码（"HTTP/1.1 200 ..."）
+int message_status(const std::string& message) {
+    if (message.size() < 12) {
+        return 0;
+    }
+    return (message[9] - '0') * 100 + (message[10] - '0') * 10 + (message[11] - '0');
+}
+
+// 构造错误响应
+Response make_error_response(int status_code, const std::string& message, bool keep_alive) {
+    Response response;
+    response.status_code = status_code;
+    response.status_text = status_text(status_code);
+    response.headers[HeaderId::Connection] = keep_alive ? "keep-alive" : "close";
+    response.body.append("<h1>").append(std::to_string(status_code)).append(" ").append(response.status_text);
+    response.body.append("</h1><p>").append(message).append("</p>");
+    return response;
+}
+
+// 序列化完整报文，供多个连接共享发送
+std::shared_ptr<const std::string> serialize_message(const Response& response, bool keep_alive) {
+    std::string message;
+    message.reserve(256 + response.body.size());
+    response.write_head(message, keep_alive ? "keep-alive" : "close");
+    message.append(response.body);
+    return std::make_shared<const std::string>(std::move(message));
+}
+
+// 处理器的响应能否交给其他请求复用
+bool cacheable_response(const Response& response) {
+    if (response.status_code != 200 || response.file.file || response.headers.contains("Set-Cookie")) {
+        return false;
+    }
+    const std::pmr::string* connection = response.find_header(HeaderId::Connection);
+    if (connection && header_has_token(*connection, "close")) {
+        return false;
+    }
+    const std::pmr::string* cache_control = response.find_header(HeaderId::CacheControl);
+    return !(cache_control && (header_has_token(*cache_control, "no-store") ||
+                               header_has_token(*cache_control, "no-cache") ||
+                               header_has_token(*cache_control, "private")));
+}
+
+// 缓存键：方法、路径、查询字符串、策略列出的请求头（区分缺失与空值），启用动态压缩时加上协商出的编码
+void make_cache_key(const Request& request, const CachePolicy& policy, bool compress, std::string& key) {
+    key.assign(request.method).append(" ").append(request.path);
+    if (!request.query.empty()) {
+        key.append("?").append(request.query);
+    }
+    for (const std::string& name : policy.vary) {
+        key.push_back('\n');
+        if (const std::pmr::string* value = request.find_header(name)) {
+            key.append("=").append(*value);
+        }
+    }
+    if (compress) {
+        const std::pmr::string* accept_encoding = request.find_header(HeaderId::AcceptEncoding);
+        ContentEncoding encoding = accept_encoding ? negotiate_encoding(*accept_encoding) : ContentEncoding::Identity;
+        key.append("\n").push_back(static_cast<char>('0' + static_cast<int>(encoding)));
+    }
+}
+
+// 根据已发送字节数构造剩余的iovec：自有头部、自有响应体、共享的预生成报文（不使用的段为空）
+int fill_output_iov(const Connection& conn, iovec* iov) {
+    const std::string_view segments[3] = {
+        conn.output_head,
+        conn.output_body,
+        conn.output_shared ? std::string_view(*conn.output_shared) : std::string_view(),
+    };
+    int iov_count = 0;
+    size_t offset = conn.output_offset;
+    for (std::string_view segment : segments) {
+        if (offset >= segment.size()) {
+            offset -= segment.size();
+            continue;
+        }
+        iov[iov_count].iov_base = const_cast<char*>(segment.data() + offset);
+        iov[iov_count].iov_len = segment.size() - offset;
+        ++iov_count;
+        offset = 0;
+    }
+    return iov_count;
+}
+
+enum class FileSendStatus {
+    Done,      // 文件区间已全部发送
+    Blocked,   // 发送缓冲区已满，等待可写
+    Failed     // 出错或文件被截断，只能关闭连接
+};
+
+// 以sendfile从页缓存直接发送文件区间，不经过用户态缓冲区
+FileSendStatus send_file_region(Connection& conn) {
+    while (conn.file_remaining > 0) {
+        off_t offset = static_cast<off_t>(conn.file_offset);
+        ssize_t sent = sendfile(conn.fd, conn.output_file->fd(), &offset, conn.file_remaining);
+        if (sent > 0) {
+            conn.file_offset += sent;
+            conn.file_remaining -= sent;
+            conn.last_active = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return FileSendStatus::Blocked;
+        }
+        // 返回0说明文件在缓存期间被截断，已声明的Content-Length无法满足
+        return FileSendStatus::Failed;
+    }
+    return FileSendStatus::Done;
+}
+
+// 中间件在占位响应上添加的头部补到实际响应中，处理器已设置的同名头部不覆盖
+void merge_middleware_headers(Response& response, const HeaderMap& headers) {
+    for (const HeaderMap::Entry& entry : headers) {
+        if (!response.headers.contains(entry.name)) {
+            response.headers.add(entry.id, entry.name, entry.value);
+        }
+    }
+}
+
+} // namespace
+
+const char* io_backend_name(IoBackend backend) {
+    return backend == IoBackend::IoUring ? "io_uring" : "epoll";
+}
+
+std::string_view Request::param(std::string_view name) const {
+    for (size_t i = 0; i < params.count; ++i) {
+        const PathParams::Param& item = params.items[i];
+        if (item.name == name) {
+            return std::string_view(path).substr(item.offset, item.length);
+        }
     }
-    if (headers_copy.find("Content-Type") == headers_copy.end()) {
-        headers_copy["Content-Type"] = "text/html; charset=utf-8";
+    return std::string_view();
+}
+
+void Response::write_head(std::string& out, std::string_view connection, bool content_length) const {
+    char number[24];
+    auto append_number = [&out, &number](size_t value) {
+        auto result = std::to_chars(number, number + sizeof(number), value);
+        out.append(number, result.ptr - number);
+    };
+    
+    out.append("HTTP/1.1 ");
+    append_number(static_cast<size_t>(status_code));
+    out.push_back(' ');
+    out.append(status_text);
+    out.append("\r\n");
+    
+    // 直接遍历头部，缺省头部在末尾补充，不复制headers
+    for (const HeaderMap::Entry& header : headers) {
+        if (header.id != HeaderId::Connection) {
+            out.append(header.name).append(": ").append(header.value).append("\r\n");
+        }
     }
-    headers_copy["Connection"] = "close";
+    bool has_content_length = headers.contains(HeaderId::ContentLength);
+    bool has_content_type = headers.contains(HeaderId::ContentType);
     
-    for (const auto& [key, value] : headers_copy) {
-        oss << key << ": " << value << "\r\n";
+    // 1xx/204/304响应没有响应体
+    bool bodyless = status_code < 200 || status_code == 204 || status_code == 304;
+    if (bodyless) {
+        has_content_length = has_content_type = true;
     }
     
-    oss << "\r\n" << body;
-    return oss.str();
+    if (!has_content_length && content_length) {
+        out.append("Content-Length: ");
+        append_number(file.file ? file.length : body.size());
+        out.append("\r\n");
+    }
+    if (!has_content_type) {
+        out.append("Content-Type: text/html; charset=utf-8\r\n");
+    }
+    out.append("Connection: ").append(connection).append("\r\n\r\n");
+}
+
+std::string Response::to_string() const {
+    const std::pmr::string* connection = find_header(HeaderId::Connection);
+    std::string result;
+    result.reserve(256 + body.size());
+    write_head(result, connection ? std::string_view(*connection) : std::string_view("close"));
+    result.append(body);
+    return result;
+}
+
+HttpServer::HttpServer(int port) : HttpServer(ServerConfig{port}) {
 }
 
-HttpServer::HttpServer(int port) : port_(port), server_socket_(-1) {
-    setup_socket();
+HttpServer::HttpServer(const ServerConfig& config)
+    : config_(config), port_(config.port), metrics_(std::make_unique<Metrics>()) {
+    if (config_.io_threads == 0) {
+        config_.io_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (config_.worker_threads == 0) {
+        config_.worker_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (config_.io_backend == IoBackend::IoUring && !IoUring::supported()) {
+        std::cerr << "当前内核不支持所需的io_uring特性，回退到epoll" << std::endl;
+        config_.io_backend = IoBackend::Epoll;
+    }
+    
+    // 过载时的503报文预先生成，拒绝请求几乎不消耗资源
+    if (config_.load_shedding) {
+        shedder_ = std::make_unique<LoadShedder>(config_.shed_target, config_.shed_interval);
+    }
+    Response overload;
+    overload.status_code = 503;
+    overload.status_text = status_text(503);
+    overload.headers[HeaderId::ContentType] = "text/plain; charset=utf-8";
+    overload.headers["Retry-After"] = std::to_string(config_.retry_after.count());
+    overload.body = "服务器过载，请稍后重试\n";
+    for (bool keep_alive : {false, true}) {
+        overload_response_[keep_alive] = serialize_message(overload, keep_alive);
+    }
+    
+    if (config_.response_cache_size > 0) {
+        response_cache_ = std::make_unique<ResponseCache>(config_.response_cache_size, config_.response_cache_shards);
+    }
+    
+    if (!config_.access_log.empty()) {
+        AccessLog::Options options;
+        options.path = config_.access_log;
+        options.max_size = config_.access_log_max_size;
+        options.max_files = config_.access_log_max_files;
+        options.ring_capacity = config_.access_log_buffer;
+        access_log_ = std::make_unique<AccessLog>(options);
+    }
+    
+    setup_sockets();
 }
 
 HttpServer::~HttpServer() {
     stop();
+    for (int listen_socket : listen_sockets_) {
+        close(listen_socket);
+    }
+    listen_sockets_.clear();
+}
+
+void HttpServer::setup_sockets() {
+    if (!config_.inherited_listeners.empty()) {
+        adopt_listeners();
+        return;
+    }
+    
+    // reuse_port模式下每个事件循环一个监听socket，内核按四元组哈希分配连接，无需共享accept队列
+    size_t count = config_.reuse_port ? config_.io_threads : 1;
+    try {
+        for (size_t i = 0; i < count; ++i) {
+            listen_sockets_.push_back(create_listener());
+        }
+    } catch (...) {
+        for (int listen_socket : listen_sockets_) {
+            close(listen_socket);
+        }
+        listen_sockets_.clear();
+        throw;
+    }
+}
+
+void HttpServer::adopt_listeners() {
+    // 继承的socket已经绑定并处于监听状态，与旧进程共享同一个accept队列
+    listen_sockets_ = std::move(config_.inherited_listeners);
+    config_.inherited_listeners.clear();
+    for (int listen_socket : listen_sockets_) {
+        int listening = 0;
+        socklen_t length = sizeof(listening);
+        if (getsockopt(listen_socket, SOL_SOCKET, SO_ACCEPTCONN, &listening, &length) < 0 || !listening) {
+            for (int fd : listen_sockets_) {
+                close(fd);
+            }
+            listen_sockets_.clear();
+            throw std::runtime_error("继承的文件描述符不是监听socket");
+        }
+        int flags = fcntl(listen_socket, F_GETFL);
+        fcntl(listen_socket, F_SETFL, flags | O_NONBLOCK);
+        fcntl(listen_socket, F_SETFD, FD_CLOEXEC);
+    }
+    
+    // 端口以实际监听的为准
+    sockaddr_in address{};
+    socklen_t address_len = sizeof(address);
+    if (getsockname(listen_sockets_.front(), (struct sockaddr*)&address, &address_len) == 0 &&
+        address.sin_family == AF_INET) {
+        port_ = ntohs(address.sin_port);
+    }
 }
 
-void HttpServer::setup_socket() {
-    server_socket_ = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_socket_ < 0) {
+int HttpServer::create_listener() {
+    int server_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server_socket < 0) {
         throw std::runtime_error("无法创建socket");
     }
     
     // 设置socket选项，允许重用地址
     int opt = 1;
-    if (setsockopt(server_socket_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        close(server_socket_);
+    if (setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+        (config_.reuse_port && setsockopt(server_socket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)) {
+        close(server_socket);
         throw std::runtime_error("无法设置socket选项");
     }
     
@@ -57,32 +446,165 @@ void HttpServer::setup_socket() {
     address.sin_addr.s_addr = INADDR_ANY;
     address.sin_port = htons(port_);
     
-    if (bind(server_socket_, (struct sockaddr*)&address, sizeof(address)) < 0) {
-        close(server_socket_);
+    if (bind(server_socket, (struct sockaddr*)&address, sizeof(address)) < 0) {
+        close(server_socket);
         throw std::runtime_error("无法绑定端口 " + std::to_string(port_));
     }
     
-    if (listen(server_socket_, 10) < 0) {
-        close(server_socket_);
+    if (listen(server_socket, config_.listen_backlog) < 0) {
+        close(server_socket);
         throw std::runtime_error("无法监听端口");
     }
+    return server_socket;
 }
 
 void HttpServer::register_handler(const std::string& method, const std::string& path, RequestHandler handler) {
-    std::string key = create_handler_key(method, path);
-    handlers_[key] = std::move(handler);
+    add_route(method, path).handler = std::move(handler);
+}
+
+void HttpServer::register_static(const std::string& method, const std::string& path, const Response& response) {
+    // 中间件添加的头部在生成报文时写入，用只有方法和路径的请求运行一次链；
+    // 请求时仍会运行链（见screen_request），只为让中间件可以直接给出响应
+    has_static_routes_ = true;
+    if (middleware_) {
+        Request probe(std::pmr::get_default_resource());
+        probe.method = method;
+        probe.path = path;
+        Response headers(std::pmr::get_default_resource());
+        if (run_middleware(probe, headers)) {
+            Response built = response;
+            merge_middleware_headers(built, headers.headers);
+            add_route(method, path).static_response = std::make_shared<const StaticResponse>(built);
+            return;
+        }
+    }
+    add_route(method, path).static_response = std::make_shared<const StaticResponse>(response);
+}
+
+void HttpServer::register_streaming_handler(const std::string& method, const std::string& path, StreamingHandler handler) {
+    add_route(method, path).streaming = std::move(handler);
+}
+
+void HttpServer::register_async_handler(const std::string& method, const std::string& path, AsyncHandler handler) {
+    add_route(method, path).async_handler = std::move(handler);
+}
+
+void HttpServer::register_stream_response(const std::string& method, const std::string& path,
+                                          StreamResponseHandler handler) {
+    add_route(method, path).stream_response = std::move(handler);
+}
+
+void HttpServer::exempt_from_shedding(const std::string& method, const std::string& path) {
+    add_route(method, path).shed_exempt = true;
+}
+
+void HttpServer::cache_responses(const std::string& path, const CachePolicy& policy) {
+    add_route("GET", path).cache = std::make_shared<const CachePolicy>(policy);
+}
+
+void HttpServer::use(Middleware middleware) {
+    if (has_static_routes_) {
+        throw std::logic_error("静态路由的报文已经生成，中间件须在register_static()之前添加");
+    }
+    if (!middleware_) {
+        middleware_ = std::make_unique<MiddlewareStack>();
+    }
+    middleware_->add(std::move(middleware));
+}
+
+Route& HttpServer::add_route(const std::string& method, const std::string& path) {
+    // 同一路径的各类处理方式共用一项路由，也共用一组指标
+    Route& route = router_.add(method, path);
+    if (route.metrics_id == 0) {
+        route.metrics_id = metrics_->add_route(method, path);
+    }
+    return route;
 }
 
 void HttpServer::start() {
     if (running_.load()) {
         return;
     }
+    if (listen_sockets_.empty()) {
+        throw std::runtime_error("监听socket已关闭，服务器不能再次启动");
+    }
+    
+    // sendfile没有MSG_NOSIGNAL，对端已关闭时必须以EPIPE返回而不是终止进程
+    std::signal(SIGPIPE, SIG_IGN);
+    
+    // 处理器在固定大小的线程池中执行，I/O线程只负责收发
+    worker_pool_ = std::make_unique<ThreadPool>(config_.worker_threads, config_.max_queued_requests);
+    
+    // 每个事件循环线程和工作线程各一个指标分片，另留一个给其他线程
+    if (config_.collect_metrics) {
+        metrics_->prepare(config_.io_threads + config_.worker_threads + 1);
+    }
+    
+    draining_.store(false);
+    drained_loops_ = 0;
+    open_connections_.store(0);
+    
+    // 分片模式下每个事件循环只监听自己的socket；
+    // 否则所有事件循环监听同一个socket，EPOLLEXCLUSIVE避免惊群
+    // 继承的监听socket多于事件循环时依次分给各事件循环，少于时由多个事件循环共享
+    // io_uring模式下每个事件循环在监听socket上挂一个multishot accept
+    size_t loop_count = config_.io_threads;
+    size_t socket_count = listen_sockets_.size();
+    bool shared = socket_count < loop_count;
+    bool use_io_uring = config_.io_backend == IoBackend::IoUring;
+    for (size_t i = 0; i < loop_count; ++i) {
+        auto loop = std::make_unique<EventLoop>(use_io_uring);
+        EventLoop* loop_ptr = loop.get();
+        LoopState& state = loop_states_[loop_ptr];
+        for (size_t j = i % socket_count; j < socket_count; j += loop_count) {
+            int listen_socket = listen_sockets_[j];
+            state.listeners.push_back(listen_socket);
+            if (use_io_uring) {
+                start_accept(*loop, listen_socket);
+            } else {
+                loop->add(listen_socket, shared ? EPOLLIN | EPOLLEXCLUSIVE : EPOLLIN, [this, loop_ptr, listen_socket](uint32_t) {
+                    accept_connections(*loop_ptr, listen_socket);
+                });
+            }
+        }
+        loops_.push_back(std::move(loop));
+    }
     
     running_.store(true);
-    std::cout << "HTTP服务器启动在端口 " << port_ << std::endl;
+    std::cout << "HTTP服务器启动在端口 " << port_ << "（" << loops_.size() << " 个事件循环线程，"
+              << listen_sockets_.size() << " 个监听分片，" << io_backend_name(config_.io_backend) << "）" << std::endl;
+    
+    // 可用核心取自进程当前的亲和性掩码，尊重taskset/cgroup的限制
+    std::vector<int> cpus;
+    if (config_.pin_io_threads) {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+    }
     
-    // 启动连接接受线程
-    worker_threads_.emplace_back([this]() { accept_connections(); });
+    for (size_t i = 0; i < loops_.size(); ++i) {
+        EventLoop* loop_ptr = loops_[i].get();
+        ThreadPool* pool = worker_pool_.get();
+        loop_threads_.emplace_back([loop_ptr, pool]() {
+            // 协程处理器通过offload()把阻塞调用交给工作线程池
+            set_offload_pool(pool);
+            loop_ptr->run();
+        });
+        if (!cpus.empty()) {
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(cpus[i % cpus.size()], &cpu_set);
+            if (pthread_setaffinity_np(loop_threads_.back().native_handle(), sizeof(cpu_set), &cpu_set) != 0) {
+                std::cerr << "无法绑定事件循环线程到CPU " << cpus[i % cpus.size()] << std::endl;
+            }
+        }
+    }
 }
 
 void HttpServer::stop() {
@@ -92,133 +614,1663 @@ void HttpServer::stop() {
     
     running_.store(false);
     
-    if (server_socket_ >= 0) {
-        close(server_socket_);
-        server_socket_ = -1;
+    // 先停止线程池，确保不再有处理器向事件循环投递结果
+    worker_pool_->shutdown();
+    
+    for (auto& loop : loops_) {
+        loop->stop();
     }
     
-    // 等待所有工作线程结束
-    for (auto& thread : worker_threads_) {
+    // 等待所有事件循环线程结束
+    for (auto& thread : loop_threads_) {
         if (thread.joinable()) {
             thread.join();
         }
     }
-    worker_threads_.clear();
+    loop_threads_.clear();
+    
+    // 被丢弃的填充任务不会再结束，连同其等待者一起丢掉整个缓存
+    if (response_cache_) {
+        response_cache_ = std::make_unique<ResponseCache>(config_.response_cache_size, config_.response_cache_shards);
+    }
+    
+    // 销毁事件循环，同时关闭其上的所有连接
+    loops_.clear();
+    loop_states_.clear();
+    worker_pool_.reset();
     
     std::cout << "HTTP服务器已停止" << std::endl;
 }
 
-void HttpServer::accept_connections() {
-    while (running_.load()) {
+bool HttpServer::drain(std::chrono::milliseconds timeout) {
+    if (!running_.load()) {
+        return true;
+    }
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    draining_.store(true);
+    
+    // 监听socket和连接只能在所属事件循环线程上操作
+    for (auto& loop : loops_) {
+        EventLoop* loop_ptr = loop.get();
+        loop_ptr->post([this, loop_ptr]() {
+            drain_loop(*loop_ptr);
+            std::lock_guard<std::mutex> lock(drain_mutex_);
+            ++drained_loops_;
+            drain_cv_.notify_all();
+        });
+    }
+    
+    std::unique_lock<std::mutex> lock(drain_mutex_);
+    drain_cv_.wait(lock, [this]() { return drained_loops_ == loops_.size(); });
+    // 监听socket已不在任何事件循环上，关闭后新连接被拒绝；
+    // 热升级时新进程持有同一个socket，新连接由它接受
+    for (int listen_socket : listen_sockets_) {
+        close(listen_socket);
+    }
+    listen_sockets_.clear();
+    
+    bool drained = drain_cv_.wait_until(lock, deadline, [this]() { return open_connections_.load() == 0; });
+    lock.unlock();
+    if (!drained) {
+        std::cerr << "排空超时，强制关闭剩余的 " << open_connections_.load() << " 个连接" << std::endl;
+    }
+    stop();
+    return drained;
+}
+
+void HttpServer::drain_loop(EventLoop& loop) {
+    LoopState& state = loop_states_.at(&loop);
+    for (int listen_socket : state.listeners) {
+        if (loop.uses_io_uring()) {
+            loop.cancel(state.accepts[listen_socket]);
+        } else {
+            loop.remove(listen_socket);
+        }
+    }
+    state.listeners.clear();
+    
+    // 空闲的保持连接立即关闭；其余连接发送完当前响应后关闭（见process_client和finish_write）。
+    // 刚接受、第一个请求还没到达的连接不算空闲，客户端不会重试发往它的请求。
+    // HTTP/2连接发送GOAWAY，已有的流完成后关闭（见flush_http2）
+    std::vector<Connection*> idle;
+    std::vector<std::shared_ptr<Connection>> http2;
+    for (Connection* conn : state.clients) {
+        if (conn->http2) {
+            http2.push_back(conn->shared_from_this());
+        } else if (conn->requests_served > 0 && timeout_phase(*conn) == TimeoutPhase::Idle) {
+            idle.push_back(conn);
+        }
+    }
+    for (Connection* conn : idle) {
+        close_client(*conn);
+    }
+    for (const auto& conn : http2) {
+        conn->http2->shutdown();
+        flush_http2(conn);
+    }
+}
+
+void HttpServer::accept_connections(EventLoop& loop, int listen_socket) {
+    while (running_.load(std::memory_order_relaxed)) {
         sockaddr_in client_address{};
         socklen_t client_len = sizeof(client_address);
         
-        int client_socket = accept(server_socket_, (struct sockaddr*)&client_address, &client_len);
+        int client_socket = accept4(listen_socket, (struct sockaddr*)&client_address, &client_len,
+                                    SOCK_NONBLOCK | SOCK_CLOEXEC);
         
         if (client_socket < 0) {
-            if (running_.load()) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
                 std::cerr << "接受连接时出错" << std::endl;
             }
-            continue;
+            return;
         }
         
-        // 为每个客户端创建一个处理线程
-        worker_threads_.emplace_back([this, client_socket]() {
-            handle_client(client_socket);
-        });
+        open_client(loop, client_socket);
     }
 }
 
-void HttpServer::handle_client(int client_socket) {
-    char buffer[4096];
-    ssize_t bytes_received = recv(client_socket, buffer, sizeof(buffer) - 1, 0);
+void HttpServer::start_accept(EventLoop& loop, int listen_socket) {
+    loop_states_.at(&loop).accepts[listen_socket] = loop.accept_multishot(listen_socket, [this, &loop, listen_socket](int client_socket, bool more) {
+        if (client_socket >= 0) {
+            open_client(loop, client_socket);
+        } else if (client_socket != -ECANCELED && client_socket != -EBADF) {
+            std::cerr << "接受连接时出错: " << std::strerror(-client_socket) << std::endl;
+        }
+        // multishot请求在出错或资源不足时终止，需要重新发起
+        if (!more && running_.load(std::memory_order_relaxed) && !draining_.load(std::memory_order_relaxed) &&
+            client_socket != -ECANCELED) {
+            start_accept(loop, listen_socket);
+        }
+    });
+}
+
+void HttpServer::open_client(EventLoop& loop, int client_socket) {
+    int nodelay = 1;
+    setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
     
-    if (bytes_received > 0) {
-        buffer[bytes_received] = '\0';
-        std::string raw_request(buffer);
+    // 连接由事件循环驱动，不再为每个客户端创建线程
+    auto conn = std::make_shared<Connection>(client_socket, &loop);
+    metrics_->increment(Metrics::Counter::ConnectionsAccepted);
+    if (access_log_) {
+        sockaddr_in peer{};
+        socklen_t peer_length = sizeof(peer);
+        if (getpeername(client_socket, reinterpret_cast<sockaddr*>(&peer), &peer_length) == 0) {
+            conn->peer_address = peer.sin_addr.s_addr;
+        }
+    }
+    loop_states_.at(&loop).clients.insert(conn.get());
+    open_connections_.fetch_add(1, std::memory_order_relaxed);
+    if (loop.uses_io_uring()) {
+        start_receive(conn);
+    } else {
+        loop.add(client_socket, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, [this, conn](uint32_t events) {
+            handle_client(conn, events);
+        });
+    }
+    // 定时器节点在连接内部，回调触发时连接必然存活
+    conn->timer.set_callback([this, raw = conn.get()]() { expire_client(*raw); });
+    arm_timeout(*conn);
+}
+
+void HttpServer::start_receive(const std::shared_ptr<Connection>& conn) {
+    // 进行中的recv持有连接，直到最后一个完成事件到达
+    conn->receiving = true;
+    conn->receive_operation = conn->loop->receive_multishot(conn->fd, [this, conn](int result, std::string_view data, bool more) {
+        if (!more) {
+            conn->receiving = false;
+        }
+        if (conn->state == Connection::State::Closed) {
+            return;
+        }
         
-        try {
-            Request request = parse_request(raw_request);
-            Response response = handle_request(request);
-            
-            std::string response_str = response.to_string();
-            send(client_socket, response_str.c_str(), response_str.length(), 0);
-        } catch (const std::exception& e) {
-            Response error_response;
-            error_response.status_code = 500;
-            error_response.status_text = "Internal Server Error";
-            error_response.body = "<h1>500 Internal Server Error</h1><p>" + std::string(e.what()) + "</p>";
-            
-            std::string response_str = error_response.to_string();
-            send(client_socket, response_str.c_str(), response_str.length(), 0);
+        if (result > 0) {
+            std::memcpy(conn->input.prepare(data.size()), data.data(), data.size());
+            conn->input.commit(data.size());
+            conn->last_active = std::chrono::steady_clock::now();
+        } else if (result == 0) {
+            conn->peer_closed = true;
+        } else if (result != -ENOBUFS && result != -ECANCELED) {
+            close_client(*conn);
+            return;
+        }
+        
+        // 处理期间积压过多时暂停接收，回到Reading后再恢复，相当于epoll模式下的内核背压
+        bool backlog = (conn->state != Connection::State::Reading || http2_blocked(*conn)) &&
+                       conn->input.size() >= kMaxPendingInput;
+        if (conn->receiving && backlog) {
+            conn->loop->cancel(conn->receive_operation);
+        } else if (!conn->receiving && !conn->peer_closed && !backlog) {
+            start_receive(conn);
+        }
+        
+        if (conn->state == Connection::State::Reading && !conn->driving) {
+            drive_client(conn);
         }
+    });
+}
+
+void HttpServer::handle_client(const std::shared_ptr<Connection>& conn, uint32_t events) {
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        close_client(*conn);
+        return;
+    }
+    
+    // 处理请求期间不读取新数据，由内核缓冲区形成背压；状态回到Reading后再继续读
+    if (events & (EPOLLIN | EPOLLRDHUP)) {
+        conn->readable = true;
+    }
+    
+    if (conn->http2 && (events & EPOLLOUT)) {
+        flush_http2(conn);
+    } else if (conn->state == Connection::State::Writing && (events & EPOLLOUT)) {
+        write_client(conn);
     }
     
-    close(client_socket);
+    if (conn->state == Connection::State::Reading) {
+        drive_client(conn);
+    }
 }
 
-Request HttpServer::parse_request(const std::string& raw_request) {
-    Request request;
-    std::istringstream iss(raw_request);
-    std::string line;
-    
-    // 解析请求行
-    if (std::getline(iss, line)) {
-        std::istringstream request_line(line);
-        request_line >> request.method >> request.path >> request.version;
+void HttpServer::drive_client(const std::shared_ptr<Connection>& conn) {
+    conn->driving = true;
+    while (conn->state == Connection::State::Reading) {
+        // 请求在I/O线程同步完成（如静态路由）时，继续处理缓冲区中的下一个流水线请求
+        if (dispatch_client(conn)) {
+            continue;
+        }
+        if (conn->state != Connection::State::Reading || !conn->readable || http2_blocked(*conn)) {
+            break;
+        }
+        if (!read_client(*conn)) {
+            break;
+        }
     }
+    conn->driving = false;
+}
+
+bool HttpServer::read_client(Connection& conn) {
+    // 每次最多读取kMaxReadPerCall字节，让请求体可以边读边消费，缓冲区不会无限增长
+    constexpr size_t kReadChunk = 4096;
+    constexpr size_t kMaxReadPerCall = 64 * 1024;
+    size_t total = 0;
     
-    // 解析头部
-    while (std::getline(iss, line) && line != "\r") {
-        if (line.back() == '\r') {
-            line.pop_back();
+    while (total < kMaxReadPerCall) {
+        char* target = conn.input.prepare(kReadChunk);
+        ssize_t bytes_received = recv(conn.fd, target, conn.input.writable(), 0);
+        if (bytes_received > 0) {
+            conn.input.commit(bytes_received);
+            total += bytes_received;
+            conn.last_active = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (bytes_received == 0) {
+            conn.peer_closed = true;
+            conn.readable = false;
+            return true;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // 边沿触发：读到EAGAIN后才会有下一次通知
+            conn.readable = false;
+            return true;
+        }
+        close_client(conn);
+        return false;
+    }
+    return true;
+}
+
+bool HttpServer::dispatch_client(const std::shared_ptr<Connection>& conn) {
+    if (conn->http2) {
+        return dispatch_http2(conn);
+    }
+    if (!conn->reading_body) {
+        // 新请求的第一个字节到达，从空闲切换到请求头超时
+        if (conn->request_started == std::chrono::steady_clock::time_point() && !conn->input.empty()) {
+            conn->request_started = std::chrono::steady_clock::now();
+            arm_timeout(*conn);
+        }
+        // 以先验知识使用h2c的客户端直接发送连接序言；只收到一部分时等待其余字节再判断
+        if (config_.http2 && conn->requests_served == 0 && !conn->input.empty()) {
+            std::string_view input = conn->input.readable();
+            size_t length = std::min(input.size(), kHttp2Preface.size());
+            if (input.substr(0, length) == kHttp2Preface.substr(0, length)) {
+                if (length == kHttp2Preface.size()) {
+                    start_http2(conn);
+                    return dispatch_http2(conn);
+                }
+                if (conn->peer_closed) {
+                    close_client(*conn);
+                }
+                return false;
+            }
         }
+        // 解析器从上次停下的位置继续，只扫描新到达的数据
+        auto parse_start = config_.collect_metrics ? std::chrono::steady_clock::now()
+                                                   : std::chrono::steady_clock::time_point();
+        RequestParser::Status status = conn->parser.parse(conn->input.readable());
         
-        auto colon_pos = line.find(':');
-        if (colon_pos != std::string::npos) {
-            std::string key = line.substr(0, colon_pos);
-            std::string value = line.substr(colon_pos + 1);
-            
-            // 去除前后空格
-            key.erase(0, key.find_first_not_of(' '));
-            key.erase(key.find_last_not_of(' ') + 1);
-            value.erase(0, value.find_first_not_of(' '));
-            value.erase(value.find_last_not_of(' ') + 1);
-            
-            request.headers[key] = value;
+        if (status == RequestParser::Status::Error) {
+            reject_client(conn, conn->parser.error_status());
+            return false;
+        }
+        if (status == RequestParser::Status::Incomplete) {
+            // 请求尚不完整；若对端已关闭则不会再有数据
+            if (conn->peer_closed) {
+                close_client(*conn);
+            }
+            return false;
+        }
+        if (!begin_body(conn)) {
+            return false;
+        }
+        if (config_.collect_metrics) {
+            metrics_->record(conn->metrics_route, Metrics::Stage::Parse, elapsed_ns(parse_start));
+        }
+        if (conn->state != Connection::State::Reading) {
+            // 100 Continue尚未发完，发完后在finish_write中回到读取状态继续读请求体
+            return false;
         }
     }
     
-    // 解析请求体
-    std::string remaining_content;
-    std::string body_line;
-    while (std::getline(iss, body_line)) {
-        remaining_content += body_line + "\n";
+    if (!read_body(conn)) {
+        return false;
     }
-    request.body = remaining_content;
     
-    return request;
+    conn->reading_body = false;
+    process_client(conn);
+    return true;
 }
 
-Response HttpServer::handle_request(const Request& request) {
-    std::string handler_key = create_handler_key(request.method, request.path);
+bool HttpServer::begin_body(const std::shared_ptr<Connection>& conn) {
+    RequestParser& parser = conn->parser;
+    // 上一个请求的对象已在finish_write中随arena一起回收，新请求从空arena开始分配
+    conn->request = make_request(parser, std::string_view(), &conn->arena);
+    conn->chunked_body = parser.chunked();
+    conn->body_remaining = parser.content_length();
+    conn->chunked_decoder.reset();
+    conn->input.consume(parser.header_length());
+    parser.reset();
+    conn->reading_body = true;
+    conn->request_begin = conn->request_started;
+    conn->request_started = std::chrono::steady_clock::time_point();
+    arm_timeout(*conn);
     
-    auto it = handlers_.find(handler_key);
-    if (it != handlers_.end()) {
-        return it->second(request);
+    // 路由在请求头到达时查找一次，结果保存在连接上供后续阶段使用
+    conn->body_sink = nullptr;
+    conn->body_complete = nullptr;
+    conn->route = find_route(conn->request.method, conn->request.path, conn->request.params);
+    conn->metrics_route = conn->route ? conn->route->metrics_id : 0;
+    if (conn->route && conn->route->streaming) {
+        try {
+            BodyStream stream = conn->route->streaming(conn->request);
+            conn->body_sink = std::move(stream.on_data);
+            conn->body_complete = std::move(stream.on_complete);
+        } catch (const std::exception&) {
+            reject_client(conn, 500);
+            return false;
+        }
+    } else if (conn->body_remaining > config_.max_body_size) {
+        reject_client(conn, 413);
+        return false;
+    } else {
+        conn->request.body.reserve(conn->body_remaining);
     }
     
-    // 默认404响应
-    Response response;
-    response.status_code = 404;
-    response.status_text = "Not Found";
-    response.body = "<h1>404 Not Found</h1><p>请求的资源未找到: " + request.path + "</p>";
+    // 客户端等待100 Continue后才发送请求体
+    bool has_body = conn->chunked_body || conn->body_remaining > 0;
+    const std::pmr::string* expect = conn->request.find_header(HeaderId::Expect);
+    if (has_body && expect && iequals(*expect, "100-continue")) {
+        // 与响应走同一条发送路径，部分写和发送缓冲区满时等待可写后继续
+        static constexpr std::string_view kContinue = "HTTP/1.1 100 Continue\r\n\r\n";
+        conn->output_head.assign(kContinue);
+        conn->output_offset = 0;
+        conn->interim = true;
+        conn->state = Connection::State::Writing;
+        conn->last_active = std::chrono::steady_clock::now();
+        arm_timeout(*conn);
+        write_client(conn);
+    }
+    return true;
+}
+
+bool HttpServer::read_body(const std::shared_ptr<Connection>& conn) {
+    bool too_large = false;
+    auto deliver = [&](std::string_view data) {
+        if (conn->body_sink) {
+            conn->body_sink(data);
+        } else if (conn->request.body.size() + data.size() > config_.max_body_size) {
+            too_large = true;
+        } else {
+            conn->request.body.append(data);
+        }
+    };
     
-    return response;
+    bool complete = false;
+    try {
+        if (conn->chunked_body) {
+            size_t consumed = 0;
+            ChunkedDecoder::Status status = conn->chunked_decoder.decode(conn->input.readable(), consumed, deliver);
+            conn->input.consume(consumed);
+            if (status == ChunkedDecoder::Status::Error) {
+                reject_client(conn, 400);
+                return false;
+            }
+            complete = status == ChunkedDecoder::Status::Complete;
+        } else {
+            size_t available = std::min(conn->body_remaining, conn->input.size());
+            if (available > 0) {
+                deliver(conn->input.readable().substr(0, available));
+                conn->input.consume(available);
+                conn->body_remaining -= available;
+            }
+            complete = conn->body_remaining == 0;
+        }
+    } catch (const std::exception&) {
+        reject_client(conn, 500);
+        return false;
+    }
+    
+    if (too_large) {
+        reject_client(conn, 413);
+        return false;
+    }
+    if (!complete && conn->peer_closed) {
+        close_client(*conn);
+    }
+    return complete;
 }
 
-std::string HttpServer::create_handler_key(const std::string& method, const std::string& path) {
-    return method + " " + path;
+void HttpServer::process_client(const std::shared_ptr<Connection>& conn) {
+    conn->state = Connection::State::Processing;
+    conn->loop->timing_wheel().cancel(conn->timer);
+    
+    // 请求留在连接上（其内存属于连接的arena），处理器以引用方式读取，直到响应发送完毕
+    const Request& request = conn->request;
+    RequestHandler handler = std::move(conn->body_complete);
+    const Route* route = conn->route;
+    conn->route = nullptr;
+    conn->body_sink = nullptr;
+    
+    // 决定本次响应后是否保持连接
+    ++conn->requests_served;
+    bool keep_alive = wants_keep_alive(request) && !conn->peer_closed &&
+                      conn->requests_served < config_.max_keep_alive_requests &&
+                      !draining_.load(std::memory_order_relaxed);
+    
+    // Upgrade: h2c，请求本身成为HTTP/2的流1，在新协议上响应
+    if (!handler && keep_alive && config_.http2 && upgrade_client(conn, route)) {
+        return;
+    }
+    
+    // 不在线程池中执行的路由先在这里运行全局中间件，中间件直接给出响应时已经发送
+    bool cacheable = !handler && route && route->cache && route->handler && response_cache_ && request.method == "GET";
+    if (!screen_request(conn, nullptr, handler ? nullptr : route, cacheable, keep_alive)) {
+        return;
+    }
+    
+    // 静态路由在I/O线程直接发送预先生成的报文
+    if (!handler && route && route->static_response) {
+        auto handle_start = config_.collect_metrics ? std::chrono::steady_clock::now()
+                                                    : std::chrono::steady_clock::time_point();
+        auto message = route->static_response->select(request, keep_alive);
+        if (config_.collect_metrics) {
+            metrics_->record(conn->metrics_route, Metrics::Stage::Handle, elapsed_ns(handle_start));
+        }
+        complete_client(conn, std::move(message), keep_alive);
+        return;
+    }
+    
+    // 流式响应处理器同样在本事件循环上启动，边生成边发送
+    if (!handler && route && route->stream_response) {
+        detach(execute_stream(conn, nullptr, &route->stream_response, keep_alive));
+        return;
+    }
+    
+    // 协程处理器直接在本事件循环上启动，运行到第一个挂起点后返回
+    if (!handler && route && route->async_handler) {
+        detach(execute_async(conn, nullptr, &route->async_handler, keep_alive));
+        return;
+    }
+    
+    // 可缓存的路由在中间件之后查响应缓存，命中时与静态路由一样在I/O线程直接发送
+    std::string cache_key;
+    if (cacheable && serve_cached(conn, nullptr, *route, keep_alive, cache_key)) {
+        return;
+    }
+    submit_request(conn, nullptr, route, std::move(handler), keep_alive, std::move(cache_key));
+}
+
+bool HttpServer::serve_cached(const std::shared_ptr<Connection>& conn, const std::shared_ptr<Http2Stream>& stream,
+                              const Route& route, bool keep_alive, std::string& cache_key) {
+    auto now = std::chrono::steady_clock::now();
+    uint32_t metrics_route = stream ? stream->metrics_route : conn->metrics_route;
+    auto serve = [&](const ResponseCache::Entry& entry) {
+        metrics_->increment(Metrics::Counter::CacheHits);
+        if (config_.collect_metrics) {
+            metrics_->record(metrics_route, Metrics::Stage::Handle, elapsed_ns(now));
+        }
+        if (stream) {
+            complete_stream(conn, stream, entry.message[true]);
+        } else {
+            complete_client(conn, entry.message[keep_alive], keep_alive);
+        }
+    };
+    
+    // 键在线程本地缓冲区中构造，命中路径不分配内存
+    thread_local std::string key;
+    make_cache_key(stream ? stream->request : conn->request, *route.cache, config_.compress_dynamic, key);
+    if (auto entry = response_cache_->find(key, now)) {
+        serve(*entry);
+        return true;
+    }
+    
+    // 已有请求在填充时等待其结果；填充的响应不可缓存时各自执行处理器
+    std::shared_ptr<const ResponseCache::Entry> entry;
+    auto waiter = [this, conn, stream, keep_alive, route = &route](const std::shared_ptr<const ResponseCache::Entry>& filled) {
+        conn->loop->post([this, conn, stream, keep_alive, route, filled]() {
+            if (filled && stream) {
+                complete_stream(conn, stream, filled->message[true]);
+            } else if (filled) {
+                complete_client(conn, filled->message[keep_alive], keep_alive);
+            } else {
+                submit_request(conn, stream, route, nullptr, keep_alive, std::string());
+            }
+        });
+    };
+    switch (response_cache_->join(key, now, entry, std::move(waiter))) {
+        case ResponseCache::Result::Hit:
+            serve(*entry);
+            return true;
+        case ResponseCache::Result::Wait:
+            metrics_->increment(Metrics::Counter::CacheCollapsed);
+            return true;
+        case ResponseCache::Result::Fill:
+            metrics_->increment(Metrics::Counter::CacheMisses);
+            cache_key = key;
+            return false;
+    }
+    return false;
+}
+
+void HttpServer::submit_request(const std::shared_ptr<Connection>& conn, std::shared_ptr<Http2Stream> stream,
+                                const Route* route, RequestHandler handler, bool keep_alive, std::string cache_key) {
+    // 路由表在启动后不再修改，可以直接引用其中的处理器；未命中时返回404
+    const RequestHandler* route_handler = route && route->handler ? &route->handler : nullptr;
+    
+    // 过载时在入队前拒绝。流式请求体已经接收完毕，处理它比让客户端重新上传更划算，不参与拒绝
+    bool sheddable = shedder_ && !handler && !(route && route->shed_exempt);
+    auto queued_at = shedder_ ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    if (sheddable && shedder_->should_reject(worker_pool_->queued(), queued_at)) {
+        metrics_->increment(Metrics::Counter::RequestsShed);
+        abandon_fill(cache_key);
+        shed_client(conn, stream, keep_alive);
+        return;
+    }
+    
+    // 处理器在线程池中执行，完成后将响应投递回连接所属的事件循环
+    uint32_t metrics_route = stream ? stream->metrics_route : conn->metrics_route;
+    auto ttl = route && route->cache ? route->cache->ttl : std::chrono::milliseconds(0);
+    bool accepted = worker_pool_->submit([this, conn, stream, keep_alive, route_handler, metrics_route, sheddable,
+                                          queued_at, handler = std::move(handler), cache_key, ttl]() {
+        bool keep = keep_alive;
+        auto handle_start = config_.collect_metrics || shedder_ ? std::chrono::steady_clock::now()
+                                                                : std::chrono::steady_clock::time_point();
+        // 所有请求的排队时间都作为过载信号，但只丢弃未豁免的请求；丢弃时不执行处理器
+        if (shedder_ && shedder_->should_drop(handle_start - queued_at, handle_start) && sheddable) {
+            metrics_->increment(Metrics::Counter::RequestsDropped);
+            abandon_fill(cache_key);
+            conn->loop->post([this, conn, stream, keep]() { shed_client(conn, stream, keep); });
+            return;
+        }
+        // 处理器中默认构造的Response分配在连接的arena中；HTTP/2的流并发处理，不共用arena，留在堆上
+        MemoryResourceScope arena(stream ? std::pmr::get_default_resource() : &conn->arena);
+        bool screened = stream ? stream->screened : conn->screened;
+        const HeaderMap& middleware_headers = stream ? stream->middleware_headers : conn->middleware_headers;
+        Response response = execute_request(stream ? stream->request : conn->request,
+                                            handler ? &handler : route_handler,
+                                            screened ? &middleware_headers : nullptr, keep);
+        if (config_.collect_metrics) {
+            metrics_->record(metrics_route, Metrics::Stage::Handle, elapsed_ns(handle_start));
+        }
+        if (!cache_key.empty()) {
+            // 缓存项要比连接的arena活得久，报文复制到堆上，之后本请求也发送这份共享报文
+            std::shared_ptr<ResponseCache::Entry> entry;
+            if (cacheable_response(response)) {
+                entry = std::make_shared<ResponseCache::Entry>();
+                entry->message[false] = serialize_message(response, false);
+                entry->message[true] = serialize_message(response, true);
+                entry->expires = std::chrono::steady_clock::now() + ttl;
+            }
+            size_t evicted = response_cache_->fill(cache_key, entry);
+            if (evicted > 0) {
+                metrics_->increment(Metrics::Counter::CacheEvictions, evicted);
+            }
+            if (entry) {
+                conn->loop->post([this, conn, stream, keep, message = entry->message[stream ? true : keep]]() {
+                    if (stream) {
+                        complete_stream(conn, stream, message);
+                    } else {
+                        complete_client(conn, message, keep);
+                    }
+                });
+                return;
+            }
+        }
+        conn->loop->post([this, conn, stream, keep, response = std::move(response)]() mutable {
+            if (stream) {
+                complete_stream(conn, stream, std::move(response));
+            } else {
+                complete_client(conn, std::move(response), keep);
+            }
+        });
+    });
+    
+    if (!accepted) {
+        metrics_->increment(Metrics::Counter::RequestsRejected);
+        abandon_fill(cache_key);
+        shed_client(conn, stream, keep_alive);
+    }
+}
+
+void HttpServer::abandon_fill(const std::string& cache_key) {
+    // 负责填充的请求没有执行处理器，等待者各自重新提交
+    if (!cache_key.empty()) {
+        response_cache_->fill(cache_key, nullptr);
+    }
+}
+
+void HttpServer::reject_client(const std::shared_ptr<Connection>& conn, int status_code) {
+    // 请求无法继续解析，响应后关闭连接
+    conn->state = Connection::State::Processing;
+    conn->reading_body = false;
+    conn->body_sink = nullptr;
+    conn->body_complete = nullptr;
+    complete_client(conn, make_error_response(status_code, "无法处理的请求", false), false);
+}
+
+void HttpServer::shed_client(const std::shared_ptr<Connection>& conn, const std::shared_ptr<Http2Stream>& stream,
+                             bool keep_alive) {
+    // HTTP/2按帧划分响应，HEAD请求的响应体由会话丢弃
+    if (stream) {
+        complete_stream(conn, stream, overload_response_[true]);
+        return;
+    }
+    complete_client(conn, overload_response_[keep_alive], keep_alive);
+}
+
+void HttpServer::complete_client(const std::shared_ptr<Connection>& conn, Response response, bool keep_alive) {
+    // 处理期间连接可能已被关闭
+    if (conn->state != Connection::State::Processing) {
+        return;
+    }
+    
+    // 头部写入连接复用的缓冲区，响应体直接移交，发送时用sendmsg一次提交两段。
+    // 响应在此作用域内销毁：同步写完时finish_write会回收arena，此后不能再有对象引用其中的内存
+    {
+        Response done = std::move(response);
+        conn->output_head.clear();
+        done.write_head(conn->output_head, keep_alive ? "keep-alive" : "close");
+        metrics_->count_response(conn->metrics_route, done.status_code);
+        conn->response_status = done.status_code;
+        conn->response_bytes = conn->output_head.size() + done.body.size() + (done.file.file ? done.file.length : 0);
+        conn->output_body = std::move(done.body);
+        conn->output_shared.reset();
+        conn->output_offset = 0;
+        if (done.file.file) {
+            conn->output_body.clear();
+            conn->output_file = std::move(done.file.file);
+            conn->file_offset = done.file.offset;
+            conn->file_remaining = done.file.length;
+        }
+    }
+    start_write(conn, keep_alive);
+}
+
+void HttpServer::complete_client(const std::shared_ptr<Connection>& conn, std::shared_ptr<const std::string> message,
+                                 bool keep_alive) {
+    if (conn->state != Connection::State::Processing) {
+        return;
+    }
+    
+    conn->output_head.clear();
+    conn->output_body.clear();
+    conn->response_status = message_status(*message);
+    conn->response_bytes = message->size();
+    metrics_->count_response(conn->metrics_route, conn->response_status);
+    conn->output_shared = std::move(message);
+    conn->output_offset = 0;
+    start_write(conn, keep_alive);
+}
+
+void HttpServer::start_write(const std::shared_ptr<Connection>& conn, bool keep_alive) {
+    // HEAD请求：保留头部（包括按完整响应体计算的Content-Length），丢弃响应体，
+    // 否则保持连接上的客户端会把多出的字节当作下一个响应的开头。
+    // 预生成的共享报文只把头部复制到连接自己的缓冲区
+    if (conn->request.method == "HEAD") {
+        if (conn->output_shared) {
+            std::string_view message = *conn->output_shared;
+            size_t head_end = message.find("\r\n\r\n");
+            conn->output_head.assign(message.substr(0, head_end == std::string_view::npos ? message.size() : head_end + 4));
+            conn->output_shared.reset();
+        }
+        conn->output_body.clear();
+        conn->output_file.reset();
+        conn->file_remaining = 0;
+        conn->response_bytes = conn->output_head.size();
+    }
+    conn->keep_alive = keep_alive;
+    conn->state = Connection::State::Writing;
+    conn->last_active = std::chrono::steady_clock::now();
+    if (config_.collect_metrics) {
+        conn->send_started = conn->last_active;
+    }
+    arm_timeout(*conn);
+    write_client(conn);
+}
+
+bool HttpServer::run_middleware(const Request& request, Response& response) const {
+    // 最后一环返回占位响应，稍后（或预先）生成的实际响应在此不可用
+    bool reached = false;
+    response = middleware_->run(request, [&reached](const Request&) {
+        reached = true;
+        return Response(std::pmr::get_default_resource());
+    });
+    return reached;
+}
+
+bool HttpServer::screen_request(const std::shared_ptr<Connection>& conn, const std::shared_ptr<Http2Stream>& stream,
+                                const Route* route, bool cacheable, bool keep_alive) {
+    bool& screened = stream ? stream->screened : conn->screened;
+    HeaderMap& middleware_headers = stream ? stream->middleware_headers : conn->middleware_headers;
+    screened = false;
+    middleware_headers.clear();
+    // 普通处理器和404在线程池中由execute_request用链包裹，这里只处理其余的路由
+    if (!middleware_ || !route ||
+        !(route->static_response || route->stream_response || route->async_handler || cacheable)) {
+        return true;
+    }
+    
+    const Request& request = stream ? stream->request : conn->request;
+    Response response(std::pmr::get_default_resource());
+    try {
+        if (run_middleware(request, response)) {
+            screened = true;
+            middleware_headers = std::move(response.headers);
+            return true;
+        }
+        finalize_response(request, response, keep_alive);
+    } catch (const std::exception& e) {
+        response = make_error_response(500, e.what(), keep_alive);
+    }
+    if (stream) {
+        complete_stream(conn, stream, std::move(response));
+    } else {
+        complete_client(conn, std::move(response), keep_alive);
+    }
+    return false;
+}
+
+Response HttpServer::execute_request(const Request& request, const RequestHandler* handler, const HeaderMap* screened,
+                                     bool& keep_alive) {
+    try {
+        auto target = [this, handler](const Request& routed) {
+            return handler ? (*handler)(routed) : handle_request(routed);
+        };
+        // 中间件已在I/O线程上运行（可缓存的路由）时只补上它添加的头部
+        Response response = middleware_ && !screened ? middleware_->run(request, target) : target(request);
+        if (screened) {
+            merge_middleware_headers(response, *screened);
+        }
+        finalize_response(request, response, keep_alive);
+        return response;
+    } catch (const std::exception& e) {
+        return make_error_response(500, e.what(), keep_alive);
+    }
+}
+
+Task<void> HttpServer::execute_async(std::shared_ptr<Connection> conn, std::shared_ptr<Http2Stream> stream,
+                                     const AsyncHandler* handler, bool keep_alive) {
+    // 协程帧持有连接（和流），挂起期间连接即使被关闭也不会释放；请求留在连接上直到响应发送完毕
+    auto handle_start = config_.collect_metrics ? std::chrono::steady_clock::now()
+                                                : std::chrono::steady_clock::time_point();
+    const Request& request = stream ? stream->request : conn->request;
+    Response response;
+    try {
+        response = co_await (*handler)(request);
+        if (stream ? stream->screened : conn->screened) {
+            merge_middleware_headers(response, stream ? stream->middleware_headers : conn->middleware_headers);
+        }
+        finalize_response(request, response, keep_alive);
+    } catch (const std::exception& e) {
+        response = make_error_response(500, e.what(), keep_alive);
+    }
+    if (config_.collect_metrics) {
+        metrics_->record(stream ? stream->metrics_route : conn->metrics_route, Metrics::Stage::Handle,
+                         elapsed_ns(handle_start));
+    }
+    if (stream) {
+        complete_stream(conn, stream, std::move(response));
+    } else {
+        complete_client(conn, std::move(response), keep_alive);
+    }
+}
+
+ResponseWriter::ResponseWriter(HttpServer* server, std::shared_ptr<Connection> conn,
+                               std::shared_ptr<Http2Stream> stream, bool keep_alive,
+                               std::chrono::steady_clock::time_point handle_start)
+    // 响应可能在写入器析构前就已发送完毕并回收arena，头部因此放在堆上
+    : server_(server), conn_(std::move(conn)), stream_(std::move(stream)), head_(std::pmr::new_delete_resource()),
+      keep_alive_(keep_alive), handle_start_(handle_start) {
+}
+
+bool ResponseWriter::writable() const {
+    if (stream_) {
+        return !stream_->closed && (!started_ || (!stream_->discard && !stream_->end_queued));
+    }
+    if (!started_) {
+        return conn_->state == Connection::State::Processing;
+    }
+    return conn_->state == Connection::State::Writing && conn_->stream.active && !conn_->stream.discard;
+}
+
+ResponseWriter::WriteAwaiter ResponseWriter::write(std::string_view data) {
+    if (!started_) {
+        server_->begin_stream(*this);
+    }
+    if (!writable() || data.empty()) {
+        return WriteAwaiter(this, false);
+    }
+    if (stream_) {
+        // 交给会话按流量控制窗口分帧，积压超过上限时挂起，直到全部移入输出缓冲
+        conn_->http2->submit_data(stream_, data);
+        if (!conn_->driving) {
+            server_->flush_http2(conn_);
+        }
+        return WriteAwaiter(this, writable() && stream_->pending() >= server_->config_.stream_buffer_size);
+    }
+    
+    ResponseStream& stream = conn_->stream;
+    if (stream.has_length && data.size() > stream.remaining) {
+        // 超出声明长度的部分丢弃，结束后关闭连接
+        data = data.substr(0, stream.remaining);
+        conn_->keep_alive = false;
+    }
+    if (stream.has_length) {
+        stream.remaining -= data.size();
+    }
+    if (stream.chunked) {
+        char size[16];
+        auto result = std::to_chars(size, size + sizeof(size), data.size(), 16);
+        stream.pending.append(size, result.ptr - size).append("\r\n").append(data).append("\r\n");
+    } else {
+        stream.pending.append(data);
+    }
+    
+    // 之前的数据已全部发出时由这里重新开始发送，否则由发送路径在当前一批完成后取走；
+    // 等待处理器期间不计发送超时，从这里重新开始计算
+    if (stream.idle) {
+        stream.idle = false;
+        conn_->last_active = std::chrono::steady_clock::now();
+        server_->arm_timeout(*conn_);
+        server_->write_client(conn_);
+    }
+    return WriteAwaiter(this, writable() && stream.pending.size() >= server_->config_.stream_buffer_size);
+}
+
+void ResponseWriter::WriteAwaiter::await_suspend(std::coroutine_handle<> handle) {
+    if (writer_->stream_) {
+        writer_->stream_->waiting = handle;
+        return;
+    }
+    writer_->conn_->stream.waiting = handle;
+}
+
+Task<void> HttpServer::execute_stream(std::shared_ptr<Connection> conn, std::shared_ptr<Http2Stream> stream,
+                                      const StreamResponseHandler* handler, bool keep_alive) {
+    auto handle_start = config_.collect_metrics ? std::chrono::steady_clock::now()
+                                                : std::chrono::steady_clock::time_point();
+    ResponseWriter writer(this, conn, stream, keep_alive, handle_start);
+    try {
+        co_await (*handler)(stream ? stream->request : conn->request, writer);
+    } catch (const std::exception& e) {
+        if (writer.started() && stream) {
+            // HTTP/2只需重置这一个流
+            conn->http2->reset_stream(stream, Http2Error::InternalError);
+            flush_http2(conn);
+            co_return;
+        }
+        if (writer.started()) {
+            // 头部已经发出，只能中断连接，客户端由缺少结束块得知响应不完整
+            close_client(*conn);
+            co_return;
+        }
+        if (config_.collect_metrics) {
+            metrics_->record(stream ? stream->metrics_route : conn->metrics_route, Metrics::Stage::Handle,
+                             elapsed_ns(handle_start));
+        }
+        if (stream) {
+            complete_stream(conn, stream, make_error_response(500, e.what(), keep_alive));
+        } else {
+            complete_client(conn, make_error_response(500, e.what(), keep_alive), keep_alive);
+        }
+        co_return;
+    }
+    finish_stream(writer);
+}
+
+void HttpServer::begin_stream(ResponseWriter& writer) {
+    writer.started_ = true;
+    const std::shared_ptr<Connection>& conn = writer.conn_;
+    if (const std::shared_ptr<Http2Stream>& stream = writer.stream_) {
+        // 没有分块编码和Connection头的问题，响应体按DATA帧发送，END_STREAM标记结束
+        if (stream->closed) {
+            return;
+        }
+        if (config_.collect_metrics) {
+            metrics_->record(stream->metrics_route, Metrics::Stage::Handle, elapsed_ns(writer.handle_start_));
+        }
+        if (stream->screened) {
+            merge_middleware_headers(writer.head_, stream->middleware_headers);
+        }
+        metrics_->count_response(stream->metrics_route, writer.head_.status_code);
+        stream->response_status = writer.head_.status_code;
+        conn->http2->submit_headers(stream, writer.head_);
+        if (!conn->driving) {
+            flush_http2(conn);
+        }
+        return;
+    }
+    if (conn->state != Connection::State::Processing) {
+        return;
+    }
+    // 流式响应的处理阶段计到发出头部为止，其余时间计入发送阶段
+    if (config_.collect_metrics) {
+        metrics_->record(conn->metrics_route, Metrics::Stage::Handle, elapsed_ns(writer.handle_start_));
+    }
+    
+    Response& head = writer.head_;
+    if (conn->screened) {
+        merge_middleware_headers(head, conn->middleware_headers);
+    }
+    bool keep_alive = writer.keep_alive_;
+    const std::pmr::string* connection = head.find_header(HeaderId::Connection);
+    if (connection && header_has_token(*connection, "close")) {
+        keep_alive = false;
+    }
+    
+    ResponseStream& stream = conn->stream;
+    stream.active = true;
+    stream.chunked = false;
+    stream.finished = false;
+    stream.idle = false;
+    stream.has_length = false;
+    stream.remaining = 0;
+    stream.pending.clear();
+    bool bodyless = head.status_code < 200 || head.status_code == 204 || head.status_code == 304;
+    stream.discard = bodyless || conn->request.method == "HEAD";
+    if (const std::pmr::string* length = head.find_header(HeaderId::ContentLength)) {
+        auto result = std::from_chars(length->data(), length->data() + length->size(), stream.remaining);
+        stream.has_length = result.ec == std::errc() && result.ptr == length->data() + length->size();
+        keep_alive = keep_alive && stream.has_length;
+    } else if (!bodyless) {
+        if (conn->request.version == "HTTP/1.1") {
+            stream.chunked = true;
+            head.headers[HeaderId::TransferEncoding] = "chunked";
+        } else {
+            // HTTP/1.0不支持分块编码，以关闭连接标记响应结束
+            keep_alive = false;
+        }
+    }
+    
+    conn->output_head.clear();
+    head.write_head(conn->output_head, keep_alive ? "keep-alive" : "close", false);
+    metrics_->count_response(conn->metrics_route, head.status_code);
+    conn->response_status = head.status_code;
+    conn->response_bytes = conn->output_head.size();
+    conn->output_body.clear();
+    conn->output_shared.reset();
+    conn->output_offset = 0;
+    conn->keep_alive = keep_alive;
+    conn->state = Connection::State::Writing;
+    conn->last_active = std::chrono::steady_clock::now();
+    if (config_.collect_metrics) {
+        conn->send_started = conn->last_active;
+    }
+    arm_timeout(*conn);
+    write_client(conn);
+}
+
+void HttpServer::finish_stream(ResponseWriter& writer) {
+    if (!writer.started_) {
+        begin_stream(writer);
+    }
+    const std::shared_ptr<Connection>& conn = writer.conn_;
+    if (writer.stream_) {
+        conn->http2->end_stream(writer.stream_);
+        if (!conn->driving) {
+            flush_http2(conn);
+        }
+        return;
+    }
+    ResponseStream& stream = conn->stream;
+    if (conn->state != Connection::State::Writing || !stream.active) {
+        return;
+    }
+    
+    // 声明的长度没有写满时，只能以关闭连接告知客户端
+    if (stream.has_length && stream.remaining > 0 && !stream.discard) {
+        conn->keep_alive = false;
+    }
+    if (stream.chunked && !stream.discard) {
+        stream.pending.append("0\r\n\r\n");
+    }
+    stream.finished = true;
+    if (stream.idle) {
+        stream.idle = false;
+        conn->last_active = std::chrono::steady_clock::now();
+        arm_timeout(*conn);
+        write_client(conn);
+    }
+}
+
+bool HttpServer::next_stream_batch(const std::shared_ptr<Connection>& conn) {
+    ResponseStream& stream = conn->stream;
+    if (!stream.active) {
+        return false;
+    }
+    if (stream.pending.empty()) {
+        if (stream.finished) {
+            // 响应结束，不再保留两块缓冲区的容量
+            stream.active = false;
+            std::string().swap(stream.pending);
+            std::string().swap(conn->output_head);
+        } else {
+            stream.idle = true;
+        }
+        return false;
+    }
+    
+    conn->output_head.swap(stream.pending);
+    stream.pending.clear();
+    conn->response_bytes += conn->output_head.size();
+    conn->output_offset = 0;
+    // pending已腾空，恢复因积压而挂起的处理器；经由post恢复，避免在发送路径中重入
+    if (stream.waiting) {
+        conn->loop->post([handle = std::exchange(stream.waiting, nullptr)]() { handle.resume(); });
+    }
+    return true;
+}
+
+void HttpServer::finalize_response(const Request& request, Response& response, bool& keep_alive) const {
+    // 处理器显式要求关闭时以其为准
+    const std::pmr::string* connection = response.find_header(HeaderId::Connection);
+    if (connection && header_has_token(*connection, "close")) {
+        keep_alive = false;
+    }
+    
+    if (config_.compress_dynamic) {
+        compress_response(request, response);
+    }
+}
+
+void HttpServer::compress_response(const Request& request, Response& response) const {
+    if (response.file.file || response.body.size() < config_.compression_min_size || response.status_code == 206 ||
+        response.find_header(HeaderId::ContentEncoding) || response.find_header(HeaderId::ContentLength)) {
+        return;
+    }
+    const std::pmr::string* content_type = response.find_header(HeaderId::ContentType);
+    if (!is_compressible_type(content_type ? std::string_view(*content_type) : std::string_view("text/html"))) {
+        return;
+    }
+    
+    // 无论是否压缩，该响应都随Accept-Encoding变化
+    std::pmr::string& vary = response.headers[HeaderId::Vary];
+    if (vary.empty()) {
+        vary = "Accept-Encoding";
+    } else if (!header_has_token(vary, "Accept-Encoding") && vary != "*") {
+        vary += ", Accept-Encoding";
+    }
+    
+    const std::pmr::string* accept_encoding = request.find_header(HeaderId::AcceptEncoding);
+    if (!accept_encoding) {
+        return;
+    }
+    ContentEncoding encoding = negotiate_encoding(*accept_encoding);
+    std::string compressed;
+    if (encoding != ContentEncoding::Identity && compress_body(response.body, encoding, compressed) &&
+        compressed.size() < response.body.size()) {
+        response.body = std::move(compressed);
+        response.headers[HeaderId::ContentEncoding] = encoding_name(encoding);
+    }
+}
+
+void HttpServer::write_client(const std::shared_ptr<Connection>& conn) {
+    if (conn->loop->uses_io_uring()) {
+        send_client(conn);
+        return;
+    }
+    
+    // 每次按已发送字节数重新构造iovec，正确处理部分写
+    iovec iov[3];
+    for (;;) {
+        int iov_count = fill_output_iov(*conn, iov);
+        if (iov_count == 0) {
+            // 流式响应在当前一批发送完后装入下一批
+            if (next_stream_batch(conn)) {
+                continue;
+            }
+            break;
+        }
+        msghdr message{};
+        message.msg_iov = iov;
+        message.msg_iovlen = iov_count;
+        // 后面还有文件内容时用MSG_MORE让头部与文件开头合并成满载的报文段
+        ssize_t sent = sendmsg(conn->fd, &message, MSG_NOSIGNAL | (conn->file_remaining > 0 ? MSG_MORE : 0));
+        if (sent > 0) {
+            conn->output_offset += sent;
+            conn->last_active = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // 发送缓冲区已满，等待EPOLLOUT
+            return;
+        }
+        close_client(*conn);
+        return;
+    }
+    
+    if (conn->file_remaining > 0) {
+        FileSendStatus status = send_file_region(*conn);
+        if (status == FileSendStatus::Blocked) {
+            return;
+        }
+        if (status == FileSendStatus::Failed) {
+            close_client(*conn);
+            return;
+        }
+    }
+    
+    if (conn->stream.active) {
+        // 流式响应的数据已全部发出，等待处理器继续写入
+        return;
+    }
+    finish_write(conn);
+}
+
+void HttpServer::send_client(const std::shared_ptr<Connection>& conn) {
+    int iov_count = fill_output_iov(*conn, conn->send_iov);
+    if (iov_count == 0 && conn->file_remaining > 0) {
+        send_file_client(conn);
+        return;
+    }
+    if (iov_count == 0) {
+        if (next_stream_batch(conn)) {
+            send_client(conn);
+        } else if (!conn->stream.active) {
+            finish_write(conn);
+        }
+        return;
+    }
+    
+    // 发送请求与其他SQE一起在下一轮等待时提交
+    conn->send_header = msghdr{};
+    conn->send_header.msg_iov = conn->send_iov;
+    conn->send_header.msg_iovlen = iov_count;
+    conn->sending = true;
+    conn->send_operation = conn->loop->send_message(conn->fd, &conn->send_header, [this, conn](int result) {
+        conn->sending = false;
+        if (conn->state != Connection::State::Writing) {
+            return;
+        }
+        if (result > 0) {
+            conn->output_offset += result;
+            conn->last_active = std::chrono::steady_clock::now();
+            send_client(conn);
+        } else if (result == -EINTR || result == -EAGAIN) {
+            send_client(conn);
+        } else {
+            close_client(*conn);
+        }
+    }, conn->file_remaining > 0 ? MSG_MORE : 0);
+}
+
+void HttpServer::send_file_client(const std::shared_ptr<Connection>& conn) {
+    // io_uring没有sendfile操作，直接在非阻塞socket上调用sendfile，
+    // 发送缓冲区满时挂一个单次POLLOUT，可写后继续
+    switch (send_file_region(*conn)) {
+        case FileSendStatus::Done:
+            finish_write(conn);
+            break;
+        case FileSendStatus::Blocked:
+            conn->sending = true;
+            conn->send_operation = conn->loop->poll_once(conn->fd, POLLOUT, [this, conn](int result) {
+                conn->sending = false;
+                if (conn->state != Connection::State::Writing) {
+                    return;
+                }
+                if (result < 0) {
+                    close_client(*conn);
+                } else {
+                    send_file_client(conn);
+                }
+            });
+            break;
+        case FileSendStatus::Failed:
+            close_client(*conn);
+            break;
+    }
+}
+
+void HttpServer::finish_write(const std::shared_ptr<Connection>& conn) {
+    if (conn->interim) {
+        // 中间响应不是请求的结果，不计入指标和访问日志，发完后继续读取请求体
+        conn->interim = false;
+        conn->output_head.clear();
+        conn->output_offset = 0;
+        conn->state = Connection::State::Reading;
+        conn->last_active = std::chrono::steady_clock::now();
+        arm_timeout(*conn);
+        if (conn->loop->uses_io_uring() && !conn->receiving && !conn->peer_closed) {
+            start_receive(conn);
+        }
+        if (!conn->driving) {
+            drive_client(conn);
+        }
+        return;
+    }
+    if (config_.collect_metrics) {
+        metrics_->record(conn->metrics_route, Metrics::Stage::Send, elapsed_ns(conn->send_started));
+    }
+    if (access_log_) {
+        log_access(conn->peer_address, conn->request, conn->response_status, conn->response_bytes, conn->request_begin);
+    }
+    conn->metrics_route = 0;
+    // 排空期间已按保持连接发出的响应也在发送完后关闭
+    if (!conn->keep_alive || draining_.load(std::memory_order_relaxed)) {
+        close_client(*conn);
+        return;
+    }
+    
+    // 保持连接：回到读取状态，继续处理缓冲区中的流水线请求
+    conn->output_head.clear();
+    conn->output_shared.reset();
+    conn->output_offset = 0;
+    conn->output_file.reset();
+    conn->reset_arena();
+    conn->state = Connection::State::Reading;
+    conn->last_active = std::chrono::steady_clock::now();
+    conn->request_started = std::chrono::steady_clock::time_point();
+    arm_timeout(*conn);
+    if (conn->input.empty()) {
+        // 空闲连接不占用接收缓冲区
+        conn->input.release();
+    }
+    if (conn->loop->uses_io_uring() && !conn->receiving && !conn->peer_closed) {
+        start_receive(conn);
+    }
+    if (!conn->driving) {
+        drive_client(conn);
+    }
+}
+
+void HttpServer::log_access(uint32_t peer, const Request& request, int status, uint64_t bytes,
+                            std::chrono::steady_clock::time_point begin) {
+    // 只填写定长记录，格式化和写文件由访问日志的后台线程完成
+    AccessLogRecord record;
+    auto now = std::chrono::steady_clock::now();
+    record.time_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::system_clock::now().time_since_epoch()).count();
+    if (begin != std::chrono::steady_clock::time_point()) {
+        record.duration_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(now - begin).count());
+    }
+    record.bytes = bytes;
+    record.peer = peer;
+    record.status = static_cast<uint16_t>(status);
+    record.set_method(request.method);
+    record.set_target(request.path, request.query);
+    if (!access_log_->log(record)) {
+        metrics_->increment(Metrics::Counter::AccessLogDropped);
+    }
+}
+
+void HttpServer::arm_timeout(Connection& conn) {
+    // 只在阶段切换时挂入；阶段内的活动只更新last_active，到期时再顺延，避免每次读写都操作时间轮
+    TimingWheel& wheel = conn.loop->timing_wheel();
+    TimeoutPhase phase = timeout_phase(conn);
+    if (phase == TimeoutPhase::None || conn.state == Connection::State::Closed) {
+        wheel.cancel(conn.timer);
+        return;
+    }
+    wheel.schedule(conn.timer, timeout_deadline(conn, phase, config_));
+}
+
+void HttpServer::expire_client(Connection& conn) {
+    TimeoutPhase phase = timeout_phase(conn);
+    if (phase == TimeoutPhase::None || conn.state == Connection::State::Closed) {
+        return;
+    }
+    auto deadline = timeout_deadline(conn, phase, config_);
+    if (std::chrono::steady_clock::now() < deadline) {
+        conn.loop->timing_wheel().schedule(conn.timer, deadline);
+        return;
+    }
+    
+    switch (phase) {
+        case TimeoutPhase::Idle:
+            metrics_->increment(Metrics::Counter::IdleTimeouts);
+            break;
+        case TimeoutPhase::Header:
+            metrics_->increment(Metrics::Counter::HeaderTimeouts);
+            break;
+        case TimeoutPhase::Body:
+            metrics_->increment(Metrics::Counter::BodyTimeouts);
+            break;
+        default:
+            metrics_->increment(Metrics::Counter::SendTimeouts);
+            break;
+    }
+    // 请求读到一半时告知客户端超时，408发出后关闭连接（发送同样受send_timeout约束）
+    if (phase == TimeoutPhase::Header || phase == TimeoutPhase::Body) {
+        reject_client(conn.shared_from_this(), 408);
+        return;
+    }
+    close_client(conn);
+}
+
+uint64_t HttpServer::rejected_requests() const {
+    return worker_pool_ ? worker_pool_->rejected_count() : 0;
+}
+
+void HttpServer::close_client(Connection& conn) {
+    if (conn.state == Connection::State::Closed) {
+        return;
+    }
+    conn.state = Connection::State::Closed;
+    conn.loop->timing_wheel().cancel(conn.timer);
+    metrics_->increment(Metrics::Counter::ConnectionsClosed);
+    loop_states_.at(conn.loop).clients.erase(&conn);
+    if (open_connections_.fetch_sub(1) == 1 && draining_.load()) {
+        std::lock_guard<std::mutex> lock(drain_mutex_);
+        drain_cv_.notify_all();
+    }
+    conn.input.release();
+    std::string().swap(conn.stream.pending);
+    // 结束所有流：记录日志，恢复挂起的流式响应处理器
+    if (conn.http2) {
+        conn.http2->close_all();
+    }
+    // 因背压挂起的流式响应处理器恢复后发现连接不可写，随即结束
+    if (conn.stream.waiting) {
+        conn.loop->post([handle = std::exchange(conn.stream.waiting, nullptr)]() { handle.resume(); });
+    }
+    if (conn.loop->uses_io_uring()) {
+        // 取消进行中的操作，最后一个完成事件到达后连接随之释放并关闭fd
+        if (conn.receiving) {
+            conn.loop->cancel(conn.receive_operation);
+        }
+        if (conn.sending) {
+            conn.loop->cancel(conn.send_operation);
+        }
+    } else {
+        conn.loop->remove(conn.fd);
+    }
+}
+
+void HttpServer::start_http2(const std::shared_ptr<Connection>& conn) {
+    Http2Session::Settings settings;
+    settings.max_concurrent_streams = config_.http2_max_streams;
+    settings.initial_window_size = config_.http2_window_size;
+    settings.max_body_size = config_.max_body_size;
+    settings.max_buffered_output = config_.stream_buffer_size;
+    
+    // 会话属于连接，回调只在连接所属的事件循环线程上、连接存活期间被调用
+    Connection* raw = conn.get();
+    Http2Session::Callbacks callbacks;
+    callbacks.on_headers = [this, raw](const std::shared_ptr<Http2Stream>& stream) {
+        route_stream(stream);
+        // 达到单连接请求数上限或正在排空时，处理完已接受的流后关闭连接
+        if (raw->http2->streams_accepted() >= config_.max_keep_alive_requests ||
+            draining_.load(std::memory_order_relaxed)) {
+            raw->http2->shutdown();
+        }
+    };
+    callbacks.on_request = [this, raw](const std::shared_ptr<Http2Stream>& stream) {
+        ++raw->requests_served;
+        process_stream(raw->shared_from_this(), stream);
+    };
+    callbacks.on_close = [this, raw](const std::shared_ptr<Http2Stream>& stream) {
+        close_stream(*raw, *stream);
+    };
+    callbacks.on_writable = [raw](const std::shared_ptr<Http2Stream>& stream) {
+        // 经由post恢复，避免在生成帧的过程中重入会话
+        raw->loop->post([handle = std::exchange(stream->waiting, nullptr)]() { handle.resume(); });
+    };
+    conn->http2 = std::make_unique<Http2Session>(settings, std::move(callbacks));
+    conn->request_started = std::chrono::steady_clock::time_point();
+}
+
+bool HttpServer::upgrade_client(const std::shared_ptr<Connection>& conn, const Route* route) {
+    const Request& request = conn->request;
+    const std::pmr::string* upgrade = request.find_header("Upgrade");
+    const std::pmr::string* settings_header = request.find_header("HTTP2-Settings");
+    std::string settings;
+    if (!upgrade || !settings_header || request.version != "HTTP/1.1" || !header_has_token(*upgrade, "h2c") ||
+        !decode_http2_settings(*settings_header, settings)) {
+        return false;
+    }
+    start_http2(conn);
+    std::shared_ptr<Http2Stream> stream = conn->http2->upgrade(settings, request);
+    if (!stream) {
+        // 设置无效，继续以HTTP/1.1响应
+        conn->http2.reset();
+        return false;
+    }
+    
+    // 101放在输出缓冲区开头，flush_http2发完它之后才取出会话中的服务器序言和帧
+    static constexpr std::string_view kSwitching = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+    conn->output_head.assign(kSwitching);
+    conn->output_offset = 0;
+    stream->route = route;
+    stream->metrics_route = conn->metrics_route;
+    stream->started = conn->request_begin;
+    
+    // 请求已复制到流中，连接回到读取状态等待客户端的连接序言，请求作为流1处理
+    conn->reset_arena();
+    conn->metrics_route = 0;
+    conn->state = Connection::State::Reading;
+    process_stream(conn, stream);
+    flush_http2(conn);
+    return true;
+}
+
+bool HttpServer::dispatch_http2(const std::shared_ptr<Connection>& conn) {
+    // 输出积压时不处理新的帧，数据留在输入缓冲区（epoll下留在内核缓冲区）形成背压
+    if (!http2_blocked(*conn) && !conn->input.empty()) {
+        size_t consumed = conn->http2->receive(conn->input.readable());
+        conn->input.consume(consumed);
+    }
+    // 会话中的请求在这里一并处理完，之后统一发送本批输出
+    if (conn->state != Connection::State::Closed) {
+        flush_http2(conn);
+    }
+    return false;
+}
+
+void HttpServer::flush_http2(const std::shared_ptr<Connection>& conn) {
+    // io_uring的发送进行中时由其完成回调继续
+    if (conn->state == Connection::State::Closed || conn->sending) {
+        return;
+    }
+    Http2Session& session = *conn->http2;
+    for (;;) {
+        if (conn->output_offset == conn->output_head.size()) {
+            // 上一批已全部发出，取出会话中积累的帧（DATA帧在此时按发送窗口生成）
+            conn->output_offset = 0;
+            if (!session.take_output(conn->output_head)) {
+                conn->output_head.clear();
+                break;
+            }
+        }
+        if (conn->loop->uses_io_uring()) {
+            conn->send_iov[0].iov_base = conn->output_head.data() + conn->output_offset;
+            conn->send_iov[0].iov_len = conn->output_head.size() - conn->output_offset;
+            conn->send_header = msghdr{};
+            conn->send_header.msg_iov = conn->send_iov;
+            conn->send_header.msg_iovlen = 1;
+            conn->sending = true;
+            conn->send_operation = conn->loop->send_message(conn->fd, &conn->send_header, [this, conn](int result) {
+                conn->sending = false;
+                if (conn->state == Connection::State::Closed) {
+                    return;
+                }
+                if (result > 0) {
+                    conn->output_offset += result;
+                    conn->last_active = std::chrono::steady_clock::now();
+                } else if (result != -EINTR && result != -EAGAIN) {
+                    close_client(*conn);
+                    return;
+                }
+                flush_http2(conn);
+            });
+            arm_timeout(*conn);
+            return;
+        }
+        ssize_t sent = send(conn->fd, conn->output_head.data() + conn->output_offset,
+                            conn->output_head.size() - conn->output_offset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn->output_offset += sent;
+            conn->last_active = std::chrono::steady_clock::now();
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // 发送缓冲区已满，等待EPOLLOUT
+            arm_timeout(*conn);
+            return;
+        }
+        close_client(*conn);
+        return;
+    }
+    
+    // 输出已全部发出：GOAWAY之后流都已结束，或对端已关闭且没有进行中的流时关闭连接
+    if (session.finished() || (conn->peer_closed && session.open_streams() == 0)) {
+        close_client(*conn);
+        return;
+    }
+    arm_timeout(*conn);
+    // 积压期间暂停的读取在这里恢复
+    if (conn->loop->uses_io_uring() && !conn->receiving && !conn->peer_closed) {
+        start_receive(conn);
+    }
+    if (!conn->driving && (conn->readable || !conn->input.empty())) {
+        drive_client(conn);
+    }
+}
+
+void HttpServer::route_stream(const std::shared_ptr<Http2Stream>& stream) {
+    // 与begin_body相同：路由在请求头到达时查找一次，流式请求体处理器在此创建
+    Request& request = stream->request;
+    stream->route = find_route(request.method, request.path, request.params);
+    stream->metrics_route = stream->route ? stream->route->metrics_id : 0;
+    if (stream->reject_status != 0) {
+        return;
+    }
+    if (stream->route && stream->route->streaming) {
+        try {
+            BodyStream body = stream->route->streaming(request);
+            stream->body_sink = std::move(body.on_data);
+            stream->body_complete = std::move(body.on_complete);
+        } catch (const std::exception&) {
+            stream->reject_status = 500;
+        }
+    } else if (stream->content_length > 0 && static_cast<uint64_t>(stream->content_length) > config_.max_body_size) {
+        stream->reject_status = 413;
+    }
+}
+
+void HttpServer::process_stream(const std::shared_ptr<Connection>& conn, const std::shared_ptr<Http2Stream>& stream) {
+    if (stream->reject_status != 0) {
+        complete_stream(conn, stream, make_error_response(stream->reject_status, "无法处理的请求", true));
+        return;
+    }
+    
+    // 与process_client的分派顺序相同；流之间互不等待，连接上没有保持连接的取舍
+    const Request& request = stream->request;
+    RequestHandler handler = std::move(stream->body_complete);
+    const Route* route = stream->route;
+    stream->body_sink = nullptr;
+    
+    bool cacheable = !handler && route && route->cache && route->handler && response_cache_ && request.method == "GET";
+    if (!screen_request(conn, stream, handler ? nullptr : route, cacheable, true)) {
+        return;
+    }
+    if (!handler && route && route->static_response) {
+        auto handle_start = config_.collect_metrics ? std::chrono::steady_clock::now()
+                                                    : std::chrono::steady_clock::time_point();
+        auto message = route->static_response->select(request, true);
+        if (config_.collect_metrics) {
+            metrics_->record(stream->metrics_route, Metrics::Stage::Handle, elapsed_ns(handle_start));
+        }
+        complete_stream(conn, stream, std::move(message));
+        return;
+    }
+    if (!handler && route && route->stream_response) {
+        detach(execute_stream(conn, stream, &route->stream_response, true));
+        return;
+    }
+    if (!handler && route && route->async_handler) {
+        detach(execute_async(conn, stream, &route->async_handler, true));
+        return;
+    }
+    std::string cache_key;
+    if (cacheable && serve_cached(conn, stream, *route, true, cache_key)) {
+        return;
+    }
+    submit_request(conn, stream, route, std::move(handler), true, std::move(cache_key));
+}
+
+void HttpServer::close_stream(Connection& conn, const Http2Stream& stream) {
+    // 响应之前被重置的流不记录
+    if (stream.response_status == 0) {
+        return;
+    }
+    if (config_.collect_metrics && stream.responded) {
+        metrics_->record(stream.metrics_route, Metrics::Stage::Send, elapsed_ns(stream.send_started));
+    }
+    if (access_log_) {
+        log_access(conn.peer_address, stream.request, stream.response_status, stream.response_bytes, stream.started);
+    }
+}
+
+void HttpServer::complete_stream(const std::shared_ptr<Connection>& conn, const std::shared_ptr<Http2Stream>& stream,
+                                 Response response) {
+    // 处理期间流可能已被对端重置，连接也可能已关闭
+    if (stream->closed) {
+        return;
+    }
+    metrics_->count_response(stream->metrics_route, response.status_code);
+    stream->response_status = response.status_code;
+    conn->http2->submit_response(stream, std::move(response));
+    // 在dispatch_http2中同步完成时由它统一发送
+    if (!conn->driving) {
+        flush_http2(conn);
+    }
+}
+
+void HttpServer::complete_stream(const std::shared_ptr<Connection>& conn, const std::shared_ptr<Http2Stream>& stream,
+                                 std::shared_ptr<const std::string> message) {
+    if (stream->closed) {
+        return;
+    }
+    stream->response_status = message_status(*message);
+    metrics_->count_response(stream->metrics_route, stream->response_status);
+    conn->http2->submit_message(stream, *message);
+    if (!conn->driving) {
+        flush_http2(conn);
+    }
+}
+
+const Route* HttpServer::find_route(std::string_view method, std::string_view path, PathParams& params) const {
+    // 没有单独注册HEAD的路径按GET处理，响应体在发送前丢弃（见start_write）
+    const Route* route = router_.find(method, path, params);
+    if (!route && method == "HEAD") {
+        route = router_.find("GET", path, params);
+    }
+    return route;
+}
+
+Response HttpServer::handle_request(const Request& request) {
+    // 路径参数只对本次查找有效，调用处理器时使用带参数的副本
+    PathParams params;
+    const Route* route = find_route(request.method, request.path, params);
+    if (route && route->handler) {
+        if (params.count == 0) {
+            return route->handler(request);
+        }
+        Request routed = request;
+        routed.params = params;
+        return route->handler(routed);
+    }
+    
+    // 默认404响应
+    Response response;
+    response.status_code = 404;
+    response.status_text = "Not Found";
+    response.body = "<h1>404 Not Found</h1><p>请求的资源未找到: " + request.path + "</p>";
+    
+    return response;
 }
 
 } // namespace http
\ No newline at end of file
@@ -1,69 +1,441 @@
 #pragma once
 
 #include <string>
+#include <memory_resource>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
 #include <memory>
 #include <vector>
 #include <thread>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <chrono>
+#include <coroutine>
+#include "router.hpp"
+#include "arena.hpp"
+#include "task.hpp"
+#include "headers.hpp"
 
 namespace http {
 
+/**
+ * Request和Response的字符串与头部都是std::pmr容器。
+ * 默认构造时使用current_memory_resource()：服务器处理请求期间为连接的RequestArena，
+ * 在请求之间整体回收；其余情况为堆。移动保留原内存资源，复制则回到堆上，
+ * 因此需要在本次请求之后继续保存的对象（如缓存）应当复制而不是移动。
+ */
 struct Request {
-    std::string method;
-    std::string path;
-    std::string version;
-    std::unordered_map<std::string, std::string> headers;
-    std::string body;
+    std::pmr::string method;
+    std::pmr::string path;      // 不含查询字符串的路径
+    std::pmr::string query;     // '?'之后的查询字符串
+    std::pmr::string version;
+    HeaderMap headers;          // 与所属对象使用同一内存资源
+    std::pmr::string body;
+    PathParams params;          // 路由匹配得到的路径参数
+    
+    Request() : Request(current_memory_resource()) {}
+    explicit Request(std::pmr::memory_resource* resource)
+        : method(resource), path(resource), query(resource), version(resource), headers(resource), body(resource) {}
+    
+    // 大小写不敏感地查找请求头，不存在时返回nullptr；常用头部按编号查找更快
+    const std::pmr::string* find_header(std::string_view name) const { return headers.find(name); }
+    const std::pmr::string* find_header(HeaderId id) const { return headers.find(id); }
+    
+    // 路径参数的值（如 /users/:id 中的id），不存在时返回空
+    std::string_view param(std::string_view name) const;
+};
+
+class OpenFile;
+
+// 以sendfile发送的文件区间
+struct FileRegion {
+    std::shared_ptr<const OpenFile> file;
+    uint64_t offset = 0;
+    uint64_t length = 0;
 };
 
 struct Response {
     int status_code = 200;
-    std::string status_text = "OK";
-    std::unordered_map<std::string, std::string> headers;
-    std::string body;
+    std::pmr::string status_text;
+    HeaderMap headers;
+    std::pmr::string body;
+    FileRegion file;       // 设置file时响应体由事件循环从文件零拷贝发送，body被忽略
+    
+    Response() : Response(current_memory_resource()) {}
+    explicit Response(std::pmr::memory_resource* resource)
+        : status_text("OK", resource), headers(resource), body(resource) {}
+    
+    // 大小写不敏感地查找响应头，不存在时返回nullptr
+    const std::pmr::string* find_header(std::string_view name) const { return headers.find(name); }
+    const std::pmr::string* find_header(HeaderId id) const { return headers.find(id); }
     
+    // 将状态行和头部追加到out，缺省的Content-Length/Content-Type自动补充
+    // （content_length为false时不补充Content-Length，用于流式响应），Connection头使用connection参数的值
+    void write_head(std::string& out, std::string_view connection, bool content_length = true) const;
+    
+    // 完整的响应报文（头部 + 响应体），不包含file区间的内容
     std::string to_string() const;
 };
 
 using RequestHandler = std::function<Response(const Request&)>;
 
+class NextHandler;
+class MiddlewareStack;
+
+// 运行时中间件，调用next(request)交给链中的下一环（见middleware.hpp）
+using Middleware = std::function<Response(const Request&, const NextHandler&)>;
+
+/**
+ * 流式请求体处理
+ * on_data在I/O线程按到达顺序接收请求体分块（不应阻塞），
+ * on_complete在请求体接收完毕后于线程池中生成响应（此时Request::body为空）
+ */
+struct BodyStream {
+    std::function<void(std::string_view chunk)> on_data;
+    RequestHandler on_complete;
+};
+
+// 请求头到达后调用，为每个请求创建独立的BodyStream
+using StreamingHandler = std::function<BodyStream(const Request&)>;
+
+/**
+ * 协程处理器
+ * 在连接所属的事件循环线程上运行，可以co_await async_io.hpp中的定时器、
+ * 非阻塞socket读写和offload()，等待期间不占用任何线程。
+ * 两次co_await之间的代码不能阻塞；Request在协程结束前保持有效。
+ */
+using AsyncHandler = std::function<Task<Response>(const Request&)>;
+
+class HttpServer;
+class EventLoop;
+class ThreadPool;
+class StaticResponse;
+class Metrics;
+class LoadShedder;
+class ResponseCache;
+class AccessLog;
+struct Connection;
+struct Http2Stream;
+
+/**
+ * 流式响应写入器
+ * 首次写入（或处理器结束）时发送状态行和头部，之后每次write作为一个分块以
+ * Transfer-Encoding: chunked发送；头部中声明了Content-Length时按原样发送，
+ * HTTP/1.0客户端则发送原始数据并在结束后关闭连接。
+ * 尚未发送的数据超过ServerConfig::stream_buffer_size时write挂起，直到socket发送缓冲区
+ * 腾出空间再恢复，因此无论响应多大，每个连接缓存的数据都有上限（写入的数据会被复制，单次写入不宜过大）。
+ * HTTP/2连接上每次write成为DATA帧，按流量控制窗口发送，积压同样受stream_buffer_size限制。
+ */
+class ResponseWriter {
+public:
+    class WriteAwaiter {
+    public:
+        WriteAwaiter(ResponseWriter* writer, bool suspend) : writer_(writer), suspend_(suspend) {}
+        
+        bool await_ready() const noexcept { return !suspend_; }
+        void await_suspend(std::coroutine_handle<> handle);
+        // 连接仍可写入时返回true；返回false（连接已关闭或HEAD请求）后应停止写入
+        bool await_resume() const { return writer_->writable(); }
+        
+    private:
+        ResponseWriter* writer_;
+        bool suspend_;
+    };
+    
+    ResponseWriter(const ResponseWriter&) = delete;
+    ResponseWriter& operator=(const ResponseWriter&) = delete;
+    
+    // 状态码和响应头，首次写入前可以修改；body被忽略
+    Response& head() { return head_; }
+    
+    // 状态行和头部是否已经发送
+    bool started() const { return started_; }
+    
+    // 写入的数据是否还会被发送
+    bool writable() const;
+    
+    // 追加一段响应体，必须co_await；空数据被忽略
+    [[nodiscard]] WriteAwaiter write(std::string_view data);
+    
+private:
+    friend class HttpServer;
+    
+    ResponseWriter(HttpServer* server, std::shared_ptr<Connection> conn, std::shared_ptr<Http2Stream> stream,
+                   bool keep_alive, std::chrono::steady_clock::time_point handle_start);
+    
+    HttpServer* server_;
+    std::shared_ptr<Connection> conn_;
+    std::shared_ptr<Http2Stream> stream_;   // HTTP/2连接上的流，HTTP/1.x时为空
+    Response head_;
+    bool keep_alive_;
+    bool started_ = false;
+    std::chrono::steady_clock::time_point handle_start_;
+};
+
+/**
+ * 流式响应处理器
+ * 与协程处理器一样在事件循环线程上运行，通过ResponseWriter边生成边发送响应体，
+ * 处理器返回后发送结束块。生成数据需要阻塞时应使用offload()。
+ */
+using StreamResponseHandler = std::function<Task<void>(const Request&, ResponseWriter&)>;
+
+/**
+ * 响应缓存策略
+ * 缓存键由方法、路径、查询字符串和vary中列出的请求头组成；启用动态压缩时还包括协商出的编码。
+ * 只缓存200响应，带Set-Cookie、Cache-Control: no-store/no-cache/private或要求关闭连接的响应不缓存。
+ */
+struct CachePolicy {
+    std::chrono::milliseconds ttl{1000};     // 缓存项的有效期，从处理器返回时算起
+    std::vector<std::string> vary;           // 影响响应内容、需要加入缓存键的请求头
+};
+
+// 路由表中的一项，同一路径可分别注册五类处理方式，优先级为 流式请求体 > 静态 > 流式响应 > 协程 > 普通
+struct Route {
+    RequestHandler handler;
+    StreamingHandler streaming;
+    StreamResponseHandler stream_response;
+    AsyncHandler async_handler;
+    std::shared_ptr<const StaticResponse> static_response;
+    uint32_t metrics_id = 0;    // 指标中的路由编号，0表示未匹配
+    bool shed_exempt = false;   // 过载时也不拒绝（如健康检查、管理接口）
+    std::shared_ptr<const CachePolicy> cache;   // 非空时缓存GET请求的普通处理器响应
+};
+
+// I/O后端
+enum class IoBackend {
+    Epoll,    // epoll边沿触发 + 非阻塞recv/sendmsg
+    IoUring   // io_uring：multishot accept/recv、provided buffer、批量提交
+};
+
+const char* io_backend_name(IoBackend backend);
+
+/**
+ * 服务器配置
+ */
+struct ServerConfig {
+    int port = 8080;
+    size_t io_threads = 0;         // 事件循环线程数，0表示使用硬件并发数
+    size_t worker_threads = 0;     // 处理器线程池大小，0表示使用硬件并发数
+    size_t max_queued_requests = 1024;  // 线程池排队上限，超出时返回503
+    std::chrono::milliseconds keep_alive_timeout{5000};  // 连接空闲（等待下一个请求）超时
+    std::chrono::milliseconds header_timeout{10000};     // 从请求第一个字节到收齐请求头的上限，超时返回408
+    std::chrono::milliseconds body_timeout{30000};       // 接收请求体时两次收到数据的最大间隔，超时返回408
+    std::chrono::milliseconds send_timeout{30000};       // 发送响应时两次写出数据的最大间隔
+    size_t max_keep_alive_requests = 1000;               // 单个连接最多处理的请求数
+    size_t max_body_size = 8 * 1024 * 1024;              // 非流式处理器的请求体上限，超出返回413
+    bool compress_dynamic = false;                       // 是否对动态响应按Accept-Encoding即时压缩
+    size_t compression_min_size = 1024;                  // 动态压缩的最小响应体大小
+    int listen_backlog = 1024;                           // listen()的等待队列长度（受net.core.somaxconn限制）
+    bool reuse_port = false;                             // 每个事件循环使用独立的SO_REUSEPORT监听socket，由内核分配连接
+    bool pin_io_threads = false;                         // 将事件循环线程依次绑定到可用的CPU核心
+    IoBackend io_backend = IoBackend::Epoll;             // 选择io_uring但内核不支持时自动回退到epoll
+    bool collect_metrics = true;                         // 按路由记录各阶段延迟直方图和响应计数
+    size_t stream_buffer_size = 64 * 1024;               // 流式响应未发送数据的上限，超出时写入方挂起
+    std::chrono::milliseconds drain_timeout{30000};      // 优雅退出时等待进行中请求完成的上限
+    bool load_shedding = true;                           // 按排队延迟自适应拒绝线程池中的请求（CoDel），过载时返回503
+    std::chrono::milliseconds shed_target{5};            // 可接受的排队延迟，一个窗口内始终高于它即判定过载
+    std::chrono::milliseconds shed_interval{100};        // 过载判定窗口；未过载时排队超过该值的请求同样被拒绝
+    std::chrono::seconds retry_after{1};                 // 过载503响应的Retry-After
+    size_t response_cache_size = 64 * 1024 * 1024;       // 响应缓存的内存预算（字节），0表示禁用
+    size_t response_cache_shards = 16;                   // 响应缓存的分片数，每个分片一把锁
+    std::string access_log{};                            // 访问日志文件路径（JSON行），为空表示不记录
+    size_t access_log_max_size = 64 * 1024 * 1024;       // 单个访问日志文件的大小上限，超出时轮转，0表示不轮转
+    size_t access_log_max_files = 5;                     // 轮转保留的历史文件数（path.1 ~ path.N）
+    size_t access_log_buffer = 8192;                     // 每个事件循环线程的日志缓冲区容量（条），满时丢弃并计数
+    bool http2 = true;                                   // 接受明文HTTP/2（h2c）：以连接序言直接开始，或由Upgrade: h2c升级
+    uint32_t http2_max_streams = 100;                    // 每个HTTP/2连接的最大并发流数，超出的流被拒绝（REFUSED_STREAM）
+    uint32_t http2_window_size = 1024 * 1024;            // HTTP/2每个流的接收窗口（字节），决定单个上传流不等待确认能发送的数据量
+    std::vector<int> inherited_listeners{};              // 热升级时从旧进程接收的监听socket，非空时不再创建，所有权归服务器
+};
+
 class HttpServer {
 public:
     explicit HttpServer(int port = 8080);
+    explicit HttpServer(const ServerConfig& config);
     ~HttpServer();
     
     // 禁用拷贝构造和赋值
     HttpServer(const HttpServer&) = delete;
     HttpServer& operator=(const HttpServer&) = delete;
     
-    // 注册路由处理器
+    // 注册路由处理器，path支持参数段（/users/:id）和通配后缀（/files/*path）
     void register_handler(const std::string& method, const std::string& path, RequestHandler handler);
     
+    // 注册静态路由：完整报文在注册时生成一次，之后直接从共享内存发送，并支持ETag/304
+    void register_static(const std::string& method, const std::string& path, const Response& response);
+    
+    // 注册流式请求体处理器，大请求体按块交给处理器而不是缓存在Request::body中
+    void register_streaming_handler(const std::string& method, const std::string& path, StreamingHandler handler);
+    
+    // 注册协程处理器，返回Task<Response>，在事件循环上异步执行
+    void register_async_handler(const std::string& method, const std::string& path, AsyncHandler handler);
+    
+    // 注册流式响应处理器，响应体通过ResponseWriter分块发送，不必先完整生成在内存中
+    void register_stream_response(const std::string& method, const std::string& path, StreamResponseHandler handler);
+    
+    // 该路由在过载时也不拒绝（只影响在线程池中执行的普通处理器）
+    void exempt_from_shedding(const std::string& method, const std::string& path);
+    
+    // 缓存该路径上GET普通处理器的响应：ttl内的相同请求不再执行处理器，并发未命中只执行一次
+    void cache_responses(const std::string& path, const CachePolicy& policy);
+    
+    // 追加全局中间件，按添加顺序作用于所有路由和404。线程池中执行的普通处理器（包括流式请求体的
+    // 完成回调）和404被链包裹；静态、协程、流式响应和可缓存的路由在I/O线程上运行链，最后一环返回
+    // 占位响应：中间件不调用next时直接发送它给出的响应，否则它在占位响应上添加的头部合并到实际响应中
+    // （处理器已设置的同名头部不覆盖），对状态码和响应体的修改只对线程池中的处理器生效。
+    // 静态路由的报文在注册时就合并了中间件的头部，因此须在register_static()之前调用。
+    // 编译期组合的MiddlewareChain可作为一个中间件传入，整条链只增加一次间接调用
+    void use(Middleware middleware);
+    
     // 启动服务器
     void start();
     
-    // 停止服务器
+    // 停止服务器，立即关闭所有连接
     void stop();
     
+    // 优雅退出：停止接受新连接并关闭监听socket，关闭空闲连接，其余连接发送完当前响应后关闭；
+    // 全部连接结束或超时后停止服务器。返回是否在超时前排空。排空后的服务器不能再次启动
+    bool drain(std::chrono::milliseconds timeout);
+    
     // 检查服务器是否在运行
     bool is_running() const { return running_.load(); }
+    
+    // 监听端口（继承监听socket时以实际端口为准）
+    int port() const { return port_; }
+    
+    // 事件循环线程数
+    size_t io_thread_count() const { return config_.io_threads; }
+    
+    // 处理器线程池大小
+    size_t worker_thread_count() const { return config_.worker_threads; }
+    
+    // 实际使用的I/O后端（可能已从io_uring回退到epoll）
+    IoBackend io_backend() const { return config_.io_backend; }
+    
+    // 监听分片数：reuse_port模式下等于事件循环线程数，否则为1
+    size_t shard_count() const { return listen_sockets_.size(); }
+    
+    // 监听socket，热升级时交给新进程
+    const std::vector<int>& listen_sockets() const { return listen_sockets_; }
+    
+    // 当前打开的连接数
+    size_t connection_count() const { return open_connections_.load(std::memory_order_relaxed); }
+    
+    // 因线程池排队已满而被拒绝的请求数
+    uint64_t rejected_requests() const;
+    
+    // 服务器指标（按线程分片，导出时合并）
+    const Metrics& metrics() const { return *metrics_; }
 
 private:
+    friend class ResponseWriter;
+    
+    ServerConfig config_;
     int port_;
-    int server_socket_;
+    std::vector<int> listen_sockets_;
     std::atomic<bool> running_{false};
-    std::vector<std::thread> worker_threads_;
+    std::vector<std::unique_ptr<EventLoop>> loops_;
+    std::vector<std::thread> loop_threads_;
+    std::unique_ptr<ThreadPool> worker_pool_;
+    
+    // 每个事件循环上的监听socket和连接，在start()中建立，之后只在对应的循环线程上修改
+    struct LoopState {
+        std::vector<int> listeners;
+        std::unordered_map<int, uint64_t> accepts;    // io_uring：各监听socket上的multishot accept操作
+        std::unordered_set<Connection*> clients;
+    };
+    std::unordered_map<EventLoop*, LoopState> loop_states_;
+    std::atomic<size_t> open_connections_{0};
+    std::atomic<bool> draining_{false};
+    std::mutex drain_mutex_;
+    std::condition_variable drain_cv_;
+    size_t drained_loops_ = 0;
+    
+    Router<Route> router_;
+    std::unique_ptr<Metrics> metrics_;
+    
+    // 过载控制，未启用时为空；拒绝时发送预先生成的503报文，下标为keep_alive
+    std::unique_ptr<LoadShedder> shedder_;
+    std::shared_ptr<const std::string> overload_response_[2];
+    
+    // 响应缓存，response_cache_size为0时为空
+    std::unique_ptr<ResponseCache> response_cache_;
+    
+    // 全局中间件，未添加时为空
+    std::unique_ptr<MiddlewareStack> middleware_;
+    bool has_static_routes_ = false;
+    
+    // 访问日志，未配置路径时为空；在finish_write中为每个发送完毕的响应记录一条
+    std::unique_ptr<AccessLog> access_log_;
     
-    std::unordered_map<std::string, RequestHandler> handlers_;
+    Route& add_route(const std::string& method, const std::string& path);
+    void setup_sockets();
+    void adopt_listeners();
+    int create_listener();
+    void drain_loop(EventLoop& loop);
+    void accept_connections(EventLoop& loop, int listen_socket);
+    void start_accept(EventLoop& loop, int listen_socket);
+    void open_client(EventLoop& loop, int client_socket);
+    void start_receive(const std::shared_ptr<Connection>& conn);
+    void handle_client(const std::shared_ptr<Connection>& conn, uint32_t events);
+    void drive_client(const std::shared_ptr<Connection>& conn);
+    bool read_client(Connection& conn);
+    bool dispatch_client(const std::shared_ptr<Connection>& conn);
+    bool begin_body(const std::shared_ptr<Connection>& conn);
+    bool read_body(const std::shared_ptr<Connection>& conn);
+    void process_client(const std::shared_ptr<Connection>& conn);
+    bool serve_cached(const std::shared_ptr<Connection>& conn, const std::shared_ptr<Http2Stream>& stream,
+                      const Route& route, bool keep_alive, std::string& cache_key);
+    void submit_request(const std::shared_ptr<Connection>& conn, std::shared_ptr<Http2Stream> stream, const Route* route,
+                        RequestHandler handler, bool keep_alive, std::string cache_key);
+    void abandon_fill(const std::string& cache_key);
+    void reject_client(const std::shared_ptr<Connection>& conn, int status_code);
+    void shed_client(const std::shared_ptr<Connection>& conn, const std::shared_ptr<Http2Stream>& stream, bool keep_alive);
+    void complete_client(const std::shared_ptr<Connection>& conn, Response response, bool keep_alive);
+    void complete_client(const std::shared_ptr<Connection>& conn, std::shared_ptr<const std::string> message, bool keep_alive);
+    void start_write(const std::shared_ptr<Connection>& conn, bool keep_alive);
+    void write_client(const std::shared_ptr<Connection>& conn);
+    void send_client(const std::shared_ptr<Connection>& conn);
+    void send_file_client(const std::shared_ptr<Connection>& conn);
+    bool next_stream_batch(const std::shared_ptr<Connection>& conn);
+    void finish_write(const std::shared_ptr<Connection>& conn);
+    void log_access(uint32_t peer, const Request& request, int status, uint64_t bytes,
+                    std::chrono::steady_clock::time_point begin);
     
-    void setup_socket();
-    void accept_connections();
-    void handle_client(int client_socket);
-    Request parse_request(const std::string& raw_request);
+    // HTTP/2（见http2.hpp）：会话只处理协议，路由、执行处理器和收发数据仍由服务器完成
+    void start_http2(const std::shared_ptr<Connection>& conn);
+    bool upgrade_client(const std::shared_ptr<Connection>& conn, const Route* route);
+    bool dispatch_http2(const std::shared_ptr<Connection>& conn);
+    void flush_http2(const std::shared_ptr<Connection>& conn);
+    void route_stream(const std::shared_ptr<Http2Stream>& stream);
+    void process_stream(const std::shared_ptr<Connection>& conn, const std::shared_ptr<Http2Stream>& stream);
+    void close_stream(Connection& conn, const Http2Stream& stream);
+    void complete_stream(const std::shared_ptr<Connection>& conn, const std::shared_ptr<Http2Stream>& stream,
+                         Response response);
+    void complete_stream(const std::shared_ptr<Connection>& conn, const std::shared_ptr<Http2Stream>& stream,
+                         std::shared_ptr<const std::string> message);
+    void arm_timeout(Connection& conn);
+    void expire_client(Connection& conn);
+    void close_client(Connection& conn);
+    const Route* find_route(std::string_view method, std::string_view path, PathParams& params) const;
     Response handle_request(const Request& request);
-    std::string create_handler_key(const std::string& method, const std::string& path);
+    bool run_middleware(const Request& request, Response& response) const;
+    bool screen_request(const std::shared_ptr<Connection>& conn, const std::shared_ptr<Http2Stream>& stream,
+                        const Route* route, bool cacheable, bool keep_alive);
+    Response execute_request(const Request& request, const RequestHandler* handler, const HeaderMap* screened,
+                             bool& keep_alive);
+    Task<void> execute_async(std::shared_ptr<Connection> conn, std::shared_ptr<Http2Stream> stream,
+                             const AsyncHandler* handler, bool keep_alive);
+    Task<void> execute_stream(std::shared_ptr<Connection> conn, std::shared_ptr<Http2Stream> stream,
+                              const StreamResponseHandler* handler, bool keep_alive);
+    void begin_stream(ResponseWriter& writer);
+    void finish_stream(ResponseWriter& writer);
+    void finalize_response(const Request& request, Response& response, bool& keep_alive) const;
+    void compress_response(const Request& request, Response& response) const;
 };
 
 } // namespace http
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include "io_uring.hpp"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace http {
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+// recv multishot需要6.0以上内核，无法通过opcode探测，只能比较版本号
+bool kernel_at_least(int major, int minor) {
+    utsname name{};
+    if (uname(&name) != 0) {
+        return false;
+    }
+    char* end = nullptr;
+    long kernel_major = std::strtol(name.release, &end, 10);
+    long kernel_minor = *end == '.' ? std::strtol(end + 1, nullptr, 10) : 0;
+    return kernel_major > major || (kernel_major == major && kernel_minor >= minor);
+}
+
+} // namespace
+
+IoUring::IoUring(unsigned entries, unsigned cq_entries) {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = cq_entries;
+    ring_fd_ = io_uring_setup(entries, &params);
+    if (ring_fd_ < 0) {
+        throw std::runtime_error("无法创建io_uring: " + std::string(std::strerror(errno)));
+    }
+    features_ = params.features;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = features_ & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                    IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        release();
+        throw std::runtime_error("无法映射io_uring提交队列");
+    }
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                        IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            cq_ring_ = nullptr;
+            release();
+            throw std::runtime_error("无法映射io_uring完成队列");
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                      IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        release();
+        throw std::runtime_error("无法映射io_uring SQE数组");
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqe_tail_ = sqe_submitted_ = *sq_tail_;
+
+    // SQE下标与环位置一一对应，索引数组只需初始化一次
+    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries_; ++i) {
+        array[i] = i;
+    }
+
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+IoUring::~IoUring() {
+    release();
+}
+
+void IoUring::release() {
+    // 先关闭环，内核取消所有未完成的请求后才释放缓冲区
+    if (ring_fd_ >= 0) {
+        close(ring_fd_);
+        ring_fd_ = -1;
+    }
+    if (buffer_storage_) {
+        munmap(buffer_storage_, buffer_storage_size_);
+        buffer_storage_ = nullptr;
+    }
+    if (buffer_ring_) {
+        munmap(buffer_ring_, buffer_ring_size_);
+        buffer_ring_ = nullptr;
+    }
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+        sqes_ = nullptr;
+    }
+    if (cq_ring_ && cq_ring_ != sq_ring_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+    cq_ring_ = nullptr;
+    if (sq_ring_) {
+        munmap(sq_ring_, sq_ring_size_);
+        sq_ring_ = nullptr;
+    }
+}
+
+bool IoUring::supported() {
+    if (!kernel_at_least(6, 0)) {
+        return false;
+    }
+
+    try {
+        IoUring ring(8, 16);
+        if (!(ring.features_ & IORING_FEAT_EXT_ARG) || !(ring.features_ & IORING_FEAT_NODROP)) {
+            return false;
+        }
+
+        constexpr unsigned kProbeOps = 256;
+        std::vector<char> storage(sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (io_uring_register(ring.ring_fd_, IORING_REGISTER_PROBE, probe, kProbeOps) < 0) {
+            return false;
+        }
+        for (int opcode : {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG, IORING_OP_READ,
+                           IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL}) {
+            if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+
+        ring.setup_buffers(0, 8, 64);
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+unsigned IoUring::flush_sq() {
+    unsigned pending = sqe_tail_ - sqe_submitted_;
+    if (pending > 0) {
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+        sqe_submitted_ = sqe_tail_;
+    }
+    return pending;
+}
+
+int IoUring::enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void* arg, size_t arg_size) {
+    int result = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, arg, arg_size));
+    return result < 0 ? -errno : result;
+}
+
+io_uring_sqe* IoUring::get_sqe() {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sqe_tail_ - head >= sq_entries_) {
+        // 提交队列已满：先提交，内核同步消费后即有空位
+        submit();
+        head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sqe_tail_ - head >= sq_entries_) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe* sqe = &sqes_[sqe_tail_ & sq_mask_];
+    ++sqe_tail_;
+    std::memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int IoUring::submit() {
+    unsigned pending = flush_sq();
+    if (pending == 0) {
+        return 0;
+    }
+    int result;
+    do {
+        result = enter(pending, 0, 0, nullptr, 0);
+    } while (result == -EINTR);
+    return result;
+}
+
+int IoUring::submit_and_wait(int timeout_ms) {
+    unsigned pending = flush_sq();
+
+    // 一次io_uring_enter既提交本轮积累的全部SQE，又等待完成事件
+    if (timeout_ms < 0) {
+        return enter(pending, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+    }
+
+    __kernel_timespec timeout{};
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+    io_uring_getevents_arg arg{};
+    arg.sigmask = 0;
+    arg.sigmask_sz = _NSIG / 8;
+    arg.ts = reinterpret_cast<uint64_t>(&timeout);
+    return enter(pending, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+void IoUring::setup_buffers(uint16_t group, unsigned count, unsigned size) {
+    if (count == 0 || (count & (count - 1)) != 0 || count > 32768) {
+        throw std::runtime_error("buffer ring大小必须是2的幂");
+    }
+
+    buffer_ring_size_ = count * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, buffer_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        throw std::runtime_error("无法分配buffer ring");
+    }
+    buffer_ring_ = static_cast<io_uring_buf_ring*>(ring);
+
+    buffer_storage_size_ = static_cast<size_t>(count) * size;
+    void* storage = mmap(nullptr, buffer_storage_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (storage == MAP_FAILED) {
+        munmap(buffer_ring_, buffer_ring_size_);
+        buffer_ring_ = nullptr;
+        throw std::runtime_error("无法分配接收缓冲区");
+    }
+    buffer_storage_ = static_cast<char*>(storage);
+    buffer_size_ = size;
+    buffer_mask_ = count - 1;
+    buffer_group_ = group;
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(buffer_ring_);
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (io_uring_register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        throw std::runtime_error("无法注册buffer ring: " + std::string(std::strerror(errno)));
+    }
+
+    buffer_ring_->tail = 0;
+    for (unsigned i = 0; i < count; ++i) {
+        recycle_buffer(static_cast<uint16_t>(i));
+    }
+}
+
+void IoUring::recycle_buffer(uint16_t id) {
+    // 头文件中的柔性数组成员bufs在C++下因空结构体占位而偏移了8字节，按io_uring_buf数组直接寻址
+    io_uring_buf* entries = reinterpret_cast<io_uring_buf*>(buffer_ring_);
+    unsigned short tail = buffer_ring_->tail;
+    io_uring_buf& entry = entries[tail & buffer_mask_];
+    entry.addr = reinterpret_cast<uint64_t>(buffer_storage_ + static_cast<size_t>(id) * buffer_size_);
+    entry.len = buffer_size_;
+    entry.bid = id;
+    __atomic_store_n(&buffer_ring_->tail, static_cast<unsigned short>(tail + 1), __ATOMIC_RELEASE);
+}
+
+} // namespace http
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <linux/io_uring.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace http {
+
+/**
+ * io_uring的最小封装（直接使用系统调用，不依赖liburing）
+ * 负责环的创建与映射、SQE获取、批量提交与等待、CQE遍历，以及provided buffer ring。
+ * 只能由一个线程使用。
+ */
+class IoUring {
+public:
+    // 创建提交队列容量为entries的环，完成队列容量为cq_entries；失败时抛出异常
+    IoUring(unsigned entries, unsigned cq_entries);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // 当前内核是否支持本服务器用到的全部特性（multishot accept/recv、buffer ring、带超时的等待）
+    static bool supported();
+
+    // 获取一个空闲SQE（已清零），队列满时先提交已有的SQE
+    io_uring_sqe* get_sqe();
+
+    // 提交所有待提交的SQE，不等待
+    int submit();
+
+    // 提交并等待至少一个完成事件，timeout_ms < 0 表示无限等待；返回负的errno表示失败（超时为-ETIME）
+    int submit_and_wait(int timeout_ms);
+
+    // 依次处理所有已到达的CQE；回调中可以继续获取SQE
+    template <typename Fn>
+    unsigned drain(Fn&& fn) {
+        unsigned count = 0;
+        unsigned head = *cq_head_;
+        while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+            io_uring_cqe cqe = cqes_[head & cq_mask_];
+            __atomic_store_n(cq_head_, ++head, __ATOMIC_RELEASE);
+            fn(cqe);
+            ++count;
+        }
+        return count;
+    }
+
+    // 注册provided buffer ring：count个（2的幂）大小为size的缓冲区，供recv按需选取
+    void setup_buffers(uint16_t group, unsigned count, unsigned size);
+    uint16_t buffer_group() const { return buffer_group_; }
+    const char* buffer(uint16_t id) const { return buffer_storage_ + static_cast<size_t>(id) * buffer_size_; }
+
+    // 将内核选用过的缓冲区归还给buffer ring
+    void recycle_buffer(uint16_t id);
+
+private:
+    int ring_fd_ = -1;
+    unsigned features_ = 0;
+
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sqe_tail_ = 0;       // 本地已填充的SQE尾部
+    unsigned sqe_submitted_ = 0;  // 已发布给内核的尾部
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    io_uring_buf_ring* buffer_ring_ = nullptr;
+    size_t buffer_ring_size_ = 0;
+    char* buffer_storage_ = nullptr;
+    size_t buffer_storage_size_ = 0;
+    unsigned buffer_size_ = 0;
+    unsigned buffer_mask_ = 0;
+    uint16_t buffer_group_ = 0;
+
+    unsigned flush_sq();
+    int enter(unsigned to_submit, unsigned min_complete, unsigned flags, const void* arg, size_t arg_size);
+    void release();
+};
+
+} // namespace http
@@ -0,0 +1,192 @@
+#include "listener_handoff.hpp"
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+extern char** environ;
+
+namespace http {
+
+namespace {
+
+// 单条SCM_RIGHTS消息最多携带的文件描述符数（内核的SCM_MAX_FD）
+constexpr size_t kMaxHandoffFds = 253;
+
+void send_listeners(int channel, const std::vector<int>& listeners) {
+    char payload = 'L';
+    iovec iov{&payload, 1};
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * listeners.size()));
+
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int) * listeners.size());
+    std::memcpy(CMSG_DATA(header), listeners.data(), sizeof(int) * listeners.size());
+
+    ssize_t sent;
+    do {
+        sent = sendmsg(channel, &message, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    if (sent != 1) {
+        throw std::runtime_error(std::string("无法发送监听socket: ") + std::strerror(errno));
+    }
+}
+
+// 终止未能就绪的新进程并回收
+void abort_child(pid_t child) {
+    kill(child, SIGKILL);
+    while (waitpid(child, nullptr, 0) < 0 && errno == EINTR) {
+    }
+}
+
+} // namespace
+
+InheritedListeners receive_listeners() {
+    InheritedListeners inherited;
+    const char* value = std::getenv(kHandoffEnv);
+    if (!value) {
+        return inherited;
+    }
+    inherited.channel = std::atoi(value);
+    // 不再传给本进程将来启动的子进程
+    unsetenv(kHandoffEnv);
+    fcntl(inherited.channel, F_SETFD, FD_CLOEXEC);
+
+    char payload = 0;
+    iovec iov{&payload, 1};
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * kMaxHandoffFds));
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+
+    ssize_t received;
+    do {
+        received = recvmsg(inherited.channel, &message, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+
+    for (cmsghdr* header = received > 0 ? CMSG_FIRSTHDR(&message) : nullptr; header;
+         header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+            size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            inherited.sockets.resize(count);
+            std::memcpy(inherited.sockets.data(), CMSG_DATA(header), sizeof(int) * count);
+        }
+    }
+    if (received != 1 || payload != 'L' || (message.msg_flags & MSG_CTRUNC) || inherited.sockets.empty()) {
+        for (int fd : inherited.sockets) {
+            close(fd);
+        }
+        close(inherited.channel);
+        throw std::runtime_error("未能从旧进程接收监听socket");
+    }
+    return inherited;
+}
+
+void notify_handoff_ready(InheritedListeners& inherited) {
+    if (inherited.channel < 0) {
+        return;
+    }
+    char ready = 'R';
+    while (write(inherited.channel, &ready, 1) < 0 && errno == EINTR) {
+    }
+    close(inherited.channel);
+    inherited.channel = -1;
+}
+
+pid_t spawn_with_listeners(const std::string& executable, const std::vector<std::string>& args,
+                           const std::vector<int>& listeners, std::chrono::milliseconds timeout) {
+    if (listeners.empty() || listeners.size() > kMaxHandoffFds) {
+        throw std::runtime_error("监听socket数量无法交接");
+    }
+
+    // 子进程一端在exec后保留，父进程一端不传给子进程
+    int channel[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, channel) < 0) {
+        throw std::runtime_error(std::string("无法创建交接通道: ") + std::strerror(errno));
+    }
+    fcntl(channel[0], F_SETFD, FD_CLOEXEC);
+
+    // fork之后的子进程只能调用异步信号安全的函数，参数和环境变量提前准备好
+    std::vector<std::string> env_strings;
+    size_t prefix = std::strlen(kHandoffEnv);
+    for (char** entry = environ; *entry; ++entry) {
+        if (std::strncmp(*entry, kHandoffEnv, prefix) != 0 || (*entry)[prefix] != '=') {
+            env_strings.emplace_back(*entry);
+        }
+    }
+    env_strings.push_back(std::string(kHandoffEnv) + "=" + std::to_string(channel[1]));
+    std::vector<char*> envp;
+    for (auto& entry : env_strings) {
+        envp.push_back(entry.data());
+    }
+    envp.push_back(nullptr);
+    std::vector<std::string> arg_strings = args.empty() ? std::vector<std::string>{executable} : args;
+    std::vector<char*> argv;
+    for (auto& arg : arg_strings) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    pid_t child = fork();
+    if (child < 0) {
+        int error = errno;
+        close(channel[0]);
+        close(channel[1]);
+        throw std::runtime_error(std::string("无法启动新进程: ") + std::strerror(error));
+    }
+    if (child == 0) {
+        // 恢复默认的信号处理和信号掩码，新进程自行设置
+        sigset_t empty;
+        sigemptyset(&empty);
+        sigprocmask(SIG_SETMASK, &empty, nullptr);
+        signal(SIGPIPE, SIG_DFL);
+        fcntl(channel[1], F_SETFD, 0);
+        execve(executable.c_str(), argv.data(), envp.data());
+        _exit(127);
+    }
+    close(channel[1]);
+
+    // 消息留在socket缓冲区中，新进程初始化时读取
+    try {
+        send_listeners(channel[0], listeners);
+    } catch (...) {
+        close(channel[0]);
+        abort_child(child);
+        throw;
+    }
+
+    // 等待新进程回复就绪；新进程退出时通道读到EOF
+    pollfd ready{channel[0], POLLIN, 0};
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    int result;
+    do {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        result = poll(&ready, 1, static_cast<int>(std::max<int64_t>(remaining.count(), 0)));
+    } while (result < 0 && errno == EINTR);
+
+    char reply = 0;
+    bool started = result == 1 && read(channel[0], &reply, 1) == 1 && reply == 'R';
+    close(channel[0]);
+    if (!started) {
+        abort_child(child);
+        throw std::runtime_error(result == 0 ? "新进程未在限定时间内就绪" : "新进程启动失败");
+    }
+    return child;
+}
+
+} // namespace http
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <sys/types.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace http {
+
+// 热升级启动的新进程从该环境变量得知交接通道的文件描述符
+constexpr const char* kHandoffEnv = "HTTP_SERVER_HANDOFF_FD";
+
+/**
+ * 监听socket交接（热升级）
+ * 旧进程启动新的可执行文件，经由一对Unix socket以SCM_RIGHTS把监听socket传给它；
+ * 新进程在同一组socket上开始接受连接后回复一个字节，旧进程收到后才停止接受并排空。
+ * 两个进程共享同一个内核监听socket，交接期间到达的连接留在accept队列中，不会被拒绝。
+ */
+struct InheritedListeners {
+    std::vector<int> sockets;   // 所有权交给调用者，通常放入ServerConfig::inherited_listeners
+    int channel = -1;           // 交接通道，开始接受连接后由notify_handoff_ready回复旧进程
+};
+
+// 新进程：由热升级启动时从交接通道接收监听socket，否则返回空；接收失败时抛出异常
+InheritedListeners receive_listeners();
+
+// 新进程：通知旧进程已经开始接受连接，并关闭交接通道
+void notify_handoff_ready(InheritedListeners& inherited);
+
+// 旧进程：以args启动executable并交出监听socket，新进程在timeout内就绪时返回其pid；
+// 新进程退出或超时则终止它并抛出异常，旧进程继续服务
+pid_t spawn_with_listeners(const std::string& executable, const std::vector<std::string>& args,
+                           const std::vector<int>& listeners, std::chrono::milliseconds timeout);
+
+} // namespace http
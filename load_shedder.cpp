@@ -0,0 +1,62 @@
+#include "load_shedder.hpp"
+#include <limits>
+
+namespace http {
+
+namespace {
+
+int64_t to_ns(LoadShedder::Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+} // namespace
+
+LoadShedder::LoadShedder(std::chrono::nanoseconds target, std::chrono::nanoseconds interval)
+    : target_(target.count()), interval_(interval.count() > target.count() ? interval.count() : target.count()),
+      window_min_(std::numeric_limits<int64_t>::max()) {
+}
+
+bool LoadShedder::overloaded(Clock::time_point now) const {
+    // 判定结果只对紧接着的一个窗口有效，队列空闲后不再沿用
+    return overloaded_.load(std::memory_order_relaxed) &&
+           to_ns(now) < window_end_.load(std::memory_order_relaxed) + interval_;
+}
+
+bool LoadShedder::should_reject(size_t queued, Clock::time_point now) {
+    // 最近出队的请求等待的时间近似于新请求将要等待的时间，超过出队时的上限就不必入队了；
+    // 队列已经排空时该样本已过时，总是放行
+    int64_t limit = overloaded(now) ? target_ : interval_;
+    if (queued == 0 || last_delay_.load(std::memory_order_relaxed) <= limit) {
+        return false;
+    }
+    window_shed_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool LoadShedder::should_drop(std::chrono::nanoseconds delay, Clock::time_point now) {
+    int64_t sample = delay.count();
+    int64_t time = to_ns(now);
+    last_delay_.store(sample, std::memory_order_relaxed);
+
+    int64_t current = window_min_.load(std::memory_order_relaxed);
+    while (sample < current && !window_min_.compare_exchange_weak(current, sample, std::memory_order_relaxed)) {
+    }
+
+    // 窗口结束后由第一个到达的样本负责结算，其余线程沿用上一次的结果
+    int64_t end = window_end_.load(std::memory_order_relaxed);
+    if (time >= end && window_end_.compare_exchange_strong(end, time + interval_, std::memory_order_relaxed)) {
+        int64_t minimum = window_min_.exchange(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+        uint64_t shed = window_shed_.exchange(0, std::memory_order_relaxed);
+        bool overloaded = minimum > target_ || (overloaded_.load(std::memory_order_relaxed) && shed > 0);
+        // 上一个窗口结束一个interval之后才有样本时，结算的不是连续的窗口，不据此判定过载
+        overloaded_.store(time < end + interval_ && overloaded, std::memory_order_relaxed);
+    }
+
+    if (sample <= (overloaded_.load(std::memory_order_relaxed) ? target_ : interval_)) {
+        return false;
+    }
+    window_shed_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace http
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace http {
+
+/**
+ * 基于排队延迟的自适应过载控制（CoDel思路）
+ * 信号是请求从解析完成到处理器开始执行之间的等待时间，而不是队列长度。
+ * 突发积压会很快排空，窗口内总有请求几乎不用等待；只有一个完整的interval内
+ * 最小等待时间仍高于target（队列中存在消不掉的积压）时才判定为过载。
+ * 过载期间拒绝请求会让延迟降下来，因此只要窗口内还有被拒绝的请求就维持过载，
+ * 直到一个窗口既没有积压也不需要拒绝才恢复，避免在两种状态间来回振荡。
+ * 排队时间的上限在过载期间为target，否则为interval（允许突发积压但不让它无限增长）：
+ *   - 最近出队的请求等待超过上限时，新请求在入队前直接拒绝；
+ *   - 已在队列中等待超过上限的请求出队时不再执行处理器，同样拒绝。
+ * 所有方法线程安全且无锁。
+ */
+class LoadShedder {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    LoadShedder(std::chrono::nanoseconds target, std::chrono::nanoseconds interval);
+
+    // 入队前调用（I/O线程）：queued为当前排队的任务数，返回是否直接拒绝
+    bool should_reject(size_t queued, Clock::time_point now);
+
+    // 出队后、执行处理器前调用（工作线程）：记录等待时间，返回是否丢弃该请求
+    bool should_drop(std::chrono::nanoseconds delay, Clock::time_point now);
+
+    // 当前是否处于过载状态；超过一个interval没有出队样本时视为已恢复
+    bool overloaded(Clock::time_point now) const;
+
+private:
+    const int64_t target_;
+    const int64_t interval_;
+
+    std::atomic<int64_t> window_end_{0};     // 当前观察窗口的结束时刻
+    std::atomic<int64_t> window_min_;        // 当前窗口内的最小等待时间
+    std::atomic<bool> overloaded_{false};    // 上一个窗口的判定结果
+    std::atomic<int64_t> last_delay_{0};     // 最近一次出队的等待时间
+    std::atomic<uint64_t> window_shed_{0};   // 当前窗口内拒绝和丢弃的请求数
+};
+
+} // namespace http
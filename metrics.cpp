@@ -0,0 +1,302 @@
+#include "metrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace http {
+
+namespace {
+
+// 导出给Prometheus的桶边界（纳秒），由细粒度桶累加得到
+constexpr uint64_t kExportBounds[] = {
+    1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000, 250000000, 500000000,
+    1000000000, 2500000000, 5000000000, 10000000000,
+};
+
+constexpr double kExportQuantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+const char* const kStageNames[] = {"parse", "handle", "send"};
+
+void append_escaped(std::string& out, std::string_view value) {
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (c == '\n') {
+            out.append("\\n");
+        } else {
+            out.push_back(c);
+        }
+    }
+}
+
+void append_number(std::string& out, uint64_t value) {
+    out.append(std::to_string(value));
+}
+
+void append_seconds(std::string& out, uint64_t nanoseconds) {
+    char buffer[32];
+    int length = std::snprintf(buffer, sizeof(buffer), "%.9g", static_cast<double>(nanoseconds) / 1e9);
+    out.append(buffer, length);
+}
+
+void append_header(std::string& out, const char* name, const char* type, const char* help) {
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+}
+
+} // namespace
+
+void HistogramSnapshot::add(const Histogram& histogram) {
+    for (size_t i = 0; i < Histogram::kBucketCount; ++i) {
+        uint64_t value = histogram.buckets[i].load(std::memory_order_relaxed);
+        buckets[i] += value;
+        count += value;
+    }
+    sum += histogram.sum.load(std::memory_order_relaxed);
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& other) {
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    sum += other.sum;
+    count += other.count;
+}
+
+void HistogramSnapshot::record(uint64_t value) {
+    ++buckets[Histogram::bucket_index(value)];
+    sum += value;
+    ++count;
+}
+
+uint64_t HistogramSnapshot::quantile(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(count)));
+    rank = std::max<uint64_t>(rank, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return Histogram::bucket_upper(i);
+        }
+    }
+    return Histogram::bucket_upper(buckets.size() - 1);
+}
+
+Metrics::Metrics() {
+    routes_.push_back(RouteLabel{"", "unmatched"});
+}
+
+Metrics::~Metrics() = default;
+
+uint32_t Metrics::add_route(std::string_view method, std::string_view pattern) {
+    routes_.push_back(RouteLabel{std::string(method), std::string(pattern)});
+    return static_cast<uint32_t>(routes_.size() - 1);
+}
+
+void Metrics::prepare(size_t shards) {
+    // 代数全局唯一，旧实例或上一次prepare()留在线程中的缓存都会失效
+    static std::atomic<uint64_t> next_generation{1};
+
+    shard_count_ = std::max<size_t>(shards, 1);
+    route_count_ = routes_.size();
+    shards_ = std::make_unique<Shard[]>(shard_count_);
+    for (size_t i = 0; i < shard_count_; ++i) {
+        shards_[i].routes = std::make_unique<RouteStats[]>(route_count_);
+    }
+    next_shard_.store(0);
+    generation_ = next_generation.fetch_add(1);
+}
+
+void Metrics::claim_shard(ThreadShard& local) {
+    local.generation = generation_;
+    local.shard = nullptr;
+    if (!shards_) {
+        return;
+    }
+    size_t index = next_shard_.fetch_add(1, std::memory_order_relaxed);
+    local.exclusive = index + 1 < shard_count_;
+    local.shard = &shards_[local.exclusive ? index : shard_count_ - 1];
+}
+
+HistogramSnapshot Metrics::snapshot(uint32_t route, Stage stage) const {
+    HistogramSnapshot result;
+    if (route >= route_count_) {
+        return result;
+    }
+    for (size_t i = 0; i < shard_count_; ++i) {
+        result.add(shards_[i].routes[route].stages[static_cast<size_t>(stage)]);
+    }
+    return result;
+}
+
+std::string Metrics::render_prometheus() const {
+    std::string out;
+    out.reserve(4096);
+
+    uint64_t counters[kCounterCount] = {};
+    for (size_t i = 0; i < shard_count_; ++i) {
+        for (size_t c = 0; c < kCounterCount; ++c) {
+            counters[c] += shards_[i].counters[c].load(std::memory_order_relaxed);
+        }
+    }
+    uint64_t accepted = counters[static_cast<size_t>(Counter::ConnectionsAccepted)];
+    uint64_t closed = counters[static_cast<size_t>(Counter::ConnectionsClosed)];
+
+    append_header(out, "http_connections_accepted_total", "counter", "Accepted client connections.");
+    out.append("http_connections_accepted_total ");
+    append_number(out, accepted);
+    out.append("\n");
+    append_header(out, "http_connections_active", "gauge", "Currently open client connections.");
+    out.append("http_connections_active ");
+    append_number(out, accepted >= closed ? accepted - closed : 0);
+    out.append("\n");
+    append_header(out, "http_requests_rejected_total", "counter", "Requests rejected with 503 because the worker queue was full.");
+    out.append("http_requests_rejected_total ");
+    append_number(out, counters[static_cast<size_t>(Counter::RequestsRejected)]);
+    out.append("\n");
+    append_header(out, "http_requests_shed_total", "counter", "Requests answered with 503 by the queueing-delay load shedder, by stage.");
+    out.append("http_requests_shed_total{stage=\"admission\"} ");
+    append_number(out, counters[static_cast<size_t>(Counter::RequestsShed)]);
+    out.append("\nhttp_requests_shed_total{stage=\"queue\"} ");
+    append_number(out, counters[static_cast<size_t>(Counter::RequestsDropped)]);
+    out.append("\n");
+    append_header(out, "http_response_cache_lookups_total", "counter", "Response cache lookups, by result.");
+    const std::pair<const char*, Counter> lookups[] = {
+        {"hit", Counter::CacheHits},
+        {"miss", Counter::CacheMisses},
+        {"collapsed", Counter::CacheCollapsed},
+    };
+    for (const auto& [result, counter] : lookups) {
+        out.append("http_response_cache_lookups_total{result=\"").append(result).append("\"} ");
+        append_number(out, counters[static_cast<size_t>(counter)]);
+        out.append("\n");
+    }
+    append_header(out, "http_response_cache_evictions_total", "counter", "Response cache entries evicted to stay within the memory budget.");
+    out.append("http_response_cache_evictions_total ");
+    append_number(out, counters[static_cast<size_t>(Counter::CacheEvictions)]);
+    out.append("\n");
+    append_header(out, "http_access_log_dropped_total", "counter", "Access log records dropped because the per-thread buffer was full.");
+    out.append("http_access_log_dropped_total ");
+    append_number(out, counters[static_cast<size_t>(Counter::AccessLogDropped)]);
+    out.append("\n");
+    append_header(out, "http_connection_timeouts_total", "counter", "Connections closed by a timeout, by phase.");
+    const std::pair<const char*, Counter> timeouts[] = {
+        {"idle", Counter::IdleTimeouts},
+        {"header", Counter::HeaderTimeouts},
+        {"body", Counter::BodyTimeouts},
+        {"send", Counter::SendTimeouts},
+    };
+    for (const auto& [phase, counter] : timeouts) {
+        out.append("http_connection_timeouts_total{phase=\"").append(phase).append("\"} ");
+        append_number(out, counters[static_cast<size_t>(counter)]);
+        out.append("\n");
+    }
+
+    auto append_labels = [&out, this](size_t route) {
+        out.append("method=\"");
+        append_escaped(out, routes_[route].method);
+        out.append("\",route=\"");
+        append_escaped(out, routes_[route].pattern);
+        out.append("\"");
+    };
+
+    append_header(out, "http_responses_total", "counter", "Responses by route and status class.");
+    for (size_t route = 0; route < route_count_; ++route) {
+        uint64_t responses[6] = {};
+        for (size_t i = 0; i < shard_count_; ++i) {
+            for (size_t s = 0; s < 6; ++s) {
+                responses[s] += shards_[i].routes[route].responses[s].load(std::memory_order_relaxed);
+            }
+        }
+        for (size_t s = 1; s < 6; ++s) {
+            if (responses[s] == 0) {
+                continue;
+            }
+            out.append("http_responses_total{");
+            append_labels(route);
+            out.append(",code=\"");
+            append_number(out, s);
+            out.append("xx\"} ");
+            append_number(out, responses[s]);
+            out.append("\n");
+        }
+    }
+
+    // 合并后的快照只计算一次，直方图和分位数共用
+    std::vector<HistogramSnapshot> snapshots;
+    snapshots.reserve(route_count_ * kStageCount);
+    for (size_t route = 0; route < route_count_; ++route) {
+        for (size_t stage = 0; stage < kStageCount; ++stage) {
+            snapshots.push_back(snapshot(static_cast<uint32_t>(route), static_cast<Stage>(stage)));
+        }
+    }
+
+    append_header(out, "http_stage_duration_seconds", "histogram", "Latency of request stages by route.");
+    for (size_t route = 0; route < route_count_; ++route) {
+        for (size_t stage = 0; stage < kStageCount; ++stage) {
+            const HistogramSnapshot& snap = snapshots[route * kStageCount + stage];
+            if (snap.count == 0) {
+                continue;
+            }
+            auto append_series = [&](const char* suffix) {
+                out.append("http_stage_duration_seconds").append(suffix).append("{");
+                append_labels(route);
+                out.append(",stage=\"").append(kStageNames[stage]).append("\"");
+            };
+
+            uint64_t cumulative = 0;
+            size_t bucket = 0;
+            for (uint64_t bound : kExportBounds) {
+                while (bucket < snap.buckets.size() && Histogram::bucket_upper(bucket) <= bound) {
+                    cumulative += snap.buckets[bucket++];
+                }
+                append_series("_bucket");
+                out.append(",le=\"");
+                append_seconds(out, bound);
+                out.append("\"} ");
+                append_number(out, cumulative);
+                out.append("\n");
+            }
+            append_series("_bucket");
+            out.append(",le=\"+Inf\"} ");
+            append_number(out, snap.count);
+            out.append("\n");
+            append_series("_sum");
+            out.append("} ");
+            append_seconds(out, snap.sum);
+            out.append("\n");
+            append_series("_count");
+            out.append("} ");
+            append_number(out, snap.count);
+            out.append("\n");
+        }
+    }
+
+    append_header(out, "http_stage_duration_quantile_seconds", "gauge",
+                  "Latency quantiles of request stages computed from the HDR histograms.");
+    for (size_t route = 0; route < route_count_; ++route) {
+        for (size_t stage = 0; stage < kStageCount; ++stage) {
+            const HistogramSnapshot& snap = snapshots[route * kStageCount + stage];
+            if (snap.count == 0) {
+                continue;
+            }
+            for (double q : kExportQuantiles) {
+                char quantile[16];
+                std::snprintf(quantile, sizeof(quantile), "%g", q);
+                out.append("http_stage_duration_quantile_seconds{");
+                append_labels(route);
+                out.append(",stage=\"").append(kStageNames[stage]).append("\",quantile=\"").append(quantile).append("\"} ");
+                append_seconds(out, snap.quantile(q));
+                out.append("\n");
+            }
+        }
+    }
+    return out;
+}
+
+} // namespace http
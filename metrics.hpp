@@ -0,0 +1,205 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace http {
+
+// 单写者的计数器用relaxed读写代替原子加，省去总线锁；多个线程共享时退回fetch_add
+inline void add_counter(std::atomic<uint64_t>& counter, uint64_t value, bool exclusive) {
+    if (exclusive) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    } else {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * HDR风格的对数-线性延迟直方图（纳秒）
+ * 每个2的幂区间再等分为16个子桶，相对误差不超过1/16，覆盖1ns到约68s。
+ * 记录只需一次前导零计数和两次计数器累加，不加锁。
+ */
+struct Histogram {
+    static constexpr int kSubBucketBits = 4;
+    static constexpr uint64_t kSubBuckets = 1ull << kSubBucketBits;
+    static constexpr int kMaxExponent = 36;
+    static constexpr size_t kBucketCount = (kMaxExponent - kSubBucketBits + 1) * kSubBuckets + kSubBuckets;
+
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets{};
+    std::atomic<uint64_t> sum{0};
+
+    static size_t bucket_index(uint64_t value) {
+        if (value < kSubBuckets) {
+            return static_cast<size_t>(value);
+        }
+        int exponent = 63 - __builtin_clzll(value);
+        if (exponent > kMaxExponent) {
+            return kBucketCount - 1;
+        }
+        int shift = exponent - kSubBucketBits;
+        return static_cast<size_t>(shift + 1) * kSubBuckets + ((value >> shift) & (kSubBuckets - 1));
+    }
+
+    // 桶内的最大值（含），用于分位数和Prometheus的le边界
+    static uint64_t bucket_upper(size_t index) {
+        if (index < kSubBuckets) {
+            return index;
+        }
+        int shift = static_cast<int>(index / kSubBuckets) - 1;
+        uint64_t sub = index % kSubBuckets;
+        return ((kSubBuckets + sub + 1) << shift) - 1;
+    }
+
+    void record(uint64_t value, bool exclusive) {
+        add_counter(buckets[bucket_index(value)], 1, exclusive);
+        add_counter(sum, value, exclusive);
+    }
+};
+
+// 直方图的非原子快照，可合并多个分片后计算分位数
+struct HistogramSnapshot {
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(Histogram::kBucketCount);
+    uint64_t sum = 0;
+    uint64_t count = 0;
+
+    void add(const Histogram& histogram);
+    void merge(const HistogramSnapshot& other);
+    void record(uint64_t value);
+
+    // 分位数q（0~1）对应的值（所在桶的上界），没有样本时返回0
+    uint64_t quantile(double q) const;
+};
+
+/**
+ * 服务器指标
+ * 每个线程在首次记录时独占一个分片，分片内的计数器和直方图按缓存行对齐，
+ * 记录路径只有relaxed读写，没有锁也没有原子读改写；
+ * 分片用完后其余线程共用最后一个分片，改用原子加。
+ * 导出时把所有分片合并成Prometheus文本格式。
+ * 路由必须在prepare()之前通过add_route()登记，编号0保留给未匹配的请求。
+ */
+class Metrics {
+public:
+    enum class Stage {
+        Parse,     // 请求头解析与路由查找
+        Handle,    // 执行处理器（静态路由为选择预生成报文）
+        Send,      // 从开始发送响应到全部写入socket
+    };
+    static constexpr size_t kStageCount = 3;
+
+    enum class Counter {
+        ConnectionsAccepted,
+        ConnectionsClosed,
+        RequestsRejected,   // 线程池排队已满返回503
+        RequestsShed,       // 过载时在入队前拒绝
+        RequestsDropped,    // 过载时排队过久，出队后不再执行处理器
+        CacheHits,          // 响应缓存命中
+        CacheMisses,        // 响应缓存未命中，由本请求执行处理器填充
+        CacheCollapsed,     // 未命中但已有请求在填充，等待其结果
+        CacheEvictions,     // 因超出内存预算而淘汰的缓存项
+        AccessLogDropped,   // 访问日志缓冲区已满而丢弃的记录
+        IdleTimeouts,       // 以下为各阶段超时而关闭的连接：keep-alive空闲
+        HeaderTimeouts,     // 接收请求头超时
+        BodyTimeouts,       // 接收请求体超时
+        SendTimeouts,       // 发送响应超时
+    };
+    static constexpr size_t kCounterCount = 14;
+
+    Metrics();
+    ~Metrics();
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    // 登记路由，返回其指标编号
+    uint32_t add_route(std::string_view method, std::string_view pattern);
+
+    // 按分片数分配存储（最后一个分片为共享分片），之后登记的路由计入编号0
+    void prepare(size_t shards);
+
+    void record(uint32_t route, Stage stage, uint64_t nanoseconds) {
+        const ThreadShard& local = current_shard();
+        if (local.shard) {
+            local.shard->routes[route < route_count_ ? route : 0].stages[static_cast<size_t>(stage)].record(
+                nanoseconds, local.exclusive);
+        }
+    }
+
+    void count_response(uint32_t route, int status_code) {
+        const ThreadShard& local = current_shard();
+        if (local.shard) {
+            size_t status_class = status_code >= 100 && status_code < 600 ? status_code / 100 : 0;
+            add_counter(local.shard->routes[route < route_count_ ? route : 0].responses[status_class], 1, local.exclusive);
+        }
+    }
+
+    void increment(Counter counter, uint64_t value = 1) {
+        const ThreadShard& local = current_shard();
+        if (local.shard) {
+            add_counter(local.shard->counters[static_cast<size_t>(counter)], value, local.exclusive);
+        }
+    }
+
+    // 合并所有分片，生成Prometheus文本格式（text/plain; version=0.0.4）
+    std::string render_prometheus() const;
+
+    // 合并所有分片中某个路由某阶段的直方图
+    HistogramSnapshot snapshot(uint32_t route, Stage stage) const;
+
+    size_t route_count() const { return routes_.size(); }
+
+private:
+    struct alignas(64) RouteStats {
+        Histogram stages[kStageCount];
+        std::atomic<uint64_t> responses[6]{};   // 下标为状态码/100，0表示非法状态码
+    };
+
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> counters[kCounterCount]{};
+        std::unique_ptr<RouteStats[]> routes;
+    };
+
+    struct RouteLabel {
+        std::string method;
+        std::string pattern;
+    };
+
+    // 线程缓存的分片归属，generation标识分配它的prepare()调用
+    struct ThreadShard {
+        uint64_t generation = 0;
+        Shard* shard = nullptr;
+        bool exclusive = false;
+    };
+
+    std::vector<RouteLabel> routes_;
+    std::unique_ptr<Shard[]> shards_;
+    size_t shard_count_ = 0;
+    size_t route_count_ = 0;
+    uint64_t generation_ = 0;
+    std::atomic<size_t> next_shard_{0};
+
+    const ThreadShard& current_shard() {
+        thread_local ThreadShard local;
+        if (local.generation != generation_) {
+            claim_shard(local);
+        }
+        return local;
+    }
+
+    void claim_shard(ThreadShard& local);
+};
+
+// 计时辅助：返回从start到现在的纳秒数
+inline uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+} // namespace http
@@ -0,0 +1,12 @@
+#include "middleware.hpp"
+
+namespace http {
+
+Response NextHandler::operator()(const Request& request) const {
+    if (index_ < stack_->middlewares_.size()) {
+        return stack_->middlewares_[index_](request, NextHandler(stack_, index_ + 1, target_, invoke_));
+    }
+    return invoke_(target_, request);
+}
+
+} // namespace http
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "http_server.hpp"
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace http {
+
+/**
+ * 中间件
+ * 中间件是可调用对象 Response(const Request&, const NextT& next)：调用next(request)把请求交给
+ * 链中的下一环（最后一环是处理器），可以在前后修改响应，也可以不调用next直接返回响应。
+ * 把next写成模板参数（或auto参数）的中间件可同时用于编译期链和运行时链。
+ *
+ *   auto chain = http::make_middleware(http::Cors{}, http::SetHeader{"X-Frame-Options", "DENY"});
+ *   server.register_handler("GET", "/api", chain.wrap(handler));   // 单个路由，链内联为一次调用
+ *   server.use(chain);                                              // 全局，作用于所有路由（见HttpServer::use）
+ */
+
+/**
+ * 运行时中间件链中的下一环
+ * 只引用链和最终的处理器，不拥有任何对象也不分配内存，仅在中间件调用期间有效。
+ */
+class NextHandler {
+public:
+    Response operator()(const Request& request) const;
+
+private:
+    friend class MiddlewareStack;
+    using Invoke = Response (*)(const void* target, const Request& request);
+
+    NextHandler(const MiddlewareStack* stack, size_t index, const void* target, Invoke invoke)
+        : stack_(stack), index_(index), target_(target), invoke_(invoke) {}
+
+    const MiddlewareStack* stack_;
+    size_t index_;
+    const void* target_;
+    Invoke invoke_;
+};
+
+/**
+ * 运行时组合的中间件链
+ * 每个中间件是一个std::function，可以在运行时按配置增减；每经过一环多一次间接调用，
+ * 但请求路径上不分配内存。所有add()必须在开始处理请求之前完成。
+ */
+class MiddlewareStack {
+public:
+    void add(Middleware middleware) { middlewares_.push_back(std::move(middleware)); }
+
+    bool empty() const { return middlewares_.empty(); }
+    size_t size() const { return middlewares_.size(); }
+
+    // 依次经过各中间件后调用handler
+    template <typename Handler>
+    Response run(const Request& request, const Handler& handler) const {
+        NextHandler::Invoke invoke = [](const void* target, const Request& next_request) {
+            return (*static_cast<const Handler*>(target))(next_request);
+        };
+        return NextHandler(this, 0, &handler, invoke)(request);
+    }
+
+    // 包装成普通处理器，链在包装时复制
+    RequestHandler wrap(RequestHandler handler) const {
+        return [stack = *this, handler = std::move(handler)](const Request& request) {
+            return stack.run(request, handler);
+        };
+    }
+
+private:
+    friend class NextHandler;
+    std::vector<Middleware> middlewares_;
+};
+
+/**
+ * 编译期组合的中间件链
+ * 中间件类型作为模板参数保存在tuple中，每一环的next是捕获引用的lambda，
+ * 整条链在编译期展开，优化后内联为对处理器的一次调用，没有std::function也不分配内存。
+ * 链本身也满足中间件的接口，可以嵌套或通过HttpServer::use()全局使用。
+ */
+template <typename... Middlewares>
+class MiddlewareChain {
+public:
+    explicit MiddlewareChain(Middlewares... middlewares) : middlewares_(std::move(middlewares)...) {}
+
+    // 依次经过各中间件后调用handler（任何Response(const Request&)可调用对象，包括NextHandler）
+    template <typename Handler>
+    Response operator()(const Request& request, const Handler& handler) const {
+        return invoke<0>(request, handler);
+    }
+
+    // 包装成单个可调用对象，可直接注册为处理器
+    template <typename Handler>
+    auto wrap(Handler handler) const {
+        return [chain = *this, handler = std::move(handler)](const Request& request) -> Response {
+            return chain(request, handler);
+        };
+    }
+
+private:
+    std::tuple<Middlewares...> middlewares_;
+
+    template <size_t Index, typename Handler>
+    Response invoke(const Request& request, const Handler& handler) const {
+        if constexpr (Index == sizeof...(Middlewares)) {
+            return handler(request);
+        } else {
+            return std::get<Index>(middlewares_)(request, [this, &handler](const Request& next_request) {
+                return invoke<Index + 1>(next_request, handler);
+            });
+        }
+    }
+};
+
+template <typename... Middlewares>
+MiddlewareChain<std::decay_t<Middlewares>...> make_middleware(Middlewares&&... middlewares) {
+    return MiddlewareChain<std::decay_t<Middlewares>...>(std::forward<Middlewares>(middlewares)...);
+}
+
+/**
+ * 为响应补充固定的头部，处理器已设置时不覆盖
+ */
+struct SetHeader {
+    std::string name;
+    std::string value;
+
+    template <typename Next>
+    Response operator()(const Request& request, const Next& next) const {
+        Response response = next(request);
+        if (!response.headers.contains(name)) {
+            response.headers.add(name, value);
+        }
+        return response;
+    }
+};
+
+/**
+ * 跨域资源共享
+ * 预检请求（带Access-Control-Request-Method的OPTIONS）直接以204应答，不需要为其注册路由；
+ * 其余响应加上Access-Control-Allow-Origin，允许的来源不是"*"时同时声明Vary: Origin。
+ */
+struct Cors {
+    std::string allow_origin = "*";
+    std::string allow_methods = "GET, POST, OPTIONS";
+    std::string allow_headers = "Content-Type, Authorization";
+    std::chrono::seconds max_age{600};
+
+    template <typename Next>
+    Response operator()(const Request& request, const Next& next) const {
+        if (request.method == "OPTIONS" && request.headers.contains("Access-Control-Request-Method")) {
+            Response response;
+            response.status_code = 204;
+            response.status_text = "No Content";
+            add_origin(response);
+            response.headers.add("Access-Control-Allow-Methods", allow_methods);
+            response.headers.add("Access-Control-Allow-Headers", allow_headers);
+            response.headers.add("Access-Control-Max-Age", std::to_string(max_age.count()));
+            return response;
+        }
+        Response response = next(request);
+        if (!response.headers.contains("Access-Control-Allow-Origin")) {
+            add_origin(response);
+        }
+        return response;
+    }
+
+private:
+    void add_origin(Response& response) const {
+        response.headers.add("Access-Control-Allow-Origin", allow_origin);
+        if (allow_origin != "*") {
+            std::pmr::string& vary = response.headers[HeaderId::Vary];
+            vary.append(vary.empty() ? "Origin" : ", Origin");
+        }
+    }
+};
+
+} // namespace http
@@ -0,0 +1,335 @@
+#include "request_parser.hpp"
+#include "http_server.hpp"
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace http {
+
+namespace {
+
+// 在[begin, end)中查找字符c，未找到返回end；SSE2下每次比较16字节
+const char* find_char(const char* begin, const char* end, char c) {
+    const char* p = begin;
+#if defined(__SSE2__)
+    const __m128i needle = _mm_set1_epi8(c);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p == c) {
+            return p;
+        }
+    }
+    return end;
+}
+
+inline char to_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t';
+}
+
+// 头部名称只允许RFC 7230定义的token字符
+struct TokenTable {
+    bool allowed[256] = {};
+    TokenTable() {
+        const char* specials = "\"(),/:;<=>?@[\\]{}";
+        for (int c = 0x21; c < 0x7f; ++c) {
+            allowed[c] = std::strchr(specials, c) == nullptr;
+        }
+    }
+};
+
+const TokenTable kTokenTable;
+
+inline bool is_token_char(char c) {
+    return kTokenTable.allowed[static_cast<unsigned char>(c)];
+}
+
+} // namespace
+
+bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (to_lower(a[i]) != to_lower(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view trim_whitespace(std::string_view value) {
+    while (!value.empty() && is_space(value.front())) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && is_space(value.back())) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+RequestParser::RequestParser() : RequestParser(Limits()) {
+}
+
+RequestParser::RequestParser(const Limits& limits) : limits_(limits) {
+    headers_.reserve(limits_.max_header_count);
+}
+
+void RequestParser::reset() {
+    state_ = State::RequestLine;
+    base_ = nullptr;
+    position_ = 0;
+    header_length_ = 0;
+    content_length_ = 0;
+    has_content_length_ = false;
+    has_transfer_encoding_ = false;
+    chunked_ = false;
+    error_status_ = 0;
+    method_ = target_ = path_ = query_ = version_ = Span();
+    headers_.clear();
+}
+
+RequestParser::Status RequestParser::fail(int status) {
+    state_ = State::Error;
+    error_status_ = status;
+    return Status::Error;
+}
+
+RequestParser::Status RequestParser::parse(std::string_view buffer) {
+    base_ = buffer.data();
+
+    if (state_ == State::Done) {
+        return Status::Complete;
+    }
+    if (state_ == State::Error) {
+        return Status::Error;
+    }
+
+    const char* data = buffer.data();
+    const size_t size = buffer.size();
+
+    while (position_ < size) {
+        const char* newline = find_char(data + position_, data + size, '\n');
+        if (newline == data + size) {
+            break;
+        }
+
+        size_t line_begin = position_;
+        size_t line_end = newline - data;
+        position_ = line_end + 1;
+
+        if (position_ > limits_.max_header_bytes) {
+            return fail(431);
+        }
+
+        // 兼容只有LF的行尾
+        if (line_end > line_begin && data[line_end - 1] == '\r') {
+            --line_end;
+        }
+
+        if (state_ == State::RequestLine) {
+            // 请求行之前的空行按RFC 7230忽略
+            if (line_end == line_begin) {
+                continue;
+            }
+            if (!parse_request_line(line_begin, line_end)) {
+                return fail(400);
+            }
+            state_ = State::Headers;
+            continue;
+        }
+
+        if (line_end == line_begin) {
+            // 同时出现两种长度声明可能导致请求走私，直接拒绝
+            if (has_transfer_encoding_ && has_content_length_) {
+                return fail(400);
+            }
+            if (has_transfer_encoding_ && !chunked_) {
+                return fail(501);
+            }
+            state_ = State::Done;
+            header_length_ = position_;
+            return Status::Complete;
+        }
+
+        if (headers_.size() >= limits_.max_header_count) {
+            return fail(431);
+        }
+        if (!parse_header_line(line_begin, line_end)) {
+            return fail(400);
+        }
+    }
+
+    if (size > limits_.max_header_bytes) {
+        return fail(431);
+    }
+    return Status::Incomplete;
+}
+
+bool RequestParser::parse_request_line(size_t begin, size_t end) {
+    const char* data = base_;
+    const char* line_end = data + end;
+
+    const char* method_end = find_char(data + begin, line_end, ' ');
+    if (method_end == line_end || method_end == data + begin) {
+        return false;
+    }
+
+    const char* target_begin = method_end + 1;
+    const char* target_end = find_char(target_begin, line_end, ' ');
+    if (target_end == line_end || target_end == target_begin) {
+        return false;
+    }
+
+    const char* version_begin = target_end + 1;
+    if (line_end - version_begin < 8 || std::memcmp(version_begin, "HTTP/", 5) != 0) {
+        return false;
+    }
+
+    auto span = [data](const char* first, const char* last) {
+        return Span{static_cast<uint32_t>(first - data), static_cast<uint32_t>(last - first)};
+    };
+
+    method_ = span(data + begin, method_end);
+    target_ = span(target_begin, target_end);
+    version_ = span(version_begin, line_end);
+
+    const char* question = find_char(target_begin, target_end, '?');
+    path_ = span(target_begin, question);
+    query_ = question == target_end ? span(target_end, target_end) : span(question + 1, target_end);
+    return true;
+}
+
+bool RequestParser::parse_header_line(size_t begin, size_t end) {
+    const char* data = base_;
+    const char* line_begin = data + begin;
+    const char* line_end = data + end;
+
+    // 不支持已废弃的多行折叠头部
+    if (is_space(*line_begin)) {
+        return false;
+    }
+
+    const char* colon = find_char(line_begin, line_end, ':');
+    if (colon == line_end || colon == line_begin) {
+        return false;
+    }
+    for (const char* p = line_begin; p < colon; ++p) {
+        if (!is_token_char(*p)) {
+            return false;
+        }
+    }
+
+    const char* value_begin = colon + 1;
+    const char* value_end = line_end;
+    while (value_begin < value_end && is_space(*value_begin)) {
+        ++value_begin;
+    }
+    while (value_end > value_begin && is_space(value_end[-1])) {
+        --value_end;
+    }
+
+    HeaderSpan header;
+    header.name = Span{static_cast<uint32_t>(begin), static_cast<uint32_t>(colon - line_begin)};
+    header.value = Span{static_cast<uint32_t>(value_begin - data), static_cast<uint32_t>(value_end - value_begin)};
+    // 名称只映射一次，之后构造Request和查找常用头部都直接使用编号
+    header.id = header_id(view(header.name));
+    headers_.push_back(header);
+
+    if (header.id == HeaderId::ContentLength) {
+        std::string_view value = view(header.value);
+        if (value.empty() || value.size() > 18) {
+            return false;
+        }
+        size_t length = 0;
+        for (char c : value) {
+            if (c < '0' || c > '9') {
+                return false;
+            }
+            length = length * 10 + (c - '0');
+        }
+        // 多个Content-Length不一致时视为请求走私，拒绝
+        if (has_content_length_ && length != content_length_) {
+            return false;
+        }
+        has_content_length_ = true;
+        content_length_ = length;
+    } else if (header.id == HeaderId::TransferEncoding) {
+        // 只支持chunked作为最后一个编码
+        std::string_view value = view(header.value);
+        size_t comma = value.rfind(',');
+        std::string_view last = comma == std::string_view::npos ? value : value.substr(comma + 1);
+        while (!last.empty() && is_space(last.front())) {
+            last.remove_prefix(1);
+        }
+        has_transfer_encoding_ = true;
+        chunked_ = iequals(last, "chunked");
+    }
+    return true;
+}
+
+bool ChunkedDecoder::parse_size_line(std::string_view line, size_t& size) {
+    size = 0;
+    size_t digits = 0;
+    for (char c : line) {
+        int value;
+        if (c >= '0' && c <= '9') {
+            value = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            value = c - 'A' + 10;
+        } else if (c == ';' || is_space(c)) {
+            break;
+        } else {
+            return false;
+        }
+        // 最多15位十六进制，避免溢出
+        if (++digits > 15) {
+            return false;
+        }
+        size = (size << 4) | static_cast<size_t>(value);
+    }
+    return digits > 0;
+}
+
+std::string_view RequestParser::find_header(std::string_view name) const {
+    for (const auto& header : headers_) {
+        if (iequals(view(header.name), name)) {
+            return view(header.value);
+        }
+    }
+    return std::string_view();
+}
+
+Request make_request(const RequestParser& parser, std::string_view body, std::pmr::memory_resource* resource) {
+    Request request(resource);
+    request.method.assign(parser.method());
+    request.path.assign(parser.path());
+    request.query.assign(parser.query());
+    request.version.assign(parser.version());
+
+    request.headers.reserve(parser.header_count());
+    for (size_t i = 0; i < parser.header_count(); ++i) {
+        RequestParser::Header header = parser.header(i);
+        request.headers.add(header.id, header.name, header.value);
+    }
+
+    request.body.assign(body);
+    return request;
+}
+
+} // namespace http
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+#include "headers.hpp"
+
+namespace http {
+
+struct Request;
+
+/**
+ * 增量式HTTP请求解析器
+ * 直接在接收缓冲区上工作，不复制数据；数据不完整时返回Incomplete，
+ * 追加数据后再次调用parse()会从上次停下的位置继续。
+ * 内部只保存偏移量，因此缓冲区在两次调用之间扩容也是安全的；
+ * 访问器返回的string_view指向最近一次传入parse()的缓冲区。
+ */
+class RequestParser {
+public:
+    enum class Status {
+        Incomplete,  // 需要更多数据
+        Complete,    // 请求行和头部已完整
+        Error        // 请求格式错误或超出限制，见error_status()
+    };
+
+    struct Limits {
+        size_t max_header_count = 64;      // 头部字段数上限
+        size_t max_header_bytes = 8192;    // 请求行加头部的总字节数上限
+    };
+
+    struct Header {
+        std::string_view name;
+        std::string_view value;
+        HeaderId id;          // 解析时已映射的常用头部编号
+    };
+
+    RequestParser();
+    explicit RequestParser(const Limits& limits);
+
+    // 解析缓冲区，buffer必须以之前传入的数据为前缀
+    Status parse(std::string_view buffer);
+
+    // 重置状态以解析下一个请求（保留已分配的内存）
+    void reset();
+
+    bool complete() const { return state_ == State::Done; }
+    int error_status() const { return error_status_; }
+
+    std::string_view method() const { return view(method_); }
+    std::string_view target() const { return view(target_); }
+    std::string_view path() const { return view(path_); }
+    std::string_view query() const { return view(query_); }
+    std::string_view version() const { return view(version_); }
+
+    size_t header_count() const { return headers_.size(); }
+    Header header(size_t index) const {
+        return {view(headers_[index].name), view(headers_[index].value), headers_[index].id};
+    }
+
+    // 大小写不敏感地查找头部，未找到时返回data()为nullptr的空视图
+    std::string_view find_header(std::string_view name) const;
+
+    // 请求行与头部（含结尾空行）占用的字节数
+    size_t header_length() const { return header_length_; }
+
+    // Content-Length声明的请求体长度，未声明时为0
+    size_t content_length() const { return content_length_; }
+
+    // 请求体是否使用分块传输编码
+    bool chunked() const { return chunked_; }
+
+private:
+    enum class State { RequestLine, Headers, Done, Error };
+
+    struct Span {
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    struct HeaderSpan {
+        Span name;
+        Span value;
+        HeaderId id = HeaderId::Other;
+    };
+
+    Limits limits_;
+    State state_ = State::RequestLine;
+    const char* base_ = nullptr;
+    size_t position_ = 0;
+    size_t header_length_ = 0;
+    size_t content_length_ = 0;
+    bool has_content_length_ = false;
+    bool has_transfer_encoding_ = false;
+    bool chunked_ = false;
+    int error_status_ = 0;
+
+    Span method_;
+    Span target_;
+    Span path_;
+    Span query_;
+    Span version_;
+    std::vector<HeaderSpan> headers_;
+
+    std::string_view view(Span span) const {
+        return base_ ? std::string_view(base_ + span.offset, span.length) : std::string_view();
+    }
+
+    bool parse_request_line(size_t begin, size_t end);
+    bool parse_header_line(size_t begin, size_t end);
+    Status fail(int status);
+};
+
+/**
+ * 分块传输编码（Transfer-Encoding: chunked）的增量解码器
+ * 每次调用decode()处理尽可能多的输入，数据片段直接以string_view交给sink，不做复制
+ */
+class ChunkedDecoder {
+public:
+    enum class Status { Incomplete, Complete, Error };
+
+    static constexpr size_t kMaxLineLength = 4096;
+
+    void reset() {
+        state_ = State::Size;
+        remaining_ = 0;
+    }
+
+    /**
+     * @param input 尚未消费的输入
+     * @param consumed 输出本次消费的字节数
+     * @param sink 以std::string_view为参数的可调用对象，按顺序接收解码后的数据
+     */
+    template <typename Sink>
+    Status decode(std::string_view input, size_t& consumed, Sink&& sink);
+
+private:
+    enum class State { Size, Data, DataEnd, Trailer, Done };
+
+    State state_ = State::Size;
+    size_t remaining_ = 0;
+
+    // 解析块大小行（忽略扩展参数），失败返回false
+    static bool parse_size_line(std::string_view line, size_t& size);
+};
+
+template <typename Sink>
+ChunkedDecoder::Status ChunkedDecoder::decode(std::string_view input, size_t& consumed, Sink&& sink) {
+    size_t position = 0;
+
+    while (state_ != State::Done) {
+        std::string_view rest = input.substr(position);
+
+        if (state_ == State::Data) {
+            if (rest.empty()) {
+                break;
+            }
+            size_t take = rest.size() < remaining_ ? rest.size() : remaining_;
+            sink(rest.substr(0, take));
+            position += take;
+            remaining_ -= take;
+            if (remaining_ == 0) {
+                state_ = State::DataEnd;
+            }
+            continue;
+        }
+
+        // 其余状态都以行为单位
+        size_t newline = rest.find('\n');
+        if (newline == std::string_view::npos) {
+            if (rest.size() > kMaxLineLength) {
+                consumed = position;
+                return Status::Error;
+            }
+            break;
+        }
+        std::string_view line = rest.substr(0, newline);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        position += newline + 1;
+
+        if (state_ == State::Size) {
+            if (!parse_size_line(line, remaining_)) {
+                consumed = position;
+                return Status::Error;
+            }
+            state_ = remaining_ == 0 ? State::Trailer : State::Data;
+        } else if (state_ == State::DataEnd) {
+            if (!line.empty()) {
+                consumed = position;
+                return Status::Error;
+            }
+            state_ = State::Size;
+        } else if (line.empty()) {
+            // 尾部字段以空行结束，字段本身被忽略
+            state_ = State::Done;
+        }
+    }
+
+    consumed = position;
+    return state_ == State::Done ? Status::Complete : Status::Incomplete;
+}
+
+// 由解析结果构造拥有数据的Request对象，字符串和头部分配在resource中
+Request make_request(const RequestParser& parser, std::string_view body, std::pmr::memory_resource* resource);
+
+// ASCII大小写不敏感比较
+bool iequals(std::string_view a, std::string_view b);
+
+// 去除首尾的空格和制表符
+std::string_view trim_whitespace(std::string_view value);
+
+} // namespace http
@@ -0,0 +1,118 @@
+#include "response_cache.hpp"
+#include <iterator>
+#include <utility>
+
+namespace http {
+
+namespace {
+
+// 链表节点、索引项和两个报文的控制块等固定开销的估计值
+constexpr size_t kNodeOverhead = 256;
+
+size_t entry_charge(std::string_view key, const ResponseCache::Entry& entry) {
+    size_t charge = kNodeOverhead + key.size();
+    for (const auto& message : entry.message) {
+        charge += message ? message->size() : 0;
+    }
+    return charge;
+}
+
+} // namespace
+
+ResponseCache::ResponseCache(size_t capacity, size_t shards)
+    : shards_(std::make_unique<Shard[]>(shards == 0 ? 1 : shards)), shard_count_(shards == 0 ? 1 : shards),
+      shard_capacity_(capacity / shard_count_) {
+}
+
+ResponseCache::Shard& ResponseCache::shard_for(std::string_view key) {
+    return shards_[std::hash<std::string_view>{}(key) % shard_count_];
+}
+
+std::shared_ptr<const ResponseCache::Entry> ResponseCache::find(std::string_view key, Clock::time_point now) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return find_locked(shard, key, now);
+}
+
+std::shared_ptr<const ResponseCache::Entry> ResponseCache::find_locked(Shard& shard, std::string_view key,
+                                                                      Clock::time_point now) {
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        return nullptr;
+    }
+    if (now >= it->second->entry->expires) {
+        erase_locked(shard, it->second);
+        return nullptr;
+    }
+    shard.nodes.splice(shard.nodes.begin(), shard.nodes, it->second);
+    return it->second->entry;
+}
+
+void ResponseCache::erase_locked(Shard& shard, std::list<Node>::iterator node) {
+    shard.bytes -= node->charge;
+    shard.index.erase(node->key);
+    shard.nodes.erase(node);
+}
+
+ResponseCache::Result ResponseCache::join(std::string_view key, Clock::time_point now,
+                                          std::shared_ptr<const Entry>& entry, Waiter waiter) {
+    Shard& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // 两次加锁之间可能已有其他请求填充完毕
+    if ((entry = find_locked(shard, key, now))) {
+        return Result::Hit;
+    }
+    auto [it, inserted] = shard.pending.try_emplace(std::string(key));
+    if (inserted) {
+        return Result::Fill;
+    }
+    it->second.push_back(std::move(waiter));
+    return Result::Wait;
+}
+
+size_t ResponseCache::fill(std::string_view key, std::shared_ptr<const Entry> entry) {
+    Shard& shard = shard_for(key);
+    std::vector<Waiter> waiters;
+    size_t evicted = 0;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto pending = shard.pending.find(std::string(key));
+        if (pending != shard.pending.end()) {
+            waiters = std::move(pending->second);
+            shard.pending.erase(pending);
+        }
+
+        // 超过分片预算的单个响应不缓存，但等待者仍然可以使用
+        size_t charge = entry ? entry_charge(key, *entry) : 0;
+        if (entry && charge <= shard_capacity_) {
+            auto it = shard.index.find(key);
+            if (it != shard.index.end()) {
+                erase_locked(shard, it->second);
+            }
+            shard.nodes.push_front(Node{std::string(key), entry, charge});
+            shard.index.emplace(shard.nodes.front().key, shard.nodes.begin());
+            shard.bytes += charge;
+            while (shard.bytes > shard_capacity_) {
+                erase_locked(shard, std::prev(shard.nodes.end()));
+                ++evicted;
+            }
+        }
+    }
+
+    // 在锁外通知，等待者可能再次访问缓存
+    for (const Waiter& waiter : waiters) {
+        waiter(entry);
+    }
+    return evicted;
+}
+
+size_t ResponseCache::size_bytes() const {
+    size_t total = 0;
+    for (size_t i = 0; i < shard_count_; ++i) {
+        std::lock_guard<std::mutex> lock(shards_[i].mutex);
+        total += shards_[i].bytes;
+    }
+    return total;
+}
+
+} // namespace http
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace http {
+
+/**
+ * 分片的响应微缓存（线程安全）
+ * 缓存项是完整序列化的报文，命中时与静态路由一样直接共享发送，不执行处理器也不再序列化。
+ * 按键的哈希分片，每个分片一把锁、一条LRU链表，内存预算在分片间平均分配，超出时淘汰最久未用的项；
+ * 过期的项在下次查找时删除。
+ * 同一个键并发未命中时只有第一个请求负责填充，其余请求登记为等待者，填充完成后一起得到结果。
+ */
+class ResponseCache {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::shared_ptr<const std::string> message[2];   // 下标为keep_alive
+        Clock::time_point expires;
+    };
+
+    // 填充完成时在填充者的线程上调用；entry为空表示该响应不可缓存，等待者应自行处理请求
+    using Waiter = std::function<void(const std::shared_ptr<const Entry>& entry)>;
+
+    enum class Result {
+        Hit,    // 命中，entry为缓存的报文
+        Fill,   // 未命中，调用者负责执行处理器并调用fill()
+        Wait,   // 已有请求在填充，waiter已登记
+    };
+
+    /**
+     * @param capacity 所有分片合计的内存预算（字节），按报文和键的大小计
+     * @param shards 分片数，0视为1
+     */
+    ResponseCache(size_t capacity, size_t shards);
+
+    ResponseCache(const ResponseCache&) = delete;
+    ResponseCache& operator=(const ResponseCache&) = delete;
+
+    // 查找未过期的缓存项，未命中时返回nullptr（不分配内存）
+    std::shared_ptr<const Entry> find(std::string_view key, Clock::time_point now);
+
+    // 未命中后调用：再次查找，仍未命中时成为填充者或登记等待者
+    Result join(std::string_view key, Clock::time_point now, std::shared_ptr<const Entry>& entry, Waiter waiter);
+
+    // 结束填充：entry非空时存入缓存，然后通知所有等待者；返回因超出预算而淘汰的项数
+    size_t fill(std::string_view key, std::shared_ptr<const Entry> entry);
+
+    // 当前缓存项占用的字节数
+    size_t size_bytes() const;
+
+private:
+    struct Node {
+        std::string key;
+        std::shared_ptr<const Entry> entry;
+        size_t charge;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::list<Node> nodes;   // 头部为最近使用
+        std::unordered_map<std::string_view, std::list<Node>::iterator> index;
+        std::unordered_map<std::string, std::vector<Waiter>> pending;   // 正在填充的键及其等待者
+        size_t bytes = 0;
+    };
+
+    std::unique_ptr<Shard[]> shards_;
+    size_t shard_count_;
+    size_t shard_capacity_;
+
+    Shard& shard_for(std::string_view key);
+    std::shared_ptr<const Entry> find_locked(Shard& shard, std::string_view key, Clock::time_point now);
+    void erase_locked(Shard& shard, std::list<Node>::iterator node);
+};
+
+} // namespace http
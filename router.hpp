@@ -0,0 +1,242 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace http {
+
+/**
+ * 路径参数
+ * 名称指向路由树中的字符串，值以偏移量记录在被匹配的路径中，
+ * 因此查找过程不分配内存，且Request被移动后依然有效。
+ */
+struct PathParams {
+    static constexpr size_t kMaxParams = 8;
+
+    struct Param {
+        std::string_view name;
+        uint32_t offset = 0;
+        uint32_t length = 0;
+    };
+
+    Param items[kMaxParams];
+    size_t count = 0;
+
+    void clear() { count = 0; }
+};
+
+/**
+ * 压缩前缀树（radix tree）路由
+ * 每个HTTP方法一棵树，支持：
+ *   - 静态路径        /users/list
+ *   - 命名参数        /users/:id        匹配一个路径段
+ *   - 通配后缀        *path             位于末尾，匹配剩余的全部路径
+ * 匹配优先级为 静态 > 参数 > 通配，必要时回溯。
+ * 所有插入必须在开始查找之前完成；find()只读且不分配内存，可多线程并发调用。
+ */
+template <typename T>
+class Router {
+public:
+    // 插入路由并返回其值的引用，已存在时返回原有值
+    T& add(std::string_view method, std::string_view pattern);
+
+    // 查找路由，未命中返回nullptr；params按匹配顺序填充，偏移量相对于path
+    const T* find(std::string_view method, std::string_view path, PathParams& params) const;
+
+    size_t size() const { return size_; }
+
+private:
+    struct Node {
+        std::string prefix;                          // 静态前缀（压缩后的边）
+        std::vector<std::unique_ptr<Node>> children; // 静态子节点，首字符互不相同
+        std::unique_ptr<Node> param_child;           // ":name" 子节点
+        std::string param_name;
+        std::unique_ptr<T> wildcard;                 // "*name" 通配值
+        std::string wildcard_name;
+        std::unique_ptr<T> value;                    // 在此结束的路由值
+    };
+
+    std::vector<std::pair<std::string, std::unique_ptr<Node>>> trees_;
+    size_t size_ = 0;
+
+    const Node* tree(std::string_view method) const {
+        for (const auto& [name, root] : trees_) {
+            if (name == method) {
+                return root.get();
+            }
+        }
+        return nullptr;
+    }
+
+    static const T* match(const Node* node, std::string_view path, std::string_view full_path,
+                          PathParams& params);
+
+    static bool push_param(PathParams& params, std::string_view name, std::string_view value,
+                           std::string_view full_path) {
+        if (params.count >= PathParams::kMaxParams) {
+            return false;
+        }
+        PathParams::Param& param = params.items[params.count++];
+        param.name = name;
+        param.offset = static_cast<uint32_t>(value.data() - full_path.data());
+        param.length = static_cast<uint32_t>(value.size());
+        return true;
+    }
+};
+
+template <typename T>
+T& Router<T>::add(std::string_view method, std::string_view pattern) {
+    if (pattern.empty() || pattern.front() != '/') {
+        throw std::runtime_error("路由必须以'/'开头: " + std::string(pattern));
+    }
+
+    Node* node = nullptr;
+    for (auto& [name, root] : trees_) {
+        if (name == method) {
+            node = root.get();
+        }
+    }
+    if (node == nullptr) {
+        trees_.emplace_back(std::string(method), std::make_unique<Node>());
+        node = trees_.back().second.get();
+    }
+
+    std::string_view path = pattern;
+    while (!path.empty()) {
+        if (path.front() == ':') {
+            size_t end = path.find('/');
+            std::string_view name = path.substr(1, end == std::string_view::npos ? std::string_view::npos : end - 1);
+            if (name.empty()) {
+                throw std::runtime_error("路由参数缺少名称: " + std::string(pattern));
+            }
+            if (!node->param_child) {
+                node->param_child = std::make_unique<Node>();
+                node->param_name = std::string(name);
+            } else if (node->param_name != name) {
+                throw std::runtime_error("路由参数名冲突: " + std::string(pattern));
+            }
+            node = node->param_child.get();
+            path.remove_prefix(end == std::string_view::npos ? path.size() : end);
+            continue;
+        }
+
+        if (path.front() == '*') {
+            if (!node->wildcard) {
+                node->wildcard = std::make_unique<T>();
+                node->wildcard_name = std::string(path.substr(1));
+                ++size_;
+            }
+            return *node->wildcard;
+        }
+
+        // 静态部分：截至下一个参数或通配符
+        size_t special = path.find_first_of(":*");
+        std::string_view text = path.substr(0, special);
+
+        Node* child = nullptr;
+        for (auto& candidate : node->children) {
+            if (candidate->prefix.front() == text.front()) {
+                child = candidate.get();
+                break;
+            }
+        }
+        if (child == nullptr) {
+            auto created = std::make_unique<Node>();
+            created->prefix = std::string(text);
+            child = created.get();
+            node->children.push_back(std::move(created));
+            node = child;
+            path.remove_prefix(text.size());
+            continue;
+        }
+
+        size_t common = 0;
+        while (common < text.size() && common < child->prefix.size() && text[common] == child->prefix[common]) {
+            ++common;
+        }
+
+        // 公共前缀短于已有边时拆分该边
+        if (common < child->prefix.size()) {
+            auto split = std::make_unique<Node>();
+            split->prefix = child->prefix.substr(0, common);
+            for (auto& slot : node->children) {
+                if (slot.get() == child) {
+                    std::unique_ptr<Node> old_child = std::move(slot);
+                    old_child->prefix.erase(0, common);
+                    split->children.push_back(std::move(old_child));
+                    slot = std::move(split);
+                    child = slot.get();
+                    break;
+                }
+            }
+        }
+
+        node = child;
+        path.remove_prefix(common);
+    }
+
+    if (!node->value) {
+        node->value = std::make_unique<T>();
+        ++size_;
+    }
+    return *node->value;
+}
+
+template <typename T>
+const T* Router<T>::find(std::string_view method, std::string_view path, PathParams& params) const {
+    params.clear();
+    const Node* root = tree(method);
+    if (root == nullptr) {
+        return nullptr;
+    }
+    return match(root, path, path, params);
+}
+
+template <typename T>
+const T* Router<T>::match(const Node* node, std::string_view path, std::string_view full_path, PathParams& params) {
+    if (path.empty() && node->value) {
+        return node->value.get();
+    }
+
+    if (!path.empty()) {
+        for (const auto& child : node->children) {
+            if (child->prefix.front() != path.front()) {
+                continue;
+            }
+            if (path.size() >= child->prefix.size() &&
+                path.compare(0, child->prefix.size(), child->prefix) == 0) {
+                if (const T* found = match(child.get(), path.substr(child->prefix.size()), full_path, params)) {
+                    return found;
+                }
+            }
+            break;
+        }
+
+        if (node->param_child) {
+            size_t end = path.find('/');
+            std::string_view value = path.substr(0, end);
+            if (!value.empty()) {
+                size_t saved = params.count;
+                if (push_param(params, node->param_name, value, full_path)) {
+                    std::string_view rest = end == std::string_view::npos ? std::string_view() : path.substr(end);
+                    if (const T* found = match(node->param_child.get(), rest, full_path, params)) {
+                        return found;
+                    }
+                }
+                params.count = saved;
+            }
+        }
+    }
+
+    if (node->wildcard && push_param(params, node->wildcard_name, path, full_path)) {
+        return node->wildcard.get();
+    }
+    return nullptr;
+}
+
+} // namespace http
@@ -1,6 +1,14 @@
 #pragma once
 #include "http_server.hpp"
+#include "async_io.hpp"
+#include "metrics.hpp"
+#include "middleware.hpp"
 #include "templates.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <memory>
+#include <string>
 
 namespace routes {
     
@@ -15,59 +23,151 @@ namespace routes {
          * @param server HTTP服务器实例
          */
         static void configure_routes(http::HttpServer& server) {
+            register_middleware(server);
             register_home_route(server);
             register_hello_route(server);
             register_json_route(server);
             register_info_route(server);
+            register_upload_route(server);
+            register_delay_route(server);
+            register_stream_route(server);
+            register_metrics_route(server);
         }
         
     private:
         /**
-         * 注册主页路由
+         * 注册全局中间件：所有路由允许跨域访问并禁止浏览器猜测内容类型（须在注册静态路由之前）
+         */
+        static void register_middleware(http::HttpServer& server) {
+            server.use(http::make_middleware(http::Cors{}, http::SetHeader{"X-Content-Type-Options", "nosniff"}));
+        }
+        
+        /**
+         * 注册主页路由（静态，启动时生成完整报文）
          */
         static void register_home_route(http::HttpServer& server) {
-            server.register_handler("GET", "/", [](const http::Request& req) -> http::Response {
-                http::Response response;
-                response.headers["Content-Type"] = "text/html; charset=utf-8";
-                response.body = templates::get_home_page();
-                return response;
-            });
+            http::Response response;
+            response.headers["Content-Type"] = "text/html; charset=utf-8";
+            response.body = templates::get_home_page();
+            server.register_static("GET", "/", response);
         }
         
         /**
-         * 注册问候页面路由
+         * 注册问候页面路由（静态）
          */
         static void register_hello_route(http::HttpServer& server) {
-            server.register_handler("GET", "/hello", [](const http::Request& req) -> http::Response {
-                http::Response response;
-                response.headers["Content-Type"] = "text/html; charset=utf-8";
-                response.body = templates::get_hello_page();
-                return response;
-            });
+            http::Response response;
+            response.headers["Content-Type"] = "text/html; charset=utf-8";
+            response.body = templates::get_hello_page();
+            server.register_static("GET", "/hello", response);
         }
         
         /**
          * 注册JSON API路由
          */
         static void register_json_route(http::HttpServer& server) {
-            server.register_handler("GET", "/json", [](const http::Request& req) -> http::Response {
+            server.register_handler("GET", "/json", [](const http::Request&) -> http::Response {
                 http::Response response;
                 response.headers["Content-Type"] = "application/json; charset=utf-8";
                 response.body = templates::get_json_response();
                 return response;
             });
+            // 内容每秒才变化一次，1秒内的重复请求直接使用缓存的报文
+            server.cache_responses("/json", http::CachePolicy{std::chrono::milliseconds(1000), {}});
         }
         
         /**
-         * 注册服务器信息路由
+         * 注册服务器信息路由（静态）
          */
         static void register_info_route(http::HttpServer& server) {
-            server.register_handler("GET", "/info", [](const http::Request& req) -> http::Response {
+            http::Response response;
+            response.headers["Content-Type"] = "text/html; charset=utf-8";
+            response.body = templates::get_info_page();
+            server.register_static("GET", "/info", response);
+        }
+        
+        /**
+         * 注册上传路由
+         * 请求体以流式方式逐块统计，不在内存中缓存整个上传内容
+         */
+        static void register_upload_route(http::HttpServer& server) {
+            server.register_streaming_handler("POST", "/upload", [](const http::Request&) {
+                auto received = std::make_shared<size_t>(0);
+                
+                http::BodyStream stream;
+                stream.on_data = [received](std::string_view chunk) {
+                    *received += chunk.size();
+                };
+                stream.on_complete = [received](const http::Request&) -> http::Response {
+                    http::Response response;
+                    response.headers["Content-Type"] = "application/json; charset=utf-8";
+                    response.body = "{\"received\": " + std::to_string(*received) + "}";
+                    return response;
+                };
+                return stream;
+            });
+        }
+        
+        /**
+         * 注册延迟响应路由（协程处理器）
+         * /delay?ms=N 在事件循环上等待N毫秒（最多5000）后返回，等待期间不占用任何线程
+         */
+        static void register_delay_route(http::HttpServer& server) {
+            server.register_async_handler("GET", "/delay", [](const http::Request& req) -> http::Task<http::Response> {
+                long delay = 100;
+                std::string_view query = req.query;
+                if (query.rfind("ms=", 0) == 0) {
+                    std::from_chars(query.data() + 3, query.data() + query.size(), delay);
+                }
+                delay = std::clamp(delay, 0L, 5000L);
+                
+                co_await http::sleep_for(std::chrono::milliseconds(delay));
+                
+                http::Response response;
+                response.headers["Content-Type"] = "application/json; charset=utf-8";
+                response.body = "{\"delayed_ms\": " + std::to_string(delay) + "}";
+                co_return response;
+            });
+        }
+        
+        /**
+         * 注册流式响应路由：边生成边以chunked发送，响应再大也只缓存有限的数据
+         */
+        static void register_stream_route(http::HttpServer& server) {
+            server.register_stream_response("GET", "/stream", [](const http::Request& req, http::ResponseWriter& writer) -> http::Task<void> {
+                unsigned long lines = 10000;
+                std::string_view query = req.query;
+                if (query.rfind("lines=", 0) == 0) {
+                    std::from_chars(query.data() + 6, query.data() + query.size(), lines);
+                }
+                lines = std::min(lines, 100000000UL);
+                
+                writer.head().headers["Content-Type"] = "text/plain; charset=utf-8";
+                std::string batch;
+                for (unsigned long i = 1; i <= lines; ++i) {
+                    batch.append("line ").append(std::to_string(i)).append("\n");
+                    if (batch.size() >= 4096 || i == lines) {
+                        if (!co_await writer.write(batch)) {
+                            co_return;
+                        }
+                        batch.clear();
+                    }
+                }
+            });
+        }
+        
+        /**
+         * 注册指标路由
+         * 每次抓取时合并各线程的分片，输出Prometheus文本格式；过载时也不拒绝，监控恰好在此时最需要
+         */
+        static void register_metrics_route(http::HttpServer& server) {
+            server.register_handler("GET", "/metrics", [&server](const http::Request&) {
                 http::Response response;
-                response.headers["Content-Type"] = "text/html; charset=utf-8";
-                response.body = templates::get_info_page();
+                response.headers["Content-Type"] = "text/plain; version=0.0.4; charset=utf-8";
+                response.body = server.metrics().render_prometheus();
                 return response;
             });
+            server.exempt_from_shedding("GET", "/metrics");
         }
     };
     
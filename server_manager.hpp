@@ -1,32 +1,56 @@
 #pragma once
 #include "http_server.hpp"
+#include "listener_handoff.hpp"
 #include "routes.hpp"
 #include <memory>
 #include <iostream>
+#include <fstream>
+#include <iterator>
 #include <csignal>
-#include <thread>
+#include <pthread.h>
+#include <unistd.h>
 #include <chrono>
+#include <string>
+#include <vector>
 
 namespace server {
     
     /**
      * 服务器管理器
-     * 负责服务器的生命周期管理
+     * 负责服务器的生命周期管理。信号在主线程上同步等待（sigwait），不在信号处理函数中做任何工作：
+     *   SIGINT/SIGTERM  优雅退出：停止接受新连接，等进行中的请求完成后退出
+     *   SIGQUIT         立即退出
+     *   SIGUSR2         热升级：启动新的可执行文件并把监听socket交给它，新进程就绪后本进程优雅退出
+     * 必须在创建其他线程之前构造，使所有线程都继承屏蔽这些信号的掩码。
      */
     class ServerManager {
     private:
+        // 等待新进程开始接受连接的上限，超时则放弃升级，本进程继续服务
+        static constexpr std::chrono::seconds kUpgradeTimeout{10};
+        
         std::unique_ptr<http::HttpServer> server_;
+        http::ServerConfig config_;
         int port_;
-        static ServerManager* instance_;
+        sigset_t signals_;
+        http::InheritedListeners inherited_;
+        std::string executable_;
+        std::vector<std::string> arguments_;
         
     public:
         /**
          * 构造函数
          * @param port 服务器端口，默认8080
          */
-        explicit ServerManager(int port = 8080) : port_(port) {
-            instance_ = this;
+        explicit ServerManager(int port = 8080) : ServerManager(http::ServerConfig{port}) {
+        }
+        
+        /**
+         * 构造函数
+         * @param config 服务器配置（端口、事件循环线程数等）
+         */
+        explicit ServerManager(const http::ServerConfig& config) : config_(config), port_(config.port) {
             setup_signal_handlers();
+            resolve_executable();
         }
         
         /**
@@ -34,7 +58,14 @@ namespace server {
          */
         void initialize() {
             try {
-                server_ = std::make_unique<http::HttpServer>(port_);
+                // 由旧进程热升级启动时沿用它的监听socket，不再绑定端口
+                inherited_ = http::receive_listeners();
+                if (!inherited_.sockets.empty()) {
+                    std::cout << "♻️  从旧进程接收了 " << inherited_.sockets.size() << " 个监听socket" << std::endl;
+                    config_.inherited_listeners = std::move(inherited_.sockets);
+                }
+                server_ = std::make_unique<http::HttpServer>(config_);
+                port_ = server_->port();
                 routes::RouteManager::configure_routes(*server_);
                 std::cout << "✅ 服务器初始化完成" << std::endl;
             } catch (const std::exception& e) {
@@ -53,6 +84,8 @@ namespace server {
             
             try {
                 server_->start();
+                // 已经在继承的socket上接受连接，旧进程可以开始排空
+                http::notify_handoff_ready(inherited_);
                 print_startup_info();
             } catch (const std::exception& e) {
                 std::cerr << "❌ 服务器启动失败: " << e.what() << std::endl;
@@ -61,7 +94,7 @@ namespace server {
         }
         
         /**
-         * 运行服务器主循环
+         * 运行服务器主循环：阻塞等待信号，服务器退出后返回
          */
         void run() {
             if (!server_) {
@@ -69,12 +102,58 @@ namespace server {
             }
             
             while (server_->is_running()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                int signal = 0;
+                if (sigwait(&signals_, &signal) != 0) {
+                    continue;
+                }
+                switch (signal) {
+                    case SIGQUIT:
+                        stop();
+                        break;
+                    case SIGUSR2:
+                        if (upgrade()) {
+                            drain();
+                        }
+                        break;
+                    default:
+                        drain();
+                        break;
+                }
             }
         }
         
         /**
-         * 停止服务器
+         * 优雅退出：停止接受新连接，等待进行中的请求完成（最长ServerConfig::drain_timeout）
+         */
+        void drain() {
+            if (server_ && server_->is_running()) {
+                std::cout << "\n🛑 停止接受新连接，等待 " << server_->connection_count() << " 个连接完成..." << std::endl;
+                bool drained = server_->drain(config_.drain_timeout);
+                std::cout << (drained ? "✅ 服务器已排空并关闭" : "⚠️  排空超时，剩余连接已强制关闭") << std::endl;
+            }
+        }
+        
+        /**
+         * 热升级：启动新的可执行文件并交出监听socket，返回新进程是否已就绪
+         */
+        bool upgrade() {
+            if (!server_ || !server_->is_running()) {
+                return false;
+            }
+            try {
+                std::cout << "\n♻️  热升级：启动 " << executable_ << std::endl;
+                pid_t child = http::spawn_with_listeners(executable_, arguments_, server_->listen_sockets(),
+                                                         kUpgradeTimeout);
+                std::cout << "✅ 新进程 " << child << " 已开始接受连接" << std::endl;
+                return true;
+            } catch (const std::exception& e) {
+                std::cerr << "❌ 热升级失败，继续服务: " << e.what() << std::endl;
+                return false;
+            }
+        }
+        
+        /**
+         * 立即停止服务器
          */
         void stop() {
             if (server_) {
@@ -91,6 +170,13 @@ namespace server {
             return server_ && server_->is_running();
         }
         
+        /**
+         * 获取监听分片数（每个分片一个SO_REUSEPORT监听socket和一个事件循环）
+         */
+        size_t shard_count() const {
+            return server_ ? server_->shard_count() : 0;
+        }
+        
         /**
          * 获取服务器端口
          */
@@ -100,21 +186,37 @@ namespace server {
         
     private:
         /**
-         * 设置信号处理器
+         * 屏蔽退出和升级信号，由run()同步等待；之后创建的线程继承该掩码
          */
         void setup_signal_handlers() {
-            signal(SIGINT, signal_handler);
-            signal(SIGTERM, signal_handler);
+            sigemptyset(&signals_);
+            sigaddset(&signals_, SIGINT);
+            sigaddset(&signals_, SIGTERM);
+            sigaddset(&signals_, SIGQUIT);
+            sigaddset(&signals_, SIGUSR2);
+            pthread_sigmask(SIG_BLOCK, &signals_, nullptr);
         }
         
         /**
-         * 信号处理函数
+         * 记录当前可执行文件的路径和参数，热升级时按原样启动（路径在部署替换文件之前解析）
          */
-        static void signal_handler(int signal) {
-            if (instance_) {
-                instance_->stop();
+        void resolve_executable() {
+            char path[4096];
+            ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+            if (length > 0) {
+                executable_.assign(path, length);
+            }
+            std::ifstream cmdline("/proc/self/cmdline", std::ios::binary);
+            std::string content((std::istreambuf_iterator<char>(cmdline)), std::istreambuf_iterator<char>());
+            size_t start = 0;
+            while (start < content.size()) {
+                size_t end = content.find('\0', start);
+                if (end == std::string::npos) {
+                    end = content.size();
+                }
+                arguments_.push_back(content.substr(start, end - start));
+                start = end + 1;
             }
-            exit(0);
         }
         
         /**
@@ -124,19 +226,24 @@ namespace server {
             std::cout << "\n" << std::string(50, '=') << std::endl;
             std::cout << "🚀 现代C++ HTTP服务器已启动！" << std::endl;
             std::cout << std::string(50, '=') << std::endl;
-            std::cout << "📍 端口: " << port_ << std::endl;
+            std::cout << "📍 端口: " << port_ << "，PID: " << getpid() << std::endl;
+            std::cout << "🧵 事件循环线程: " << server_->io_thread_count()
+                      << "，处理器线程: " << server_->worker_thread_count()
+                      << "，监听分片: " << server_->shard_count()
+                      << "，I/O后端: " << http::io_backend_name(server_->io_backend()) << std::endl;
             std::cout << "🌐 访问地址: http://localhost:" << port_ << std::endl;
             std::cout << "\n📋 可用路由:" << std::endl;
             std::cout << "  • http://localhost:" << port_ << "/ (主页)" << std::endl;
             std::cout << "  • http://localhost:" << port_ << "/hello (问候页面)" << std::endl;
             std::cout << "  • http://localhost:" << port_ << "/json (JSON API)" << std::endl;
             std::cout << "  • http://localhost:" << port_ << "/info (服务器信息)" << std::endl;
-            std::cout << "\n⚡ 按 Ctrl+C 停止服务器" << std::endl;
+            std::cout << "  • POST http://localhost:" << port_ << "/upload (流式上传)" << std::endl;
+            std::cout << "  • http://localhost:" << port_ << "/delay?ms=100 (协程处理器)" << std::endl;
+            std::cout << "  • http://localhost:" << port_ << "/stream?lines=10000 (流式响应)" << std::endl;
+            std::cout << "  • http://localhost:" << port_ << "/metrics (Prometheus指标)" << std::endl;
+            std::cout << "\n⚡ Ctrl+C / SIGTERM 优雅退出，SIGQUIT 立即退出，kill -USR2 " << getpid() << " 热升级" << std::endl;
             std::cout << std::string(50, '=') << std::endl;
         }
     };
     
-    // 静态成员初始化
-    ServerManager* ServerManager::instance_ = nullptr;
-    
 } // namespace server
\ No newline at end of file
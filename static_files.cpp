@@ -0,0 +1,406 @@
+#include "static_files.hpp"
+#include "static_response.hpp"
+#include "request_parser.hpp"
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace http {
+
+namespace {
+
+struct MimeEntry {
+    const char* extension;
+    const char* type;
+};
+
+constexpr MimeEntry kMimeTypes[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"js", "text/javascript; charset=utf-8"},
+    {"mjs", "text/javascript; charset=utf-8"},
+    {"json", "application/json"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"xml", "application/xml"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"avif", "image/avif"},
+    {"ico", "image/x-icon"},
+    {"wasm", "application/wasm"},
+    {"pdf", "application/pdf"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"mp4", "video/mp4"},
+    {"webm", "video/webm"},
+    {"mp3", "audio/mpeg"},
+    {"zip", "application/zip"},
+    {"gz", "application/gzip"},
+};
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 百分号解码并规范化相对路径：忽略空段和"."段，出现".."或NUL时返回false
+bool resolve_relative_path(std::string_view encoded, std::string& out) {
+    std::string decoded;
+    decoded.reserve(encoded.size());
+    for (size_t i = 0; i < encoded.size(); ++i) {
+        char c = encoded[i];
+        if (c == '%') {
+            int high = i + 2 < encoded.size() ? hex_value(encoded[i + 1]) : -1;
+            int low = high >= 0 ? hex_value(encoded[i + 2]) : -1;
+            if (low < 0) {
+                return false;
+            }
+            c = static_cast<char>(high * 16 + low);
+            i += 2;
+        }
+        if (c == '\0') {
+            return false;
+        }
+        decoded.push_back(c);
+    }
+
+    out.clear();
+    std::string_view rest = decoded;
+    while (!rest.empty()) {
+        size_t slash = rest.find('/');
+        std::string_view segment = rest.substr(0, slash);
+        rest = slash == std::string_view::npos ? std::string_view() : rest.substr(slash + 1);
+        if (segment.empty() || segment == ".") {
+            continue;
+        }
+        if (segment == "..") {
+            return false;
+        }
+        out.push_back('/');
+        out.append(segment);
+    }
+    // 保留结尾的斜杠，用于判断是否请求目录
+    if (!decoded.empty() && decoded.back() == '/') {
+        out.push_back('/');
+    }
+    return true;
+}
+
+enum class RangeResult {
+    None,           // 无Range头或格式不支持，返回完整内容
+    Satisfiable,
+    Unsatisfiable   // 返回416
+};
+
+bool parse_number(std::string_view text, uint64_t& value) {
+    if (text.empty() || text.size() > 19) {
+        return false;
+    }
+    value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<uint64_t>(c - '0');
+    }
+    return true;
+}
+
+// 只支持单个区间（bytes=a-b、bytes=a-、bytes=-n），多区间请求按完整内容响应
+RangeResult parse_range(std::string_view header, uint64_t size, uint64_t& offset, uint64_t& length) {
+    header = trim_whitespace(header);
+    if (header.size() < 6 || !iequals(header.substr(0, 6), "bytes=")) {
+        return RangeResult::None;
+    }
+    std::string_view spec = trim_whitespace(header.substr(6));
+    size_t dash = spec.find('-');
+    if (dash == std::string_view::npos || spec.find(',') != std::string_view::npos) {
+        return RangeResult::None;
+    }
+    std::string_view first_text = trim_whitespace(spec.substr(0, dash));
+    std::string_view last_text = trim_whitespace(spec.substr(dash + 1));
+
+    uint64_t first = 0;
+    uint64_t last = 0;
+    if (first_text.empty()) {
+        // 后缀区间：最后n个字节
+        if (!parse_number(last_text, last)) {
+            return RangeResult::None;
+        }
+        if (last == 0 || size == 0) {
+            return RangeResult::Unsatisfiable;
+        }
+        length = std::min(last, size);
+        offset = size - length;
+        return RangeResult::Satisfiable;
+    }
+
+    if (!parse_number(first_text, first)) {
+        return RangeResult::None;
+    }
+    if (last_text.empty()) {
+        last = UINT64_MAX;
+    } else if (!parse_number(last_text, last) || last < first) {
+        return RangeResult::None;
+    }
+    if (first >= size) {
+        return RangeResult::Unsatisfiable;
+    }
+    offset = first;
+    length = std::min(last, size - 1) - first + 1;
+    return RangeResult::Satisfiable;
+}
+
+Response make_status(int status_code, const char* status_text) {
+    Response response;
+    response.status_code = status_code;
+    response.status_text = status_text;
+    response.body = "<h1>" + std::to_string(status_code) + " " + status_text + "</h1>";
+    return response;
+}
+
+// 条件请求：If-None-Match优先，其次If-Modified-Since（RFC 7232 第6节）
+bool not_modified(const Request& request, const OpenFile& file) {
+    if (const std::pmr::string* if_none_match = request.find_header(HeaderId::IfNoneMatch)) {
+        return etag_matches(*if_none_match, file.etag());
+    }
+    if (const std::pmr::string* if_modified_since = request.find_header(HeaderId::IfModifiedSince)) {
+        time_t since;
+        return parse_http_date(*if_modified_since, since) && file.modified() <= since;
+    }
+    return false;
+}
+
+// If-Range与当前版本不符时忽略Range，返回完整内容
+bool range_applies(const Request& request, const OpenFile& file) {
+    const std::pmr::string* if_range = request.find_header("If-Range");
+    if (!if_range) {
+        return true;
+    }
+    std::string_view value = trim_whitespace(*if_range);
+    if (!value.empty() && value.front() == '"') {
+        return value == file.etag();
+    }
+    return value == file.last_modified();
+}
+
+} // namespace
+
+OpenFile::OpenFile(int fd, const struct stat& info, std::string_view path)
+    : fd_(fd),
+      size_(static_cast<uint64_t>(info.st_size)),
+      modified_(info.st_mtim.tv_sec),
+      device_(info.st_dev),
+      inode_(info.st_ino),
+      modified_ns_(static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec),
+      last_modified_(format_http_date(info.st_mtim.tv_sec)),
+      content_type_(mime_type(path)) {
+    // 由inode、大小和纳秒级修改时间组成，文件被替换或修改后即变化
+    char buffer[64];
+    int length = std::snprintf(buffer, sizeof(buffer), "\"%llx-%llx-%llx\"",
+                               static_cast<unsigned long long>(inode_), static_cast<unsigned long long>(size_),
+                               static_cast<unsigned long long>(modified_ns_));
+    etag_.assign(buffer, length);
+}
+
+OpenFile::~OpenFile() {
+    ::close(fd_);
+}
+
+bool OpenFile::same_as(const struct stat& info) const {
+    return info.st_dev == device_ && info.st_ino == inode_ && static_cast<uint64_t>(info.st_size) == size_ &&
+           static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec == modified_ns_;
+}
+
+FileCache::FileCache(size_t capacity, std::chrono::milliseconds revalidate)
+    : capacity_(std::max<size_t>(capacity, 1)), revalidate_(revalidate) {
+}
+
+std::shared_ptr<const OpenFile> FileCache::open(const std::string& path) {
+    Clock::time_point now = Clock::now();
+    std::shared_ptr<const OpenFile> cached;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(path);
+        if (it != index_.end()) {
+            entries_.splice(entries_.begin(), entries_, it->second);
+            if (now - it->second->checked < revalidate_) {
+                return it->second->file;
+            }
+            cached = it->second->file;
+        }
+    }
+
+    // 缓存项过期：文件未变化时只需一次stat，不重新open
+    struct stat info;
+    if (cached && ::stat(path.c_str(), &info) == 0 && cached->same_as(info)) {
+        store(path, cached, now);
+        return cached;
+    }
+
+    std::shared_ptr<const OpenFile> file;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+    if (fd >= 0) {
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+            file = std::make_shared<const OpenFile>(fd, info, path);
+        } else {
+            ::close(fd);
+        }
+    }
+    store(path, file, now);
+    return file;
+}
+
+void FileCache::store(const std::string& path, std::shared_ptr<const OpenFile> file, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(path);
+    if (it != index_.end()) {
+        it->second->file = std::move(file);
+        it->second->checked = now;
+        return;
+    }
+
+    entries_.push_front(Entry{path, std::move(file), now});
+    index_.emplace(entries_.front().path, entries_.begin());
+    while (entries_.size() > capacity_) {
+        // 被淘汰的fd在仍在发送它的连接完成后才关闭
+        index_.erase(entries_.back().path);
+        entries_.pop_back();
+    }
+}
+
+size_t FileCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::string_view mime_type(std::string_view path) {
+    size_t slash = path.rfind('/');
+    size_t dot = path.rfind('.');
+    if (dot != std::string_view::npos && (slash == std::string_view::npos || dot > slash)) {
+        std::string_view extension = path.substr(dot + 1);
+        for (const MimeEntry& entry : kMimeTypes) {
+            if (iequals(extension, entry.extension)) {
+                return entry.type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+std::string format_http_date(time_t time) {
+    tm parts{};
+    gmtime_r(&time, &parts);
+    char buffer[64];
+    size_t length = std::strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &parts);
+    return std::string(buffer, length);
+}
+
+bool parse_http_date(std::string_view text, time_t& time) {
+    std::string value(trim_whitespace(text));
+    tm parts{};
+    const char* end = strptime(value.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &parts);
+    if (!end || *end != '\0') {
+        return false;
+    }
+    time = timegm(&parts);
+    return time != static_cast<time_t>(-1);
+}
+
+RequestHandler make_static_directory_handler(const std::string& root, const StaticDirectoryOptions& options) {
+    auto cache = std::make_shared<FileCache>(options.max_open_files, options.revalidate_interval);
+    std::string base = root;
+    while (base.size() > 1 && base.back() == '/') {
+        base.pop_back();
+    }
+
+    return [cache, base, options](const Request& request) {
+        bool head = request.method == "HEAD";
+        if (!head && request.method != "GET") {
+            Response response = make_status(405, "Method Not Allowed");
+            response.headers["Allow"] = "GET, HEAD";
+            return response;
+        }
+
+        // 未通过通配参数挂载时使用完整路径
+        std::string_view relative = request.param(options.param);
+        if (relative.empty() && request.params.count == 0) {
+            relative = request.path;
+        }
+        std::string resolved;
+        if (!resolve_relative_path(relative, resolved)) {
+            return make_status(400, "Bad Request");
+        }
+
+        std::shared_ptr<const OpenFile> file;
+        if (resolved.empty() || resolved.back() == '/') {
+            if (!options.index_file.empty()) {
+                file = cache->open(base + resolved + (resolved.empty() ? "/" : "") + options.index_file);
+            }
+        } else {
+            file = cache->open(base + resolved);
+            if (!file && !options.index_file.empty()) {
+                file = cache->open(base + resolved + "/" + options.index_file);
+            }
+        }
+        if (!file) {
+            return make_status(404, "Not Found");
+        }
+
+        Response response;
+        response.headers[HeaderId::ETag] = file->etag();
+        response.headers["Last-Modified"] = file->last_modified();
+        if (!options.cache_control.empty()) {
+            response.headers[HeaderId::CacheControl] = options.cache_control;
+        }
+        if (not_modified(request, *file)) {
+            response.status_code = 304;
+            response.status_text = "Not Modified";
+            return response;
+        }
+
+        response.headers[HeaderId::ContentType] = file->content_type();
+        response.headers["Accept-Ranges"] = "bytes";
+        uint64_t offset = 0;
+        uint64_t length = file->size();
+        const std::pmr::string* range = request.find_header(HeaderId::Range);
+        if (range && range_applies(request, *file)) {
+            switch (parse_range(*range, file->size(), offset, length)) {
+                case RangeResult::Satisfiable:
+                    response.status_code = 206;
+                    response.status_text = "Partial Content";
+                    response.headers["Content-Range"] = "bytes " + std::to_string(offset) + "-" +
+                                                        std::to_string(offset + length - 1) + "/" +
+                                                        std::to_string(file->size());
+                    break;
+                case RangeResult::Unsatisfiable: {
+                    Response unsatisfiable = make_status(416, "Range Not Satisfiable");
+                    unsatisfiable.headers["Content-Range"] = "bytes */" + std::to_string(file->size());
+                    return unsatisfiable;
+                }
+                case RangeResult::None:
+                    break;
+            }
+        }
+
+        // HEAD只返回头部；GET的响应体由事件循环以sendfile发送
+        if (head) {
+            response.headers[HeaderId::ContentLength] = std::to_string(length);
+        } else {
+            response.file.file = std::move(file);
+            response.file.offset = offset;
+            response.file.length = length;
+        }
+        return response;
+    };
+}
+
+} // namespace http
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "http_server.hpp"
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace http {
+
+/**
+ * 已打开的只读文件及其元数据
+ * 打开时一次性生成ETag、Last-Modified和Content-Type，之后多个请求共享同一个fd；
+ * 最后一个引用（缓存项或正在发送的连接）释放时关闭fd。
+ */
+class OpenFile {
+public:
+    OpenFile(int fd, const struct stat& info, std::string_view path);
+    ~OpenFile();
+
+    OpenFile(const OpenFile&) = delete;
+    OpenFile& operator=(const OpenFile&) = delete;
+
+    int fd() const { return fd_; }
+    uint64_t size() const { return size_; }
+    time_t modified() const { return modified_; }
+    const std::string& etag() const { return etag_; }
+    const std::string& last_modified() const { return last_modified_; }
+    const std::string& content_type() const { return content_type_; }
+
+    // 文件是否仍与stat结果一致（同一inode且大小、修改时间未变）
+    bool same_as(const struct stat& info) const;
+
+private:
+    int fd_;
+    uint64_t size_;
+    time_t modified_;
+    dev_t device_;
+    ino_t inode_;
+    int64_t modified_ns_;
+    std::string etag_;
+    std::string last_modified_;
+    std::string content_type_;
+};
+
+/**
+ * 打开文件的LRU缓存（线程安全）
+ * 缓存fd和stat结果，在revalidate间隔内的命中不产生任何系统调用；
+ * 过期后只做一次stat，文件未变化则继续使用已打开的fd。
+ * 不存在或不是普通文件的路径同样被缓存，避免对404反复open。
+ */
+class FileCache {
+public:
+    FileCache(size_t capacity, std::chrono::milliseconds revalidate);
+
+    // 打开（或从缓存取得）普通文件，不存在、不可读或不是普通文件时返回nullptr
+    std::shared_ptr<const OpenFile> open(const std::string& path);
+
+    size_t size() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Entry {
+        std::string path;
+        std::shared_ptr<const OpenFile> file;
+        Clock::time_point checked;
+    };
+
+    size_t capacity_;
+    std::chrono::milliseconds revalidate_;
+    mutable std::mutex mutex_;
+    std::list<Entry> entries_;   // 头部为最近使用
+    std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+
+    void store(const std::string& path, std::shared_ptr<const OpenFile> file, Clock::time_point now);
+};
+
+/**
+ * 静态目录处理器的选项
+ */
+struct StaticDirectoryOptions {
+    std::string param = "path";                              // 路由中通配后缀的参数名，如 /assets/*path
+    std::string index_file = "index.html";                   // 请求目录时返回的文件，为空表示不支持
+    std::string cache_control;                               // 非空时附加Cache-Control头
+    size_t max_open_files = 256;                             // 缓存的fd数上限
+    std::chrono::milliseconds revalidate_interval{1000};     // 缓存的stat结果在该间隔内视为有效
+};
+
+/**
+ * 创建静态目录处理器，通过register_handler挂载到带通配后缀的路由上，
+ * 通常同时注册GET和HEAD（路由形如 "/assets/" 加通配段 "*path"）。
+ * 响应体由事件循环以sendfile直接从文件发送，不经过用户态缓冲；
+ * 支持ETag/Last-Modified条件请求（304）和单区间Range请求（206/416）。
+ * 路径中的".."段一律拒绝，不会访问root之外的文件。
+ */
+RequestHandler make_static_directory_handler(const std::string& root, const StaticDirectoryOptions& options = {});
+
+// 按扩展名推断Content-Type，未知类型返回application/octet-stream
+std::string_view mime_type(std::string_view path);
+
+// 格式化为HTTP日期（RFC 7231 IMF-fixdate），如 "Sun, 06 Nov 1994 08:49:37 GMT"
+std::string format_http_date(time_t time);
+
+// 解析IMF-fixdate格式的HTTP日期，失败时返回false
+bool parse_http_date(std::string_view text, time_t& time);
+
+} // namespace http
@@ -0,0 +1,142 @@
+#include "static_response.hpp"
+#include "request_parser.hpp"
+#include <cstdint>
+#include <cstdio>
+
+namespace http {
+
+namespace {
+
+std::string_view strip_weak(std::string_view tag) {
+    if (tag.size() > 2 && tag[0] == 'W' && tag[1] == '/') {
+        tag.remove_prefix(2);
+    }
+    return tag;
+}
+
+} // namespace
+
+std::string compute_etag(std::string_view body) {
+    // 64位FNV-1a，附带长度以进一步降低碰撞概率
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : body) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+
+    char buffer[48];
+    int length = std::snprintf(buffer, sizeof(buffer), "\"%zx-%016llx\"", body.size(),
+                               static_cast<unsigned long long>(hash));
+    return std::string(buffer, length);
+}
+
+bool etag_matches(std::string_view if_none_match, std::string_view etag) {
+    if (trim_whitespace(if_none_match) == "*") {
+        return true;
+    }
+
+    std::string_view target = strip_weak(etag);
+    while (!if_none_match.empty()) {
+        size_t comma = if_none_match.find(',');
+        std::string_view candidate = trim_whitespace(if_none_match.substr(0, comma));
+        if (strip_weak(candidate) == target) {
+            return true;
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        if_none_match.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+StaticResponse::StaticResponse(const Response& response) {
+    // 只在内容可压缩且压缩后确实更小时生成压缩变体
+    const std::pmr::string* content_type = response.find_header(HeaderId::ContentType);
+    bool compressible = !response.find_header(HeaderId::ContentEncoding) &&
+                        is_compressible_type(content_type ? std::string_view(*content_type)
+                                                          : std::string_view("text/html"));
+
+    Response encoded[kContentEncodingCount];
+    bool any_compressed = false;
+    if (compressible) {
+        for (ContentEncoding encoding : {ContentEncoding::Gzip, ContentEncoding::Deflate}) {
+            Response& variant = encoded[static_cast<int>(encoding)];
+            std::string compressed;
+            if (compress_body(response.body, encoding, compressed, kBestCompressionLevel) &&
+                compressed.size() < response.body.size()) {
+                variant.body = compressed;
+                variant.status_code = response.status_code;
+                variant.status_text = response.status_text;
+                variant.headers = response.headers;
+                variant.headers[HeaderId::ContentEncoding] = encoding_name(encoding);
+                variants_[static_cast<int>(encoding)].available = true;
+                any_compressed = true;
+            }
+        }
+    }
+
+    variants_[0].available = true;
+    build_variant(variants_[0], response, any_compressed);
+    for (int i = 1; i < kContentEncodingCount; ++i) {
+        if (variants_[i].available) {
+            build_variant(variants_[i], encoded[i], true);
+        }
+    }
+}
+
+void StaticResponse::build_variant(Variant& variant, const Response& response, bool vary) {
+    variant.etag = compute_etag(response.body);
+
+    Response tagged = response;
+    tagged.headers[HeaderId::ETag] = variant.etag;
+
+    Response not_modified;
+    not_modified.status_code = 304;
+    not_modified.status_text = "Not Modified";
+    not_modified.headers[HeaderId::ETag] = variant.etag;
+    if (const std::pmr::string* cache_control = response.find_header(HeaderId::CacheControl)) {
+        not_modified.headers[HeaderId::CacheControl] = *cache_control;
+    }
+
+    // 存在多个编码变体时，缓存必须按Accept-Encoding区分
+    if (vary) {
+        tagged.headers[HeaderId::Vary] = "Accept-Encoding";
+        not_modified.headers[HeaderId::Vary] = "Accept-Encoding";
+    }
+
+    for (int keep_alive = 0; keep_alive < 2; ++keep_alive) {
+        const char* connection = keep_alive ? "keep-alive" : "close";
+
+        std::string full;
+        full.reserve(256 + tagged.body.size());
+        tagged.write_head(full, connection);
+        full.append(tagged.body);
+        variant.full[keep_alive] = std::make_shared<const std::string>(std::move(full));
+
+        std::string head;
+        not_modified.write_head(head, connection);
+        variant.not_modified[keep_alive] = std::make_shared<const std::string>(std::move(head));
+    }
+}
+
+std::shared_ptr<const std::string> StaticResponse::select(const Request& request, bool keep_alive) const {
+    const Variant* variant = &variants_[0];
+    if (variants_[1].available || variants_[2].available) {
+        const std::pmr::string* accept_encoding = request.find_header(HeaderId::AcceptEncoding);
+        if (accept_encoding) {
+            const Variant& preferred = variants_[static_cast<int>(negotiate_encoding(*accept_encoding))];
+            if (preferred.available) {
+                variant = &preferred;
+            }
+        }
+    }
+
+    const std::pmr::string* if_none_match = request.find_header(HeaderId::IfNoneMatch);
+    if (if_none_match && etag_matches(*if_none_match, variant->etag)) {
+        return variant->not_modified[keep_alive];
+    }
+    return variant->full[keep_alive];
+}
+
+} // namespace http
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "http_server.hpp"
+#include "compression.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace http {
+
+/**
+ * 预先序列化的静态响应
+ * 启动时一次性生成完整报文（状态行 + 头部 + 响应体）及对应的304报文，
+ * 之后所有连接共享这些只读内存直接发送，不再执行处理器或序列化。
+ * 可压缩的内容同时预先生成gzip/deflate变体，按Accept-Encoding选择，
+ * 每个变体拥有自己的强ETag，所有变体都带Vary: Accept-Encoding。
+ */
+class StaticResponse {
+public:
+    explicit StaticResponse(const Response& response);
+
+    // 根据If-None-Match和连接是否保持，选择要发送的报文
+    std::shared_ptr<const std::string> select(const Request& request, bool keep_alive) const;
+
+    // 未压缩变体的ETag
+    const std::string& etag() const { return variants_[0].etag; }
+
+    // 是否生成了指定编码的变体
+    bool has_variant(ContentEncoding encoding) const { return variants_[static_cast<int>(encoding)].available; }
+
+private:
+    struct Variant {
+        bool available = false;
+        std::string etag;
+        std::shared_ptr<const std::string> full[2];          // 下标为keep_alive
+        std::shared_ptr<const std::string> not_modified[2];
+    };
+
+    Variant variants_[kContentEncodingCount];
+
+    void build_variant(Variant& variant, const Response& response, bool vary);
+};
+
+// 基于内容计算强ETag（带引号）
+std::string compute_etag(std::string_view body);
+
+// If-None-Match是否与etag匹配（弱比较，支持列表和"*"）
+bool etag_matches(std::string_view if_none_match, std::string_view etag);
+
+} // namespace http
@@ -0,0 +1,181 @@
+#include "../http_server.hpp"
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/**
+ * HEAD请求与keep-alive
+ * 在同一连接上先发HEAD再发GET：HEAD响应只有头部（Content-Length与GET一致），
+ * 之后不得有多余字节，GET响应紧接着被完整读出。
+ * 覆盖预生成报文（register_static）、线程池处理器、缓存路由和404，两种I/O后端各跑一遍。
+ */
+
+namespace {
+
+constexpr int kBasePort = 18280;
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::fprintf(stderr, "失败: %s\n", what.c_str());
+        ++failures;
+    }
+}
+
+int connect_to(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    timeval timeout{2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+struct Reply {
+    int status = 0;
+    size_t content_length = 0;
+    std::string head;
+    std::string body;
+};
+
+// 读一个响应；HEAD响应只读头部，其余按Content-Length读响应体。失败返回false
+bool read_reply(int fd, bool head_only, Reply& reply) {
+    std::string buffer;
+    char chunk[4096];
+    size_t end = std::string::npos;
+    // 逐字节读到头部结束，避免把后续字节一并读走而掩盖多余的响应体
+    while (end == std::string::npos) {
+        ssize_t received = recv(fd, chunk, 1, 0);
+        if (received <= 0) {
+            return false;
+        }
+        buffer.append(chunk, received);
+        end = buffer.find("\r\n\r\n");
+    }
+    reply.head = buffer;
+    reply.status = std::atoi(buffer.c_str() + 9);
+    size_t length = buffer.find("Content-Length: ");
+    if (length == std::string::npos) {
+        return false;
+    }
+    reply.content_length = std::strtoul(buffer.c_str() + length + 16, nullptr, 10);
+    if (head_only) {
+        return true;
+    }
+    while (reply.body.size() < reply.content_length) {
+        ssize_t received = recv(fd, chunk, std::min(sizeof(chunk), reply.content_length - reply.body.size()), 0);
+        if (received <= 0) {
+            return false;
+        }
+        reply.body.append(chunk, received);
+    }
+    return true;
+}
+
+// 连接上在timeout_ms内没有更多数据
+bool idle(int fd, int timeout_ms) {
+    pollfd entry{fd, POLLIN, 0};
+    return poll(&entry, 1, timeout_ms) == 0;
+}
+
+void head_then_get(int port, const std::string& path, int expected_status, const std::string& label) {
+    int fd = connect_to(port);
+    check(fd >= 0, label + " 连接");
+    if (fd < 0) {
+        return;
+    }
+    std::string head = "HEAD " + path + " HTTP/1.1\r\nHost: test\r\n\r\n";
+    std::string get = "GET " + path + " HTTP/1.1\r\nHost: test\r\n\r\n";
+
+    Reply head_reply;
+    send(fd, head.data(), head.size(), MSG_NOSIGNAL);
+    bool ok = read_reply(fd, true, head_reply);
+    check(ok, label + " HEAD响应");
+    check(head_reply.status == expected_status, label + " HEAD状态码 " + std::to_string(head_reply.status));
+    check(head_reply.head.find("Connection: keep-alive") != std::string::npos, label + " HEAD保持连接");
+    check(idle(fd, 100), label + " HEAD响应后没有多余字节");
+
+    Reply get_reply;
+    send(fd, get.data(), get.size(), MSG_NOSIGNAL);
+    ok = read_reply(fd, false, get_reply);
+    check(ok, label + " GET响应");
+    check(get_reply.status == expected_status, label + " GET状态码 " + std::to_string(get_reply.status));
+    check(get_reply.content_length > 0 && get_reply.content_length == head_reply.content_length,
+          label + " HEAD与GET的Content-Length一致");
+    check(idle(fd, 50), label + " GET响应后没有多余字节");
+    close(fd);
+}
+
+void run(http::IoBackend backend, int port, const char* name) {
+    http::ServerConfig config;
+    config.port = port;
+    config.io_threads = 1;
+    config.worker_threads = 1;
+    config.io_backend = backend;
+
+    http::HttpServer server(config);
+    http::Response page;
+    page.body = "<h1>hello</h1>";
+    server.register_static("GET", "/static", page);
+    server.register_handler("GET", "/dynamic", [](const http::Request&) {
+        http::Response response;
+        response.body = "{\"message\":\"hello\"}";
+        return response;
+    });
+    server.register_handler("GET", "/cached", [](const http::Request&) {
+        http::Response response;
+        response.body = "cached";
+        return response;
+    });
+    server.cache_responses("/cached", http::CachePolicy{});
+    server.start();
+
+    std::string prefix = std::string(name) + " ";
+    head_then_get(port, "/static", 200, prefix + "/static");
+    head_then_get(port, "/dynamic", 200, prefix + "/dynamic");
+    head_then_get(port, "/cached", 200, prefix + "/cached");
+    head_then_get(port, "/missing", 404, prefix + "/missing");
+    server.stop();
+}
+
+} // namespace
+
+int main() {
+    // 服务器的启动日志不混入测试输出
+    int null_fd = open("/dev/null", O_WRONLY);
+    int saved = dup(STDOUT_FILENO);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+    run(http::IoBackend::Epoll, kBasePort, "epoll");
+    run(http::IoBackend::IoUring, kBasePort + 1, "io_uring");
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    if (failures == 0) {
+        std::printf("HEAD/GET keep-alive: 全部通过\n");
+        return 0;
+    }
+    std::printf("HEAD/GET keep-alive: %d项失败\n", failures);
+    return 1;
+}
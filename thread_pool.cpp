@@ -0,0 +1,128 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+namespace http {
+
+namespace {
+// 当前线程所属线程池及其队列下标，用于工作线程内部提交时直接入本地队列
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local size_t current_index = 0;
+}
+
+ThreadPool::ThreadPool(size_t threads, size_t max_queued) : max_queued_(std::max<size_t>(1, max_queued)) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    shutdown();
+}
+
+bool ThreadPool::submit(Task task) {
+    if (stopping_.load(std::memory_order_relaxed)) {
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // 先占位再入队，保证排队任务总数不超过上限
+    if (queued_.fetch_add(1) >= max_queued_) {
+        queued_.fetch_sub(1);
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    size_t index = current_pool == this
+        ? current_index
+        : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+
+    if (idle_workers_.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.notify_one();
+    }
+    return true;
+}
+
+void ThreadPool::shutdown() {
+    if (stopping_.exchange(true)) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        sleep_cv_.notify_all();
+    }
+
+    for (auto& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    for (auto& queue : queues_) {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->tasks.clear();
+    }
+    queued_.store(0);
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    Task task;
+    while (!stopping_.load(std::memory_order_relaxed)) {
+        if (pop_local(index, task) || steal(index, task)) {
+            queued_.fetch_sub(1);
+            task();
+            task = nullptr;
+            completed_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        idle_workers_.fetch_add(1);
+        sleep_cv_.wait(lock, [this]() {
+            return stopping_.load() || queued_.load() > 0;
+        });
+        idle_workers_.fetch_sub(1);
+    }
+}
+
+bool ThreadPool::pop_local(size_t index, Task& task) {
+    WorkQueue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.front());
+    queue.tasks.pop_front();
+    return true;
+}
+
+bool ThreadPool::steal(size_t thief, Task& task) {
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+        WorkQueue& victim = *queues_[(thief + offset) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            // 与所有者一样从队首取最早提交的任务；队列由同一把锁保护，从哪一端取竞争都相同
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace http
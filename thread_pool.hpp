@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace http {
+
+/**
+ * 固定大小的工作线程池
+ * 每个工作线程拥有自己的任务队列，空闲时从其他线程的队列窃取任务。所有者和窃取者都从队首取，
+ * 任务大体按提交顺序执行，过载时先到的请求不会被后到的插队。
+ * 队列总长度有上限，超出时submit()返回false并计入拒绝次数。
+ */
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    /**
+     * @param threads 工作线程数，0表示使用硬件并发数
+     * @param max_queued 所有队列中等待任务的总上限
+     */
+    explicit ThreadPool(size_t threads = 0, size_t max_queued = 1024);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // 提交任务（线程安全），队列已满或线程池已关闭时返回false
+    bool submit(Task task);
+
+    // 停止接收新任务，丢弃尚未开始的任务并等待工作线程退出
+    void shutdown();
+
+    size_t size() const { return threads_.size(); }
+    size_t queued() const { return queued_.load(std::memory_order_relaxed); }
+    uint64_t rejected_count() const { return rejected_.load(std::memory_order_relaxed); }
+    uint64_t completed_count() const { return completed_.load(std::memory_order_relaxed); }
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> threads_;
+    const size_t max_queued_;
+
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> next_queue_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> completed_{0};
+    std::atomic<bool> stopping_{false};
+
+    std::mutex sleep_mutex_;
+    std::condition_variable sleep_cv_;
+    std::atomic<size_t> idle_workers_{0};
+
+    void worker_loop(size_t index);
+    bool pop_local(size_t index, Task& task);
+    bool steal(size_t thief, Task& task);
+};
+
+} // namespace http
@@ -0,0 +1,209 @@
+#include "timing_wheel.hpp"
+#include <algorithm>
+#include <climits>
+
+namespace http {
+
+namespace {
+
+constexpr uint64_t kSlotMask = TimingWheel::kSlots - 1;
+
+// 第level层一个槽覆盖的tick数
+constexpr uint64_t level_span(int level) {
+    return uint64_t(1) << (TimingWheel::kLevelBits * level);
+}
+
+constexpr uint64_t kMaxDelta = level_span(TimingWheel::kLevels) - 1;
+
+} // namespace
+
+TimerNode::~TimerNode() {
+    if (wheel_) {
+        wheel_->cancel(*this);
+    }
+}
+
+TimingWheel::TimingWheel(std::chrono::milliseconds tick, Clock::time_point now)
+    : tick_(tick.count() > 0 ? tick : std::chrono::milliseconds(1)), origin_(now) {
+}
+
+TimingWheel::~TimingWheel() {
+    // 仍挂着的节点与时间轮脱离，之后析构时不再访问已销毁的时间轮
+    for (auto& level : slots_) {
+        for (Slot& slot : level) {
+            TimerNode* node = slot.head.next_;
+            while (node != &slot.head) {
+                TimerNode* next = node->next_;
+                node->prev_ = node->next_ = nullptr;
+                node->wheel_ = nullptr;
+                node = next;
+            }
+        }
+    }
+}
+
+uint64_t TimingWheel::tick_of(Clock::time_point time, bool round_up) const {
+    if (time <= origin_) {
+        return 0;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(time - origin_).count();
+    auto tick = std::chrono::duration_cast<std::chrono::nanoseconds>(tick_).count();
+    return static_cast<uint64_t>(round_up ? (elapsed + tick - 1) / tick : elapsed / tick);
+}
+
+void TimingWheel::schedule(TimerNode& node, Clock::time_point deadline) {
+    if (node.wheel_) {
+        unlink(node);
+    }
+    // 到期时间至少在下一个tick，当前tick的槽已经处理过
+    uint64_t expires = tick_of(deadline, true);
+    if (expires <= current_) {
+        expires = current_ + 1;
+    } else if (expires - current_ > kMaxDelta) {
+        expires = current_ + kMaxDelta;
+    }
+    node.expires_ = expires;
+    node.wheel_ = this;
+    ++size_;
+    insert(node);
+}
+
+void TimingWheel::cancel(TimerNode& node) {
+    if (node.wheel_ != this) {
+        return;
+    }
+    unlink(node);
+}
+
+void TimingWheel::insert(TimerNode& node) {
+    // 按距离选层：距离落在[kSlots^L, kSlots^(L+1))的节点放在第L层，
+    // 槽号取到期tick在该层的位段，该槽在轮到它时整体下放
+    uint64_t delta = node.expires_ - current_;
+    int level = 0;
+    while (level + 1 < kLevels && delta >= level_span(level + 1)) {
+        ++level;
+    }
+    int slot = static_cast<int>((node.expires_ >> (kLevelBits * level)) & kSlotMask);
+
+    TimerNode& head = slots_[level][slot].head;
+    node.level_ = static_cast<uint8_t>(level);
+    node.slot_ = static_cast<uint8_t>(slot);
+    node.prev_ = head.prev_;
+    node.next_ = &head;
+    head.prev_->next_ = &node;
+    head.prev_ = &node;
+    occupied_[level] |= uint64_t(1) << slot;
+}
+
+void TimingWheel::unlink(TimerNode& node) {
+    node.prev_->next_ = node.next_;
+    node.next_->prev_ = node.prev_;
+    TimerNode& head = slots_[node.level_][node.slot_].head;
+    if (head.next_ == &head) {
+        occupied_[node.level_] &= ~(uint64_t(1) << node.slot_);
+    }
+    node.prev_ = node.next_ = nullptr;
+    node.wheel_ = nullptr;
+    --size_;
+}
+
+void TimingWheel::cascade(int level) {
+    int slot = static_cast<int>((current_ >> (kLevelBits * level)) & kSlotMask);
+    if (!(occupied_[level] & (uint64_t(1) << slot))) {
+        return;
+    }
+    // 整槽摘下后按新的距离重新挂入（必然落到更低的层）
+    TimerNode& head = slots_[level][slot].head;
+    TimerNode* node = head.next_;
+    head.prev_ = head.next_ = &head;
+    occupied_[level] &= ~(uint64_t(1) << slot);
+    while (node != &head) {
+        TimerNode* next = node->next_;
+        insert(*node);
+        node = next;
+    }
+}
+
+void TimingWheel::expire_slot(int slot) {
+    if (!(occupied_[0] & (uint64_t(1) << slot))) {
+        return;
+    }
+    // 先把整槽移到局部链表，回调中重新挂入的节点不会在本轮再次触发；
+    // 回调取消局部链表中的其他节点同样安全（unlink只依赖相邻节点）
+    TimerNode& head = slots_[0][slot].head;
+    TimerNode pending;
+    pending.next_ = head.next_;
+    pending.prev_ = head.prev_;
+    pending.next_->prev_ = &pending;
+    pending.prev_->next_ = &pending;
+    head.prev_ = head.next_ = &head;
+    occupied_[0] &= ~(uint64_t(1) << slot);
+
+    while (pending.next_ != &pending) {
+        TimerNode* node = pending.next_;
+        node->prev_->next_ = node->next_;
+        node->next_->prev_ = node->prev_;
+        node->prev_ = node->next_ = nullptr;
+        node->wheel_ = nullptr;
+        --size_;
+        if (node->callback_) {
+            node->callback_();
+        }
+    }
+}
+
+void TimingWheel::advance(Clock::time_point now) {
+    uint64_t target = tick_of(now, false);
+    if (size_ == 0) {
+        // 空轮直接跳到目标位置
+        current_ = std::max(current_, target);
+        return;
+    }
+    while (current_ < target) {
+        ++current_;
+        // 低层转完一圈时，把高层对应的槽下放
+        for (int level = 1; level < kLevels; ++level) {
+            if ((current_ & (level_span(level) - 1)) != 0) {
+                break;
+            }
+            cascade(level);
+        }
+        expire_slot(static_cast<int>(current_ & kSlotMask));
+        if (size_ == 0) {
+            current_ = target;
+        }
+    }
+}
+
+int TimingWheel::next_timeout_ms(Clock::time_point now) const {
+    if (size_ == 0) {
+        return -1;
+    }
+    // 第0层：下一个非空槽；更高层：下一个非空槽下放的时刻。取最早者
+    uint64_t next = UINT64_MAX;
+    for (int level = 0; level < kLevels; ++level) {
+        uint64_t bits = occupied_[level];
+        if (!bits) {
+            continue;
+        }
+        int shift = kLevelBits * level;
+        uint64_t index = (current_ >> shift) & kSlotMask;
+        // 从index + 1开始循环查找，距离至少为1个槽
+        int rotate = static_cast<int>((index + 1) & kSlotMask);
+        uint64_t rotated = rotate ? (bits >> rotate) | (bits << (kSlots - rotate)) : bits;
+        uint64_t distance = static_cast<uint64_t>(__builtin_ctzll(rotated)) + 1;
+        uint64_t at = (((current_ >> shift) + distance) << shift);
+        next = std::min(next, at);
+    }
+
+    auto tick = std::chrono::duration_cast<std::chrono::nanoseconds>(tick_);
+    auto deadline = origin_ + tick * static_cast<int64_t>(next);
+    if (deadline <= now) {
+        return 0;
+    }
+    // 向上取整，避免提前醒来后空转
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now);
+    return static_cast<int>(std::min<int64_t>(remaining.count() + 1, INT_MAX));
+}
+
+} // namespace http
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace http {
+
+class TimingWheel;
+
+/**
+ * 定时器节点
+ * 侵入式双向链表节点，嵌入在使用者（如连接）中，挂入时间轮不分配内存。
+ * 回调在节点所属的事件循环线程上执行；节点析构时自动取消。
+ */
+class TimerNode {
+public:
+    TimerNode() = default;
+    explicit TimerNode(std::function<void()> callback) : callback_(std::move(callback)) {}
+    ~TimerNode();
+
+    TimerNode(const TimerNode&) = delete;
+    TimerNode& operator=(const TimerNode&) = delete;
+
+    void set_callback(std::function<void()> callback) { callback_ = std::move(callback); }
+
+    // 是否已挂入时间轮，尚未到期
+    bool armed() const { return wheel_ != nullptr; }
+
+private:
+    friend class TimingWheel;
+
+    TimerNode* prev_ = nullptr;
+    TimerNode* next_ = nullptr;
+    TimingWheel* wheel_ = nullptr;
+    uint64_t expires_ = 0;      // 到期的tick
+    uint8_t level_ = 0;         // 所在的层和槽，取消时用于维护占用位图
+    uint8_t slot_ = 0;
+    std::function<void()> callback_;
+};
+
+/**
+ * 分层时间轮
+ * kLevels层、每层kSlots个槽，第L层一个槽覆盖kSlots^L个tick；挂入和取消都是O(1)，
+ * 高层的槽在低层转完一圈时下放（cascade）到低层。每层用一个64位位图记录非空槽，
+ * 可以O(层数)地算出下一次需要醒来的时间，不必逐tick空转。
+ * 超出范围（kSlots^kLevels个tick）的到期时间按最大范围处理，回调应自行核对实际截止时间。
+ * 非线程安全，只在所属事件循环线程上使用。
+ */
+class TimingWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int kLevelBits = 6;
+    static constexpr int kSlots = 1 << kLevelBits;
+    static constexpr int kLevels = 5;
+
+    explicit TimingWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(10),
+                         Clock::time_point now = Clock::now());
+    ~TimingWheel();
+
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    // 挂入或重新挂入节点，在deadline之后（按tick向上取整）触发，不会提前
+    void schedule(TimerNode& node, Clock::time_point deadline);
+
+    // 取消节点，未挂入时无操作
+    void cancel(TimerNode& node);
+
+    // 推进到now，依次执行到期节点的回调；回调中可以重新挂入或取消任意节点
+    void advance(Clock::time_point now);
+
+    // 距离下一次需要advance的毫秒数（可能早于实际到期，不会晚），没有节点时为-1
+    int next_timeout_ms(Clock::time_point now) const;
+
+    // 已挂入的节点数
+    size_t size() const { return size_; }
+
+    std::chrono::milliseconds tick() const { return tick_; }
+
+private:
+    // 每个槽是带哨兵的循环链表
+    struct Slot {
+        TimerNode head;
+        Slot() { head.prev_ = head.next_ = &head; }
+    };
+
+    std::chrono::milliseconds tick_;
+    Clock::time_point origin_;
+    uint64_t current_ = 0;      // 已处理到的tick
+    size_t size_ = 0;
+    uint64_t occupied_[kLevels] = {};
+    Slot slots_[kLevels][kSlots];
+
+    uint64_t tick_of(Clock::time_point time, bool round_up) const;
+    void insert(TimerNode& node);
+    void unlink(TimerNode& node);
+    void cascade(int level);
+    void expire_slot(int slot);
+};
+
+} // namespace http